@@ -6,938 +6,6793 @@
 #include <termios.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
 #include <ctime>
+#include <cstdlib>
+#include <cmath>
+#include <map>
+#include <new>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <climits>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
-// Struct untuk menyimpan data pesan
-struct Pesan {
-    string text;
-    bool isRead;
-    
-    Pesan() : text(""), isRead(false) {}
-    Pesan(string t, bool r = false) : text(t), isRead(r) {}
-};
+// Penghitung alokasi heap per thread (dipakai mode benchmark untuk
+// allocations/op). operator new global diganti di semua mode, tetapi hanya
+// menghitung setelah mode benchmark menyalakan countAllocations; mode lain
+// (mis. TUI) cukup membayar satu cek flag per alokasi
+bool countAllocations = false;
+thread_local long long allocationCount = 0;
 
-// Node untuk Doubly Linked List
-struct Node {
-    Pesan data;
-    Node* next;
-    Node* prev;
-    
-    Node(Pesan p) : data(p), next(nullptr), prev(nullptr) {}
-};
+inline void countAllocation() {
+    if (countAllocations) {
+        allocationCount++;
+    }
+}
 
-// Class Queue menggunakan Doubly Linked List
-class QueuePesan {
+// Alokasi untuk new dengan alignas di atas alignment bawaan
+inline void* alignedAlloc(size_t size, align_val_t alignment) {
+    size_t align = (size_t)alignment;
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+void* operator new(size_t size) {
+    countAllocation();
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    countAllocation();
+    return malloc(size > 0 ? size : 1);
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    countAllocation();
+    void* p = alignedAlloc(size > 0 ? size : 1, alignment);
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    countAllocation();
+    return alignedAlloc(size > 0 ? size : 1, alignment);
+}
+
+// Tidak di-inline: jika free() terlihat langsung di pemanggil, GCC mengira
+// pointer dari operator new dibebaskan dengan fungsi yang salah
+__attribute__((noinline)) void releaseAllocation(void* p) {
+    free(p);
+}
+
+void operator delete(void* p) noexcept {
+    releaseAllocation(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    releaseAllocation(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+    releaseAllocation(p);
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+    releaseAllocation(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept {
+    releaseAllocation(p);
+}
+
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept {
+    releaseAllocation(p);
+}
+
+// Fungsi untuk mendapatkan waktu monotonic dalam milidetik
+long long currentTimeMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Fungsi untuk mendapatkan waktu monotonic dalam nanodetik (untuk pengukuran)
+long long currentTimeNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Histogram latency gaya HDR: bucket log-linear (16 sub-bucket per pangkat 2),
+// error relatif maksimal ~6% dengan memory tetap. Hanya satu thread yang
+// menulis (record), tapi thread lain boleh membaca kapan saja: counter atomic
+// relaxed tanpa instruksi lock karena tidak ada read-modify-write bersamaan
+class LatencyHistogram {
 private:
-    Node* front;  // Depan antrian (untuk dequeue)
-    Node* rear;   // Belakang antrian (untuk enqueue)
-    int size;
+    static const int SUB_BITS = 4;
+    static const int SUB_COUNT = 1 << SUB_BITS;
+    static const int BUCKET_COUNT = 64 * SUB_COUNT;
     
-public:
-    QueuePesan() : front(nullptr), rear(nullptr), size(0) {}
+    atomic<long long> counts[BUCKET_COUNT];
+    atomic<long long> total;
+    atomic<long long> maxValue;
     
-    // Destructor untuk membersihkan memory
-    ~QueuePesan() {
-        while (front != nullptr) {
-            Node* temp = front;
-            front = front->next;
-            delete temp;
+    static void bump(atomic<long long>& counter, long long delta) {
+        counter.store(counter.load(memory_order_relaxed) + delta, memory_order_relaxed);
+    }
+    
+    static int bucketOf(long long value) {
+        if (value < SUB_COUNT) {
+            return value < 0 ? 0 : (int)value;
         }
+        int exponent = 63 - __builtin_clzll((unsigned long long)value);
+        int sub = (int)((value >> (exponent - SUB_BITS)) & (SUB_COUNT - 1));
+        return (exponent - SUB_BITS + 1) * SUB_COUNT + sub;
     }
     
-    // Mengecek apakah queue kosong
-    bool isEmpty() {
-        return front == nullptr;
+    // Nilai batas atas bucket (dipakai saat membaca percentile)
+    static long long bucketUpperValue(int index) {
+        if (index < SUB_COUNT) {
+            return index;
+        }
+        int exponent = index / SUB_COUNT + SUB_BITS - 1;
+        long long sub = index % SUB_COUNT;
+        long long base = (SUB_COUNT + sub) << (exponent - SUB_BITS);
+        return base + (1LL << (exponent - SUB_BITS)) - 1;
     }
     
-    // Mendapatkan jumlah pesan
-    int getSize() {
-        return size;
+public:
+    LatencyHistogram() {
+        reset();
     }
     
-    // Enqueue - Menambah pesan baru (dengan spam filter)
-    bool enqueue(string text) {
-        // Spam Filter: Cek apakah pesan sama dengan pesan yang sudah ada
-        Node* current = front;
-        while (current != nullptr) {
-            if (current->data.text == text) {
-                return false; // Tolak pesan (spam)
-            }
-            current = current->next;
-        }
-        
-        Pesan newPesan(text, false);
-        Node* newNode = new Node(newPesan);
-        
-        if (isEmpty()) {
-            front = rear = newNode;
-        } else {
-            rear->next = newNode;
-            newNode->prev = rear;
-            rear = newNode;
+    void reset() {
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            counts[i].store(0, memory_order_relaxed);
         }
-        size++;
-        return true;
+        total.store(0, memory_order_relaxed);
+        maxValue.store(0, memory_order_relaxed);
     }
     
-    // Dequeue - Menghapus pesan pertama
-    bool dequeue() {
-        if (isEmpty()) {
-            return false;
-        }
-        
-        Node* temp = front;
-        front = front->next;
-        
-        if (front == nullptr) {
-            rear = nullptr;
-        } else {
-            front->prev = nullptr;
+    void record(long long value) {
+        bump(counts[bucketOf(value)], 1);
+        bump(total, 1);
+        if (value > maxValue.load(memory_order_relaxed)) {
+            maxValue.store(value, memory_order_relaxed);
         }
-        
-        delete temp;
-        size--;
-        return true;
     }
     
-    // Membatalkan pesan terakhir (Rear) - Fitur khusus Doubly Linked List
-    bool cancelLast() {
-        if (isEmpty()) {
-            return false;
+    // Tambahkan isi histogram lain (dipakai untuk menggabung histogram per thread)
+    void add(const LatencyHistogram& other) {
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            bump(counts[i], other.counts[i].load(memory_order_relaxed));
         }
-        
-        Node* temp = rear;
-        rear = rear->prev;
-        
-        if (rear == nullptr) {
-            front = nullptr;
-        } else {
-            rear->next = nullptr;
+        bump(total, other.total.load(memory_order_relaxed));
+        long long otherMax = other.maxValue.load(memory_order_relaxed);
+        if (otherMax > maxValue.load(memory_order_relaxed)) {
+            maxValue.store(otherMax, memory_order_relaxed);
         }
-        
-        delete temp;
-        size--;
-        return true;
     }
     
-    // Menandai pesan sebagai dibaca
-    bool markAsRead(int index) {
-        if (isEmpty() || index < 0 || index >= size) {
-            return false;
-        }
-        
-        Node* current = front;
-        for (int i = 0; i < index && current != nullptr; i++) {
-            current = current->next;
-        }
-        
-        if (current != nullptr) {
-            current->data.isRead = true;
-            return true;
-        }
-        return false;
+    long long getCount() const {
+        return total.load(memory_order_relaxed);
     }
     
-    // Mendapatkan pointer ke front (untuk display)
-    Node* getFront() {
-        return front;
+    long long getMax() const {
+        return maxValue.load(memory_order_relaxed);
+    }
+    
+    // Mendapatkan nilai percentile (0-100)
+    long long percentile(double p) const {
+        long long count = getCount();
+        long long maxSeen = getMax();
+        if (count == 0) {
+            return 0;
+        }
+        long long target = (long long)ceil(count * p / 100.0);
+        if (target < 1) target = 1;
+        long long seen = 0;
+        for (int i = 0; i < BUCKET_COUNT; i++) {
+            seen += counts[i].load(memory_order_relaxed);
+            if (seen >= target) {
+                long long value = bucketUpperValue(i);
+                return value < maxSeen ? value : maxSeen;
+            }
+        }
+        return maxSeen;
     }
 };
 
-// Fungsi gotoxy untuk positioning di terminal
-void gotoxy(int x, int y) {
-    printf("\033[%d;%dH", y, x);
-}
+// Jenis operasi yang dicatat latency-nya
+enum StatId {
+    STAT_ENQUEUE,
+    STAT_DEQUEUE,
+    STAT_CANCEL_LAST,
+    STAT_MARK_READ,
+    STAT_REMOVE_BY_ID,
+    STAT_BULK_REMOVE,
+    STAT_EXPIRE,
+    STAT_UNDO,
+    STAT_REDO,
+    STAT_SERVER_REQUEST,
+    STAT_INPUT_DECODE,
+    STAT_FRAME_RENDER,
+    STAT_COUNT
+};
 
-// Fungsi untuk clear screen
-void clearScreen() {
-    printf("\033[2J");
-    printf("\033[H");
-    fflush(stdout);
-}
+const char* STAT_NAMES[STAT_COUNT] = {
+    "enqueue",
+    "dequeue",
+    "cancelLast",
+    "markAsRead",
+    "removeById",
+    "bulkRemove",
+    "expire",
+    "undo",
+    "redo",
+    "server request",
+    "input decode",
+    "frame render"
+};
 
-// Fungsi untuk set warna text
-void setColor(int color) {
-    printf("\033[%dm", color);
-}
+// Statistik hanya dicatat jika diaktifkan (--stats / --stats-file)
+bool statsEnabled = false;
 
-// Reset warna
-void resetColor() {
-    printf("\033[0m");
-}
+// Histogram per thread: setiap thread hanya menulis ke miliknya sendiri (tanpa
+// lock di hot path) dan mendaftarkannya sekali; pembaca menggabung semuanya.
+// Set tidak pernah dibebaskan agar data thread yang sudah selesai tetap terbaca
+struct StatSet {
+    LatencyHistogram histograms[STAT_COUNT];
+};
 
-// Fungsi untuk convert string ke lowercase
-string toLowerCase(string str) {
-    string result = str;
-    for (int i = 0; i < (int)result.length(); i++) {
-        if (result[i] >= 'A' && result[i] <= 'Z') {
-            result[i] = result[i] + ('a' - 'A');
-        }
+mutex statSetsLock;
+vector<StatSet*> statSets;
+
+StatSet& threadStats() {
+    thread_local StatSet* mine = nullptr;
+    if (mine == nullptr) {
+        mine = new StatSet();
+        lock_guard<mutex> guard(statSetsLock);
+        statSets.push_back(mine);
     }
-    return result;
+    return *mine;
 }
 
-// Fungsi untuk cek apakah string hanya berisi whitespace/newline
-bool isEmptyOrWhitespace(const string& str) {
-    for (int i = 0; i < (int)str.length(); i++) {
-        if (str[i] != ' ' && str[i] != '\n' && str[i] != '\t' && str[i] != '\r') {
-            return false; // Ada karakter selain whitespace
-        }
+// Gabungan histogram id dari semua thread
+void statSnapshot(StatId id, LatencyHistogram& merged) {
+    merged.reset();
+    lock_guard<mutex> guard(statSetsLock);
+    for (size_t i = 0; i < statSets.size(); i++) {
+        merged.add(statSets[i]->histograms[id]);
     }
-    return true; // Hanya whitespace atau kosong
 }
 
-// Fungsi untuk parse input multiple message numbers
-// Format: "1,3,5" atau "1-3" atau "1,3-5,7" atau "all"
-// Return: vector berisi index yang dipilih (0-based)
-vector<int> parseMessageNumbers(const string& input, int maxSize) {
-    vector<int> result;
+// Timer RAII: mencatat durasi scope ke histogram; saat statistik nonaktif
+// biayanya hanya 1 pengecekan bool
+struct ScopedLatency {
+    StatId id;
+    long long start;
     
-    if (toLowerCase(input) == "all") {
-        for (int i = 0; i < maxSize; i++) {
-            result.push_back(i);
+    ScopedLatency(StatId statId) : id(statId), start(statsEnabled ? currentTimeNs() : 0) {}
+    
+    ~ScopedLatency() {
+        if (start != 0) {
+            threadStats().histograms[id].record(currentTimeNs() - start);
         }
-        return result;
     }
-    
-    string current = "";
-    for (int i = 0; i <= (int)input.length(); i++) {
-        char ch = (i < (int)input.length()) ? input[i] : ',';
-        
-        if (ch == ',' || ch == ' ' || i == (int)input.length()) {
-            if (!current.empty()) {
-                // Check if it's a range (e.g., "1-3")
-                int dashPos = -1;
-                for (int j = 0; j < (int)current.length(); j++) {
-                    if (current[j] == '-') {
-                        dashPos = j;
-                        break;
-                    }
-                }
-                
-                if (dashPos != -1) {
-                    // Range format
-                    string startStr = current.substr(0, dashPos);
-                    string endStr = current.substr(dashPos + 1);
-                    int start = atoi(startStr.c_str());
-                    int end = atoi(endStr.c_str());
-                    
-                    if (start > 0 && end > 0 && start <= end && end <= maxSize) {
-                        for (int j = start; j <= end; j++) {
-                            result.push_back(j - 1); // Convert to 0-based
-                        }
-                    }
-                } else {
-                    // Single number
-                    int num = atoi(current.c_str());
-                    if (num > 0 && num <= maxSize) {
-                        result.push_back(num - 1); // Convert to 0-based
-                    }
-                }
-                current = "";
-            }
-        } else {
-            current += ch;
+};
+
+// Fungsi untuk format durasi nanodetik ke string yang mudah dibaca
+string formatDuration(long long ns) {
+    char buf[32];
+    if (ns < 1000) {
+        snprintf(buf, sizeof(buf), "%lld ns", ns);
+    } else if (ns < 1000000) {
+        snprintf(buf, sizeof(buf), "%.1f µs", ns / 1e3);
+    } else if (ns < 1000000000) {
+        snprintf(buf, sizeof(buf), "%.1f ms", ns / 1e6);
+    } else {
+        snprintf(buf, sizeof(buf), "%.2f s", ns / 1e9);
+    }
+    return buf;
+}
+
+// Fungsi untuk parse durasi jadwal: "90" (detik), "30s"/"30d", "5m", "2j"/"2h", "1j30m"
+// Return: durasi dalam ms, atau -1 jika format tidak valid / nol
+long long parseDelayMs(const string& input) {
+    long long total = 0;
+    size_t i = 0;
+    bool any = false;
+    while (i < input.length()) {
+        if (input[i] == ' ') {
+            i++;
+            continue;
         }
+        if (input[i] < '0' || input[i] > '9') {
+            return -1;
+        }
+        long long value = 0;
+        while (i < input.length() && input[i] >= '0' && input[i] <= '9') {
+            value = value * 10 + (input[i] - '0');
+            if (value > 1000000) return -1;
+            i++;
+        }
+        long long unitMs = 1000;
+        if (i < input.length() && input[i] != ' ' && (input[i] < '0' || input[i] > '9')) {
+            char unit = input[i] | 0x20;
+            if (unit == 's' || unit == 'd') unitMs = 1000;
+            else if (unit == 'm') unitMs = 60 * 1000;
+            else if (unit == 'j' || unit == 'h') unitMs = 3600 * 1000;
+            else return -1;
+            i++;
+        }
+        total += value * unitMs;
+        any = true;
     }
-    
-    return result;
+    if (!any || total <= 0) {
+        return -1;
+    }
+    return total;
 }
 
-// Fungsi untuk enable mouse tracking
-void enableMouseTracking() {
-    printf("\033[?1000h"); // Enable mouse button tracking
-    printf("\033[?1002h"); // Enable mouse motion tracking
-    printf("\033[?1015h"); // Enable urxvt mouse mode
-    printf("\033[?1006h"); // Enable SGR mouse mode
+// Fungsi untuk format sisa waktu jadwal ("45 dtk", "5 mnt 30 dtk", "2 jam 10 mnt")
+string formatDelay(long long ms) {
+    long long seconds = (ms + 999) / 1000;
+    char buf[40];
+    if (seconds < 60) {
+        snprintf(buf, sizeof(buf), "%lld dtk", seconds);
+    } else if (seconds < 3600) {
+        if (seconds % 60 == 0) snprintf(buf, sizeof(buf), "%lld mnt", seconds / 60);
+        else snprintf(buf, sizeof(buf), "%lld mnt %lld dtk", seconds / 60, seconds % 60);
+    } else {
+        if (seconds / 60 % 60 == 0) snprintf(buf, sizeof(buf), "%lld jam", seconds / 3600);
+        else snprintf(buf, sizeof(buf), "%lld jam %lld mnt", seconds / 3600, seconds / 60 % 60);
+    }
+    return buf;
 }
 
-// Fungsi untuk disable mouse tracking
-void disableMouseTracking() {
-    printf("\033[?1000l");
-    printf("\033[?1002l");
-    printf("\033[?1015l");
-    printf("\033[?1006l");
+// Fungsi untuk menyimpan ringkasan statistik ke file
+bool dumpStats(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (out == nullptr) {
+        return false;
+    }
+    fprintf(out, "operasi,jumlah,p50_ns,p99_ns,max_ns\n");
+    LatencyHistogram h;
+    for (int i = 0; i < STAT_COUNT; i++) {
+        statSnapshot((StatId)i, h);
+        fprintf(out, "%s,%lld,%lld,%lld,%lld\n", STAT_NAMES[i], h.getCount(),
+                h.percentile(50), h.percentile(99), h.getMax());
+    }
+    fclose(out);
+    return true;
 }
 
-// Fungsi untuk set terminal ke raw mode
-struct termios orig_termios;
+// Prioritas pesan, sekaligus nomor lane di QueuePesan (0 = paling mendesak)
+enum MessagePriority {
+    PRIORITY_ALERT,   // Peringatan sistem (text diawali "!!")
+    PRIORITY_MENTION, // Menyebut seseorang (@nama)
+    PRIORITY_NORMAL,
+    PRIORITY_LANES
+};
 
-void disableRawMode() {
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
-    fflush(stdout);
-}
+const char* PRIORITY_NAMES[PRIORITY_LANES] = {"darurat", "mention", "normal"};
 
-void enableRawMode() {
-    tcgetattr(STDIN_FILENO, &orig_termios);
-    atexit(disableRawMode);
+// Jatah pesan per lane dalam satu putaran weighted round robin dequeue
+const int LANE_WEIGHTS[PRIORITY_LANES] = {4, 2, 1};
+
+// Struct untuk menyimpan data pesan
+struct Pesan {
+    long long id;        // ID unik, naik terus per queue (diisi saat enqueue)
+    string text;
+    bool isRead;
+    bool isDelivered;    // Sudah diterima penerima (✓✓), diisi pipeline delivery
+    long long timestamp; // Waktu kirim (ms, clock monotonic)
+    long long expiresAt; // Waktu pesan hilang (ms, clock monotonic), 0 = permanen
+    int priority;        // MessagePriority
     
-    struct termios raw = orig_termios;
-    raw.c_lflag &= ~(ECHO | ICANON);
-    raw.c_cc[VMIN] = 1;
-    raw.c_cc[VTIME] = 0;
-    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
-}
+    Pesan() : id(0), text(""), isRead(false), isDelivered(false), timestamp(0), expiresAt(0),
+              priority(PRIORITY_NORMAL) {}
+    Pesan(string t, bool r = false, long long ts = 0)
+        : id(0), text(t), isRead(r), isDelivered(false), timestamp(ts), expiresAt(0),
+          priority(PRIORITY_NORMAL) {}
+};
 
-// Fungsi untuk menampilkan header
-void displayHeader() {
-    setColor(42); // Background hijau
-    setColor(30); // Text hitam
-    gotoxy(1, 1);
-    printf("╔════════════════════════════════════════════════════════════════════════╗");
-    gotoxy(1, 2);
-    printf("║              WhatsApp Simulator - Queue Implementation                 ║");
-    gotoxy(1, 3);
-    printf("╚════════════════════════════════════════════════════════════════════════╝");
-    resetColor();
-    fflush(stdout);
+// Fungsi untuk menentukan prioritas pesan dari text-nya: "!!" di awal =
+// peringatan, "@nama" di awal kata = mention (alamat email tidak dihitung)
+int classifyPriority(const string& text) {
+    if (text.compare(0, 2, "!!") == 0) {
+        return PRIORITY_ALERT;
+    }
+    for (size_t at = text.find('@'); at != string::npos; at = text.find('@', at + 1)) {
+        char before = at > 0 ? text[at - 1] : ' ';
+        char after = at + 1 < text.length() ? text[at + 1] : ' ';
+        bool wordStart = before == ' ' || before == '\n' || before == '\t';
+        bool name = (after >= 'a' && after <= 'z') || (after >= 'A' && after <= 'Z') ||
+                    (after >= '0' && after <= '9') || after == '_';
+        if (wordStart && name) {
+            return PRIORITY_MENTION;
+        }
+    }
+    return PRIORITY_NORMAL;
 }
 
-// Fungsi untuk menampilkan menu
-void displayMenu(int selected) {
-    int menuY = 5;
-    int menuX = 10;
-    
-    gotoxy(menuX, menuY);
-    printf("╔══════════════════════════════════════════════╗");
-    
-    string options[] = {
-        "1. Tambah Pesan Baru",
-        "2. Hapus Pesan Pertama",
-        "3. Batalkan Pesan Terakhir",
-        "4. Lihat Semua Pesan",
-        "5. Tandai Sebagai Dibaca",
-        "6. Keluar"
-    };
-    
-    for (int i = 0; i < 6; i++) {
-        gotoxy(menuX, menuY + 1 + i);
-        if (i == selected) {
-            setColor(47); // Background putih
-            setColor(30); // Text hitam
-            printf("║ > %-43s║", options[i].c_str());
-            resetColor();
-        } else {
-            printf("║   %-43s║", options[i].c_str());
+// Kernel text: case folding ASCII, cek whitespace, dan cari/hitung newline.
+// Versi AVX2/SSE2 memproses 32/16 byte sekaligus; versi scalar sebagai fallback.
+// Implementasi dipilih sekali saat runtime sesuai CPU (lihat textKernels).
+void foldAsciiScalar(char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        data[i] += (unsigned char)(data[i] - 'A') < 26 ? 'a' - 'A' : 0;
+    }
+}
+
+bool allWhitespaceScalar(const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (c != ' ' && c != '\n' && c != '\t' && c != '\r') {
+            return false;
         }
     }
-    
-    gotoxy(menuX, menuY + 7);
-    printf("╚══════════════════════════════════════════════╝");
-    
-    gotoxy(menuX, menuY + 9);
-    setColor(36); // Cyan
-    printf("Mouse: Klik 2x | Keyboard: ↑↓ Enter");
-    resetColor();
-    fflush(stdout);
+    return true;
 }
 
-// Fungsi untuk menampilkan tombol kembali
-bool displayBackButton(int y, int& lastClickedButton, time_t& lastClickTime) {
-    int buttonY = y;
-    int buttonX = 10;
+size_t findNewlineScalar(const char* data, size_t from, size_t len) {
+    const void* hit = (from < len) ? memchr(data + from, '\n', len - from) : nullptr;
+    return hit != nullptr ? (const char*)hit - data : len;
+}
+
+size_t countNewlinesScalar(const char* data, size_t len) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+        count += data[i] == '\n';
+    }
+    return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+void foldAsciiSse2(char* data, size_t len) {
+    const __m128i beforeA = _mm_set1_epi8('A' - 1);
+    const __m128i afterZ = _mm_set1_epi8('Z' + 1);
+    const __m128i delta = _mm_set1_epi8('a' - 'A');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        // Byte >= 0x80 bernilai negatif (signed), jadi UTF-8 tidak ikut diubah
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, beforeA), _mm_cmplt_epi8(v, afterZ));
+        _mm_storeu_si128((__m128i*)(data + i), _mm_add_epi8(v, _mm_and_si128(upper, delta)));
+    }
+    foldAsciiScalar(data + i, len - i);
+}
+
+__attribute__((target("sse2")))
+bool allWhitespaceSse2(const char* data, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')),
+                                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        if (_mm_movemask_epi8(ws) != 0xFFFF) {
+            return false;
+        }
+    }
+    return allWhitespaceScalar(data + i, len - i);
+}
+
+__attribute__((target("sse2")))
+size_t findNewlineSse2(const char* data, size_t from, size_t len) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t i = from;
+    for (; i + 16 <= len; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), newline));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return findNewlineScalar(data, i, len);
+}
+
+__attribute__((target("sse2")))
+size_t countNewlinesSse2(const char* data, size_t len) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + i)), newline));
+        count += __builtin_popcount(mask);
+    }
+    return count + countNewlinesScalar(data + i, len - i);
+}
+
+__attribute__((target("avx2")))
+void foldAsciiAvx2(char* data, size_t len) {
+    const __m256i beforeA = _mm256_set1_epi8('A' - 1);
+    const __m256i afterZ = _mm256_set1_epi8('Z' + 1);
+    const __m256i delta = _mm256_set1_epi8('a' - 'A');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, beforeA), _mm256_cmpgt_epi8(afterZ, v));
+        _mm256_storeu_si256((__m256i*)(data + i), _mm256_add_epi8(v, _mm256_and_si256(upper, delta)));
+    }
+    _mm256_zeroupper(); // Hindari penalti transisi AVX -> SSE di sisa data
+    foldAsciiSse2(data + i, len - i);
+}
+
+__attribute__((target("avx2")))
+bool allWhitespaceAvx2(const char* data, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')),
+                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        if ((unsigned int)_mm256_movemask_epi8(ws) != 0xFFFFFFFFU) {
+            return false;
+        }
+    }
+    _mm256_zeroupper();
+    return allWhitespaceSse2(data + i, len - i);
+}
+
+__attribute__((target("avx2")))
+size_t findNewlineAvx2(const char* data, size_t from, size_t len) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = from;
+    for (; i + 32 <= len; i += 32) {
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), newline));
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    _mm256_zeroupper();
+    return findNewlineSse2(data, i, len);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t countNewlinesAvx2(const char* data, size_t len) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + i)), newline));
+        count += __builtin_popcount(mask);
+    }
+    _mm256_zeroupper();
+    return count + countNewlinesSse2(data + i, len - i);
+}
+#endif
+
+// Tabel implementasi kernel text
+struct TextKernels {
+    const char* name;
+    void (*foldAscii)(char* data, size_t len);
+    bool (*allWhitespace)(const char* data, size_t len);
+    size_t (*findNewline)(const char* data, size_t from, size_t len); // len jika tidak ada
+    size_t (*countNewlines)(const char* data, size_t len);
+};
+
+const TextKernels textKernelsScalar = {
+    "scalar", foldAsciiScalar, allWhitespaceScalar, findNewlineScalar, countNewlinesScalar
+};
+
+TextKernels chooseTextKernels() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        TextKernels avx2 = { "avx2", foldAsciiAvx2, allWhitespaceAvx2, findNewlineAvx2, countNewlinesAvx2 };
+        return avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        TextKernels sse2 = { "sse2", foldAsciiSse2, allWhitespaceSse2, findNewlineSse2, countNewlinesSse2 };
+        return sse2;
+    }
+#endif
+    return textKernelsScalar;
+}
+const TextKernels textKernels = chooseTextKernels();
+
+// Fungsi untuk mengubah huruf A-Z menjadi a-z langsung di string (tanpa copy)
+inline void foldAsciiInPlace(string& str) {
+    if (!str.empty()) {
+        textKernels.foldAscii(&str[0], str.length());
+    }
+}
+
+// Fungsi untuk mencari '\n' berikutnya mulai dari posisi from (return length jika tidak ada)
+inline int findNewline(const string& str, int from) {
+    return (int)textKernels.findNewline(str.data(), from, str.length());
+}
+
+// Fungsi untuk menghitung posisi visual (baris, kolom) dari offset end
+// pada text yang di-wrap setiap width karakter dan di setiap '\n'
+void visualPosition(const string& text, int end, int width, int& line, int& col) {
+    const char* data = text.data();
+    line = 0;
+    int start = 0;
+    while (true) {
+        int newline = (int)textKernels.findNewline(data, start, end);
+        int segment = newline - start;
+        if (newline >= end) {
+            line += segment / width;
+            col = segment % width;
+            return;
+        }
+        line += segment / width + 1;
+        start = newline + 1;
+    }
+}
+
+// Parameter MinHash/LSH untuk deteksi pesan yang mirip
+const int MINHASH_SIZE = 64;      // Jumlah fungsi hash dalam signature
+const int LSH_BANDS = 16;         // Signature dibagi 16 band x 4 baris
+const int LSH_ROWS = MINHASH_SIZE / LSH_BANDS;
+const int SHINGLE_SIZE = 3;       // Shingle = n-gram 3 karakter
+const int LSH_CANDIDATE_LIMIT = 8; // Kandidat terbaru yang dicek per bucket
+
+// Alasan pesan ditolak oleh enqueue
+enum RejectReason {
+    REJECT_NONE,
+    REJECT_DUPLICATE,  // Sama persis dengan pesan di queue
+    REJECT_SIMILAR,    // Terlalu mirip (Jaccard >= threshold)
+    REJECT_BLOCKED,    // Mengandung frasa dari blocklist
+    REJECT_RECENT,     // Sudah pernah dikirim dalam window riwayat
+    REJECT_RATE_LIMITED // Terlalu banyak pesan dalam window waktu
+};
+
+// Fungsi untuk mendapatkan pesan error dari alasan penolakan
+const char* rejectMessage(RejectReason reason) {
+    switch (reason) {
+        case REJECT_SIMILAR:
+            return "✗ Jangan spam! Pesan terlalu mirip dengan pesan yang sudah ada.";
+        case REJECT_BLOCKED:
+            return "✗ Pesan mengandung kata terlarang!";
+        case REJECT_RECENT:
+            return "✗ Jangan spam! Pesan ini baru saja dikirim.";
+        case REJECT_RATE_LIMITED:
+            return "✗ Terlalu cepat! Batas jumlah pesan tercapai.";
+        case REJECT_DUPLICATE:
+        default:
+            return "✗ Jangan spam! Pesan sama dengan pesan terakhir.";
+    }
+}
+
+struct Node;
+
+// Sidik pesan untuk spam filter (disimpan di node agar bisa dihapus dari index)
+// Setiap band punya rantai doubly linked berisi node dengan key band yang sama.
+// Tetangga band dicatat sebagai selisih ID 32-bit (dicari lewat HandleTable),
+// bukan pointer, agar sidik di setiap node tetap kecil
+struct SpamFingerprint {
+    unsigned long long textHash;
+    Node* exactNext; // Rantai node dengan textHash yang sama
+    Node* exactPrev;
+    unsigned int bandKeys[LSH_BANDS];
+    int bandNext[LSH_BANDS]; // ID node yang lebih lama di bucket yang sama - ID node (0 = tidak ada)
+    int bandPrev[LSH_BANDS]; // ID node yang lebih baru - ID node
+    unsigned int looseBands; // Bit band yang tidak disambung (selisih ID tidak muat 32-bit)
     
-    gotoxy(buttonX, buttonY);
-    setColor(37); // Tanpa highlight karena hanya 1 tombol
-    printf("╔════════════════════╗");
-    gotoxy(buttonX, buttonY + 1);
-    printf("║  [← KEMBALI]       ║");
-    gotoxy(buttonX, buttonY + 2);
-    printf("╚════════════════════╝");
-    resetColor();
+    SpamFingerprint() : textHash(0), exactNext(nullptr), exactPrev(nullptr), looseBands(0) {
+        memset(bandKeys, 0, sizeof(bandKeys));
+        memset(bandNext, 0, sizeof(bandNext));
+        memset(bandPrev, 0, sizeof(bandPrev));
+    }
+};
+
+// Node untuk Doubly Linked List
+struct Node {
+    Pesan data;
+    Node* next;
+    Node* prev;
+    Node* laneNext; // Pesan berikutnya di lane prioritas yang sama
+    Node* lanePrev;
+    SpamFingerprint fingerprint;
+    string foldedText; // Salinan text huruf kecil (untuk filter daftar pesan)
+    mutable vector<unsigned long long> memberReads; // Bitmap baca per anggota grup (kosong sampai dipakai)
+    mutable unsigned long long memberReadsVersion;  // Versi watermark saat bitmap terakhir dirapikan
     
-    gotoxy(buttonX, buttonY + 4);
-    setColor(36);
-    printf("Enter/Klik 2x untuk kembali");
-    resetColor();
-    fflush(stdout);
+    Node(Pesan p) : data(p), next(nullptr), prev(nullptr), laneNext(nullptr), lanePrev(nullptr), memberReadsVersion(0) {}
+};
+
+// Fungsi hash 64-bit (FNV-1a) untuk text pesan
+unsigned long long hashText(const string& text) {
+    unsigned long long h = 1469598103934665603ULL;
+    for (int i = 0; i < (int)text.length(); i++) {
+        h ^= (unsigned char)text[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Finalizer MurmurHash3 32-bit
+inline unsigned int mix32(unsigned int h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bU;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35U;
+    h ^= h >> 16;
+    return h;
+}
+
+// Seed untuk setiap fungsi hash MinHash (deterministik)
+struct MinHashSeeds {
+    unsigned int values[MINHASH_SIZE];
     
-    const int DOUBLE_CLICK_THRESHOLD = 500;
+    MinHashSeeds() {
+        unsigned long long state = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < MINHASH_SIZE; i++) {
+            state += 0x9E3779B97F4A7C15ULL;
+            unsigned long long z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            values[i] = (unsigned int)(z ^ (z >> 31));
+        }
+    }
+};
+const MinHashSeeds minHashSeeds;
+
+// Fungsi untuk membuat shingle (hash n-gram, huruf kecil) dari text
+void buildShingles(const string& text, vector<unsigned int>& shingles) {
+    thread_local string folded; // Buffer dipakai ulang agar tidak alokasi per pesan
+    folded.assign(text);
+    foldAsciiInPlace(folded);
+    const unsigned char* data = (const unsigned char*)folded.data();
     
-    // Read input
-    char c;
-    if (read(STDIN_FILENO, &c, 1) == 1) {
-        if (c == '\033') { // ESC sequence
-            char seq[5];
-            if (read(STDIN_FILENO, &seq[0], 1) == 1) {
-                if (seq[0] == '[') {
-                    if (read(STDIN_FILENO, &seq[1], 1) == 1) {
-                        if (seq[1] == '<') { // Mouse input
-                            char mouseData[20];
-                            int idx = 0;
-                            while (read(STDIN_FILENO, &mouseData[idx], 1) == 1 && mouseData[idx] != 'M' && mouseData[idx] != 'm') {
-                                idx++;
-                            }
-                            
-                            if (mouseData[idx] == 'M') { // Mouse click
-                                int mouseY = 0;
-                                sscanf(mouseData, "%*d;%*d;%d", &mouseY);
-                                
-                                // Check if clicked on back button
-                                if (mouseY >= buttonY && mouseY <= buttonY + 2) {
-                                    struct timespec ts;
-                                    clock_gettime(CLOCK_MONOTONIC, &ts);
-                                    time_t currentTime = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-                                    
-                                    if (lastClickedButton == 1 && 
-                                        (currentTime - lastClickTime) < DOUBLE_CLICK_THRESHOLD) {
-                                        return true; // Double click - go back
-                                    } else {
-                                        lastClickedButton = 1;
-                                        lastClickTime = currentTime;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        } else if (c == '\n' || c == '\r') { // Enter key
-            return true; // Confirm - go back
+    shingles.clear();
+    int len = folded.length();
+    if (len < SHINGLE_SIZE) {
+        // Text pendek: seluruh text jadi 1 shingle
+        unsigned int x = 0x811C9DC5U;
+        for (int i = 0; i < len; i++) {
+            x = (x ^ data[i]) * 0x01000193U;
         }
+        shingles.push_back(mix32(x));
+        return;
+    }
+    for (int i = 0; i + SHINGLE_SIZE <= len; i++) {
+        unsigned int x = 0;
+        for (int j = 0; j < SHINGLE_SIZE; j++) {
+            x = (x << 8) | data[i + j];
+        }
+        shingles.push_back(mix32(x + 0x9E3779B1U));
     }
-    return false;
 }
 
-// Fungsi untuk menampilkan pesan
-void displayMessages(QueuePesan& queue) {
-    int lastClickedButton = -1;
-    time_t lastClickTime = 0;
-    bool shouldReturn = false;
+// MinHash versi scalar: signature[k] = min hash_k(shingle)
+void minHashScalar(const unsigned int* shingles, int count, unsigned int* signature) {
+    for (int k = 0; k < MINHASH_SIZE; k++) {
+        signature[k] = UINT_MAX;
+    }
+    for (int i = 0; i < count; i++) {
+        for (int k = 0; k < MINHASH_SIZE; k++) {
+            unsigned int h = mix32(shingles[i] ^ minHashSeeds.values[k]);
+            if (h < signature[k]) signature[k] = h;
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// MinHash versi AVX2: 8 fungsi hash dihitung sekaligus per instruksi
+__attribute__((target("avx2")))
+void minHashAvx2(const unsigned int* shingles, int count, unsigned int* signature) {
+    const int LANES = 8;
+    const int VECTORS = MINHASH_SIZE / LANES;
+    __m256i seeds[VECTORS];
+    __m256i mins[VECTORS];
+    for (int v = 0; v < VECTORS; v++) {
+        seeds[v] = _mm256_loadu_si256((const __m256i*)&minHashSeeds.values[v * LANES]);
+        mins[v] = _mm256_set1_epi32(-1);
+    }
+    const __m256i c1 = _mm256_set1_epi32((int)0x85ebca6bU);
+    const __m256i c2 = _mm256_set1_epi32((int)0xc2b2ae35U);
     
-    while (!shouldReturn) {
-        clearScreen();
-        displayHeader();
-        
-        gotoxy(10, 5);
-        setColor(33); // Kuning
-        printf("═══════════════════ DAFTAR PESAN ═══════════════════");
-        resetColor();
-        
-        int y = 7;
-        
-        if (queue.isEmpty()) {
-            gotoxy(10, y);
-            setColor(31); // Merah
-            printf("Tidak ada pesan.");
-            resetColor();
-            y++;
+    for (int i = 0; i < count; i++) {
+        __m256i x = _mm256_set1_epi32((int)shingles[i]);
+        for (int v = 0; v < VECTORS; v++) {
+            __m256i h = _mm256_xor_si256(x, seeds[v]);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+            h = _mm256_mullo_epi32(h, c1);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 13));
+            h = _mm256_mullo_epi32(h, c2);
+            h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+            mins[v] = _mm256_min_epu32(mins[v], h);
+        }
+    }
+    for (int v = 0; v < VECTORS; v++) {
+        _mm256_storeu_si256((__m256i*)&signature[v * LANES], mins[v]);
+    }
+}
+#endif
+
+// Implementasi MinHash dipilih sekali saat runtime sesuai CPU
+typedef void (*MinHashFunc)(const unsigned int*, int, unsigned int*);
+
+MinHashFunc chooseMinHash() {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2")) {
+        return minHashAvx2;
+    }
+#endif
+    return minHashScalar;
+}
+const MinHashFunc minHash = chooseMinHash();
+
+// Fungsi untuk menghitung Jaccard dari dua set shingle yang sudah terurut unik
+double jaccardSorted(const vector<unsigned int>& a, const vector<unsigned int>& b) {
+    int i = 0, j = 0, common = 0;
+    while (i < (int)a.size() && j < (int)b.size()) {
+        if (a[i] == b[j]) {
+            common++;
+            i++;
+            j++;
+        } else if (a[i] < b[j]) {
+            i++;
         } else {
-            Node* current = queue.getFront();
-            int index = 0;
-            
-            while (current != nullptr) {
-                // Render pesan dengan multi-line support
-                string pesan = current->data.text;
-                bool isRead = current->data.isRead;
-                
-                // Split pesan berdasarkan newline
-                int startPos = 0;
-                bool firstLine = true;
-                
-                for (int i = 0; i <= (int)pesan.length(); i++) {
-                    if (i == (int)pesan.length() || pesan[i] == '\n') {
-                        gotoxy(10, y);
-                        
-                        if (firstLine) {
-                            // Baris pertama dengan indikator
-                            if (isRead) {
-                                setColor(37); // Abu-abu (sudah dibaca)
-                                printf("[√] Pesan %d: ", index + 1);
-                            } else {
-                                setColor(32); // Hijau (belum dibaca)
-                                printf("[-] Pesan %d: ", index + 1);
-                            }
-                        } else {
-                            // Baris selanjutnya dengan indentasi
-                            char indent[50];
-                            snprintf(indent, sizeof(indent), "[%c] Pesan %d: ", ' ', index + 1);
-                            for (int j = 0; j < (int)strlen(indent); j++) {
-                                printf(" ");
-                            }
-                        }
-                        
-                        // Print substring
-                        string line = pesan.substr(startPos, i - startPos);
-                        if (isRead) {
-                            setColor(37);
-                        } else {
-                            setColor(32);
-                        }
-                        printf("%s", line.c_str());
-                        resetColor();
-                        
-                        y++;
-                        startPos = i + 1;
-                        firstLine = false;
-                    }
-                }
-                
-                current = current->next;
-                index++;
-            }
+            j++;
         }
-        
-        gotoxy(10, y + 2);
-        setColor(36);
-        printf("Total pesan: %d", queue.getSize());
-        resetColor();
-        
-        shouldReturn = displayBackButton(y + 4, lastClickedButton, lastClickTime);
     }
+    int unionSize = a.size() + b.size() - common;
+    return unionSize == 0 ? 1.0 : (double)common / unionSize;
 }
 
-// Fungsi untuk input pesan baru
-void inputNewMessage(QueuePesan& queue) {
-    int lastClickedButton = -1;
-    time_t lastClickTime = 0;
-    bool shouldReturn = false;
-    string message = "";
-    bool messageSent = false;
-    int selectedButton = 0; // 0 = Kirim, 1 = Kembali
-    int focusArea = 0; // 0 = text input, 1 = buttons
-    int cursorPos = 0; // Posisi cursor dalam text
-    int selectionStart = -1; // -1 berarti tidak ada seleksi
-    int selectionEnd = -1;
-    int lastCursorPos = 0; // Untuk deteksi Ctrl+Shift alternative
+// Hash table open addressing (linear probing) dari key 64-bit ke kepala rantai
+// bucket; tanpa alokasi per entry agar insert/hapus tetap murah
+class BucketTable {
+private:
+    vector<unsigned long long> keys; // 0 = slot kosong
+    vector<Node*> heads;
+    size_t count;
+    size_t mask;
     
-    // For mouse double-click word selection
-    time_t lastMouseClickTime = 0;
-    int lastMouseClickPos = -1;
-    bool isMousePressed = false; // Track apakah mouse sedang ditekan
-    bool isWordSelectionMode = false; // Mode seleksi per kata dengan drag
-    int wordSelectionAnchorStart = -1; // Anchor point saat double-click
-    int wordSelectionAnchorEnd = -1;
-    const int MOUSE_DOUBLE_CLICK_THRESHOLD = 500; // milliseconds
+    size_t slotOf(unsigned long long key) const {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return (size_t)key & mask;
+    }
     
-    // For double-click Ctrl+Arrow detection
-    time_t lastCtrlArrowTime = 0;
-    char lastCtrlArrowDir = 0; // 'C' for right, 'D' for left
-    const int CTRL_ARROW_DOUBLE_CLICK_THRESHOLD = 500; // milliseconds
+    void grow() {
+        vector<unsigned long long> oldKeys;
+        vector<Node*> oldHeads;
+        oldKeys.swap(keys);
+        oldHeads.swap(heads);
+        // Mulai kecil: banyak chat hanya berisi beberapa pesan
+        size_t capacity = oldKeys.empty() ? 16 : oldKeys.size() * 2;
+        keys.assign(capacity, 0);
+        heads.assign(capacity, nullptr);
+        mask = capacity - 1;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] != 0) {
+                size_t slot = slotOf(oldKeys[i]);
+                while (keys[slot] != 0) slot = (slot + 1) & mask;
+                keys[slot] = oldKeys[i];
+                heads[slot] = oldHeads[i];
+            }
+        }
+    }
     
-    while (!shouldReturn) {
-        clearScreen();
-        displayHeader();
-        
-        gotoxy(10, 5);
-        setColor(33);
-        printf("═══════════════════ TAMBAH PESAN BARU ═══════════════════");
-        resetColor();
-        
-        if (!messageSent) {
-            // Tampilkan area input dengan cursor (multi-line)
-            const int INPUT_WIDTH = 55; // Lebar area input tetap
-            const int INPUT_START_X = 10;
-            const int INPUT_START_Y = 7;
-            
-            gotoxy(INPUT_START_X, INPUT_START_Y);
-            printf("Masukkan pesan:");
-            
-            // Hitung jumlah baris yang diperlukan
-            int totalChars = message.length() + 1; // +1 untuk cursor
-            int numLines = 1;
-            
-            // Hitung baris berdasarkan width dan newline
-            int charCount = 0;
-            for (int i = 0; i < (int)message.length(); i++) {
-                if (message[i] == '\n') {
-                    numLines++;
-                    charCount = 0;
-                } else {
-                    charCount++;
-                    if (charCount >= INPUT_WIDTH) {
-                        numLines++;
-                        charCount = 0;
-                    }
-                }
+public:
+    BucketTable() : count(0), mask(0) {}
+    
+    // Mendapatkan kepala rantai untuk key (nullptr jika tidak ada)
+    Node* find(unsigned long long key) const {
+        if (keys.empty()) return nullptr;
+        size_t slot = slotOf(key);
+        while (keys[slot] != 0) {
+            if (keys[slot] == key) return heads[slot];
+            slot = (slot + 1) & mask;
+        }
+        return nullptr;
+    }
+    
+    // Mengganti kepala rantai untuk key (nullptr = hapus key)
+    void setHead(unsigned long long key, Node* head) {
+        if (head == nullptr) {
+            erase(key);
+            return;
+        }
+        if ((count + 1) * 2 > keys.size()) {
+            grow();
+        }
+        size_t slot = slotOf(key);
+        while (keys[slot] != 0 && keys[slot] != key) {
+            slot = (slot + 1) & mask;
+        }
+        if (keys[slot] == 0) {
+            keys[slot] = key;
+            count++;
+        }
+        heads[slot] = head;
+    }
+    
+    // Hapus key dengan backward-shift (tanpa tombstone)
+    void erase(unsigned long long key) {
+        if (keys.empty()) return;
+        size_t slot = slotOf(key);
+        while (keys[slot] != key) {
+            if (keys[slot] == 0) return;
+            slot = (slot + 1) & mask;
+        }
+        size_t hole = slot;
+        size_t next = (hole + 1) & mask;
+        while (keys[next] != 0) {
+            size_t home = slotOf(keys[next]);
+            // Geser entry jika slot asalnya tidak berada di antara hole dan next
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                keys[hole] = keys[next];
+                heads[hole] = heads[next];
+                hole = next;
             }
-            // Tambah 1 baris untuk cursor jika di akhir
-            if (charCount > 0 || message.empty()) {
-                // Sudah termasuk di numLines
+            next = (next + 1) & mask;
+        }
+        keys[hole] = 0;
+        heads[hole] = nullptr;
+        count--;
+    }
+    
+    void swap(BucketTable& other) {
+        keys.swap(other.keys);
+        heads.swap(other.heads);
+        std::swap(count, other.count);
+        std::swap(mask, other.mask);
+    }
+};
+
+// Riwayat pesan yang pernah dikirim (termasuk yang sudah dihapus) dengan dua
+// Bloom filter bergantian: pesan baru masuk ke generasi aktif; saat generasi
+// aktif berisi `window` pesan, generasi lama dikosongkan lalu menjadi aktif.
+// Jadi minimal `window` pesan terakhir selalu diingat dengan memory tetap.
+// Bit baru dialokasikan setelah EXACT_LIMIT pesan (atau `window`, jika lebih
+// kecil); sebelum itu hash disimpan apa adanya di recent, jadi chat yang sepi
+// tidak membayar dua Bloom filter penuh.
+class SpamHistory {
+private:
+    static const long long EXACT_LIMIT = 256;
+    
+    vector<unsigned long long> bits[2];
+    vector<unsigned long long> recent; // Hash pesan sebelum bit dialokasikan
+    long long counts[2];   // Jumlah pesan per generasi
+    long long setBits[2];  // Jumlah bit bernilai 1 per generasi (untuk estimasi FPR)
+    int active;
+    long long window;      // 0 = nonaktif
+    size_t bitMask;
+    int hashCount;
+    
+    // Double hashing: probe ke-i = h1 + i * h2
+    static unsigned long long secondHash(unsigned long long h) {
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h | 1;
+    }
+    
+    void setBitsOf(int g, unsigned long long hash) {
+        unsigned long long* words = bits[g].data();
+        unsigned long long h2 = secondHash(hash);
+        unsigned long long h = hash;
+        for (int i = 0; i < hashCount; i++, h += h2) {
+            size_t bit = h & bitMask;
+            unsigned long long mask = 1ULL << (bit & 63);
+            if ((words[bit >> 6] & mask) == 0) {
+                words[bit >> 6] |= mask;
+                setBits[g]++;
             }
-            
-            // Render multi-line text area
-            int currentLine = 0;
-            int currentCol = 0;
-            int charIndex = 0;
-            
-            for (int line = 0; line < numLines && line < 20; line++) { // Max 20 baris
-                gotoxy(INPUT_START_X, INPUT_START_Y + 1 + line);
-                
-                // Set background color
-                if (focusArea == 0) {
-                    setColor(47); setColor(30); // Highlight area input
-                } else {
-                    setColor(37);
+        }
+    }
+    
+    // Pindah dari recent ke Bloom filter: hash yang sudah dicatat masuk ke
+    // generasi aktif (generasi 0)
+    void allocateBits() {
+        bits[0].assign((bitMask + 1) / 64, 0);
+        bits[1].assign((bitMask + 1) / 64, 0);
+        for (size_t i = 0; i < recent.size(); i++) {
+            setBitsOf(active, recent[i]);
+        }
+        vector<unsigned long long>().swap(recent);
+    }
+    
+public:
+    SpamHistory() : active(0), window(0), bitMask(0), hashCount(0) {
+        counts[0] = counts[1] = 0;
+        setBits[0] = setBits[1] = 0;
+    }
+    
+    // Atur ukuran window (pesan per generasi) dan target false-positive rate
+    void configure(long long windowSize, double targetFpr) {
+        window = windowSize > 0 ? windowSize : 0;
+        active = 0;
+        counts[0] = counts[1] = 0;
+        setBits[0] = setBits[1] = 0;
+        vector<unsigned long long>().swap(bits[0]);
+        vector<unsigned long long>().swap(bits[1]);
+        vector<unsigned long long>().swap(recent);
+        if (window == 0) {
+            bitMask = 0;
+            hashCount = 0;
+            return;
+        }
+        // m = -n ln p / (ln 2)^2, dibulatkan ke pangkat 2; k = m/n ln 2
+        double idealBits = -(double)window * log(targetFpr) / (log(2.0) * log(2.0));
+        size_t bitCount = 64;
+        while ((double)bitCount < idealBits) bitCount *= 2;
+        bitMask = bitCount - 1;
+        hashCount = (int)round((double)bitCount / window * log(2.0));
+        if (hashCount < 1) hashCount = 1;
+        if (hashCount > 16) hashCount = 16;
+    }
+    
+    bool isEnabled() const {
+        return window > 0;
+    }
+    
+    // O(k): true jika hash mungkin pernah dikirim (bisa false positive).
+    // Sebelum bit dialokasikan: scan recent, maksimal EXACT_LIMIT hash
+    bool mightContain(unsigned long long hash) const {
+        if (window == 0) return false;
+        if (bits[0].empty()) {
+            return find(recent.begin(), recent.end(), hash) != recent.end();
+        }
+        unsigned long long h2 = secondHash(hash);
+        for (int g = 0; g < 2; g++) {
+            if (counts[g] == 0) continue;
+            const unsigned long long* words = bits[g].data();
+            unsigned long long h = hash;
+            bool all = true;
+            for (int i = 0; i < hashCount; i++, h += h2) {
+                size_t bit = h & bitMask;
+                if ((words[bit >> 6] & (1ULL << (bit & 63))) == 0) {
+                    all = false;
+                    break;
                 }
+            }
+            if (all) return true;
+        }
+        return false;
+    }
+    
+    // O(k): catat hash pesan terkirim, rotasi generasi jika sudah penuh
+    void add(unsigned long long hash) {
+        if (window == 0) return;
+        if (bits[0].empty()) {
+            recent.push_back(hash);
+            counts[active]++;
+            if (counts[active] >= window || counts[active] >= EXACT_LIMIT) {
+                allocateBits();
+            }
+            return;
+        }
+        if (counts[active] >= window) {
+            active ^= 1;
+            fill(bits[active].begin(), bits[active].end(), 0);
+            counts[active] = 0;
+            setBits[active] = 0;
+        }
+        setBitsOf(active, hash);
+        counts[active]++;
+    }
+    
+    // Estimasi false-positive rate saat ini dari kepadatan bit kedua generasi
+    double estimatedFpr() const {
+        if (window == 0) return 0.0;
+        double pass = 1.0;
+        for (int g = 0; g < 2; g++) {
+            double fill = (double)setBits[g] / (double)(bitMask + 1);
+            pass *= 1.0 - pow(fill, hashCount);
+        }
+        return 1.0 - pass;
+    }
+    
+    long long getWindow() const {
+        return window;
+    }
+    
+    long long getRemembered() const {
+        return counts[0] + counts[1];
+    }
+    
+    int getHashCount() const {
+        return hashCount;
+    }
+    
+    size_t getMemoryBytes() const {
+        return (bits[0].size() + bits[1].size() + recent.capacity()) * sizeof(unsigned long long);
+    }
+};
+
+// Tabel handle ID -> node: slots[id - baseId]. ID selalu naik dan tidak pernah
+// dipakai ulang, jadi tabel hanya tumbuh di belakang dan slot kosong di kedua
+// ujung langsung dibuang; lookup O(1) tanpa hashing
+class HandleTable {
+private:
+    deque<Node*> slots;
+    long long baseId; // ID untuk slots[0]
+    
+public:
+    HandleTable() : baseId(1) {}
+    
+    void insert(long long id, Node* node) {
+        if (slots.empty()) {
+            baseId = id;
+        }
+        while (id < baseId) {
+            slots.push_front(nullptr); // Pesan lama yang dikembalikan lewat undo
+            baseId--;
+        }
+        while (baseId + (long long)slots.size() <= id) {
+            slots.push_back(nullptr);
+        }
+        slots[id - baseId] = node;
+    }
+    
+    Node* find(long long id) const {
+        if (id < baseId || id >= baseId + (long long)slots.size()) {
+            return nullptr;
+        }
+        return slots[id - baseId];
+    }
+    
+    void erase(long long id) {
+        if (find(id) == nullptr) return;
+        slots[id - baseId] = nullptr;
+        while (!slots.empty() && slots.front() == nullptr) {
+            slots.pop_front();
+            baseId++;
+        }
+        while (!slots.empty() && slots.back() == nullptr) {
+            slots.pop_back();
+        }
+    }
+    
+    void swap(HandleTable& other) {
+        slots.swap(other.slots);
+        std::swap(baseId, other.baseId);
+    }
+};
+
+// Spam filter: index hash untuk duplikat persis dan index LSH (MinHash band)
+// untuk pesan yang mirip, keduanya tanpa scan seluruh queue
+class SpamFilter {
+private:
+    double threshold; // >= 1.0 berarti hanya tolak duplikat persis
+    BucketTable exactBuckets; // textHash -> rantai exactNext
+    BucketTable lshBuckets;   // (band, key band) -> rantai bandNext
+    SpamHistory history;
+    const HandleTable* handles; // Milik queue; dipakai untuk tetangga band
+    
+    // Buffer kerja agar tidak alokasi ulang di setiap pesan
+    vector<unsigned int> shingles;
+    vector<unsigned int> candidateShingles;
+    vector<Node*> checked;
+    
+    static unsigned long long exactKey(unsigned long long hash) {
+        return hash == 0 ? 1 : hash; // 0 dipakai sebagai slot kosong
+    }
+    
+    static unsigned long long bandKey(int band, unsigned int key) {
+        return ((unsigned long long)band << 32) | key; // key band tidak pernah 0
+    }
+    
+    // Selisih ID from -> to, 0 jika tidak muat 32-bit
+    static int idDelta(const Node* from, const Node* to) {
+        long long delta = to->data.id - from->data.id;
+        return (delta > INT_MAX || delta < -INT_MAX) ? 0 : (int)delta;
+    }
+    
+    Node* bandNeighbor(const Node* node, int delta) const {
+        return (delta != 0) ? handles->find(node->data.id + delta) : nullptr;
+    }
+    
+    static void sortUnique(vector<unsigned int>& v) {
+        sort(v.begin(), v.end());
+        v.erase(unique(v.begin(), v.end()), v.end());
+    }
+    
+public:
+    explicit SpamFilter(const HandleTable* table) : threshold(0.8), handles(table) {
+        history.configure(10000, 0.01);
+    }
+    
+    SpamHistory& getHistory() {
+        return history;
+    }
+    
+    void setThreshold(double t) {
+        threshold = t;
+    }
+    
+    double getThreshold() const {
+        return threshold;
+    }
+    
+    // Cek text baru; sidik pesan diisi untuk dipakai add()
+    RejectReason check(const string& text, SpamFingerprint& fp) {
+        fp.textHash = hashText(text);
+        
+        // Riwayat Bloom filter: O(k), juga mengingat pesan yang sudah dihapus
+        bool seenRecently = history.mightContain(fp.textHash);
+        
+        // Duplikat persis: O(1) lewat hash text
+        for (Node* n = exactBuckets.find(exactKey(fp.textHash)); n != nullptr; n = n->fingerprint.exactNext) {
+            if (n->data.text == text) {
+                return REJECT_DUPLICATE;
+            }
+        }
+        if (seenRecently) {
+            return REJECT_RECENT;
+        }
+        
+        // Signature MinHash dan key per band
+        buildShingles(text, shingles);
+        unsigned int signature[MINHASH_SIZE];
+        minHash(shingles.data(), shingles.size(), signature);
+        for (int b = 0; b < LSH_BANDS; b++) {
+            unsigned long long key = 0xcbf29ce484222325ULL ^ (unsigned long long)b;
+            for (int r = 0; r < LSH_ROWS; r++) {
+                key = (key ^ signature[b * LSH_ROWS + r]) * 1099511628211ULL;
+            }
+            unsigned int folded = (unsigned int)(key ^ (key >> 32));
+            fp.bandKeys[b] = (folded == 0) ? 1 : folded;
+        }
+        if (threshold >= 1.0) {
+            return REJECT_NONE;
+        }
+        
+        // Kandidat terbaru dari setiap bucket LSH, diverifikasi dengan Jaccard asli
+        bool sorted = false;
+        checked.clear();
+        for (int b = 0; b < LSH_BANDS; b++) {
+            Node* candidate = lshBuckets.find(bandKey(b, fp.bandKeys[b]));
+            for (int limit = 0; candidate != nullptr && limit < LSH_CANDIDATE_LIMIT; limit++) {
+                Node* current = candidate;
+                candidate = bandNeighbor(current, current->fingerprint.bandNext[b]);
+                if (find(checked.begin(), checked.end(), current) != checked.end()) continue;
+                checked.push_back(current);
                 
-                // Render karakter per baris
-                int renderedChars = 0;
-                bool lineBreak = false;
-                
-                while (renderedChars < INPUT_WIDTH && charIndex <= (int)message.length()) {
-                    // Render cursor SEBELUM karakter di posisi ini
-                    if (charIndex == cursorPos && focusArea == 0 && 
-                        (selectionStart == -1 || selectionEnd == -1 || selectionStart == selectionEnd)) {
-                        printf("│");
-                        renderedChars++;
-                        if (renderedChars >= INPUT_WIDTH) break;
-                    }
-                    
-                    // Cek apakah posisi ini terseleksi
-                    bool isSelected = false;
-                    if (selectionStart != -1 && selectionEnd != -1 && selectionStart != selectionEnd) {
-                        int selStart = selectionStart < selectionEnd ? selectionStart : selectionEnd;
-                        int selEnd = selectionStart < selectionEnd ? selectionEnd : selectionStart;
-                        if (charIndex >= selStart && charIndex < selEnd) {
-                            isSelected = true;
-                        }
-                    }
-                    
-                    // Set warna untuk seleksi
-                    if (isSelected) {
-                        resetColor();
-                        setColor(40); // Background hitam
-                        setColor(37); // Text putih
-                    }
-                    
-                    // Render karakter
-                    if (charIndex < (int)message.length()) {
-                        char ch = message[charIndex];
-                        if (ch == '\n') {
-                            // Newline - isi sisa baris dengan spasi lalu break
-                            while (renderedChars < INPUT_WIDTH) {
-                                printf(" ");
-                                renderedChars++;
-                            }
-                            charIndex++;
-                            lineBreak = true;
-                            break;
-                        } else {
-                            printf("%c", ch);
-                            renderedChars++;
-                            charIndex++;
-                        }
-                    } else {
-                        // Sudah di akhir message, padding dengan spasi
-                        printf(" ");
-                        renderedChars++;
-                        charIndex++;
-                    }
-                    
-                    // Kembalikan warna jika habis seleksi
-                    if (isSelected) {
-                        resetColor();
-                        if (focusArea == 0) {
-                            setColor(47); setColor(30);
-                        } else {
-                            setColor(37);
-                        }
-                    }
+                if (!sorted) {
+                    sortUnique(shingles);
+                    sorted = true;
                 }
-                
-                // Padding sisa baris jika belum penuh
-                while (renderedChars < INPUT_WIDTH) {
-                    printf(" ");
-                    renderedChars++;
+                buildShingles(current->data.text, candidateShingles);
+                sortUnique(candidateShingles);
+                if (jaccardSorted(shingles, candidateShingles) >= threshold) {
+                    return REJECT_SIMILAR;
                 }
-                
-                resetColor();
-                
-                // Jika line break, lanjut ke baris berikutnya
-                if (lineBreak) continue;
             }
-            
-            // Update posisi tombol berdasarkan jumlah baris
-            int buttonY = INPUT_START_Y + 1 + numLines + 1;
-            
-            // Tombol Kirim dan Kembali
-            gotoxy(10, buttonY);
-            if (focusArea == 1 && selectedButton == 0) {
-                setColor(47); setColor(30);
+        }
+        return REJECT_NONE;
+    }
+    
+    // Daftarkan node yang sudah masuk queue (jadi kepala rantai setiap band)
+    void add(Node* node) {
+        history.add(node->fingerprint.textHash);
+        link(node);
+    }
+    
+    // Masukkan node ke index tanpa mencatat riwayat (dipakai saat rebuild)
+    void link(Node* node) {
+        SpamFingerprint& fp = node->fingerprint;
+        unsigned long long key = exactKey(fp.textHash);
+        Node* exactHead = exactBuckets.find(key);
+        fp.exactPrev = nullptr;
+        fp.exactNext = exactHead;
+        if (exactHead != nullptr) {
+            exactHead->fingerprint.exactPrev = node;
+        }
+        exactBuckets.setHead(key, node);
+        fp.looseBands = 0;
+        for (int b = 0; b < LSH_BANDS; b++) {
+            unsigned long long bucket = bandKey(b, fp.bandKeys[b]);
+            Node* head = lshBuckets.find(bucket);
+            fp.bandPrev[b] = 0;
+            fp.bandNext[b] = 0;
+            if (head != nullptr) {
+                int delta = idDelta(node, head);
+                if (delta == 0) {
+                    fp.looseBands |= 1u << b; // Jarak ID > 2^31: band ini dilewati
+                    continue;
+                }
+                fp.bandNext[b] = delta;
+                head->fingerprint.bandPrev[b] = -delta;
             }
-            printf("╔════════════════╗");
-            resetColor();
-            printf("  ");
-            if (focusArea == 1 && selectedButton == 1) {
-                setColor(47); setColor(30);
+            lshBuckets.setHead(bucket, node);
+        }
+    }
+    
+    // Hapus node dari index - O(1) per band. Jika selisih ID tetangga yang
+    // disambung ulang tidak muat 32-bit, rantai diputus di situ: node yang
+    // lebih lama jadi rantai tanpa kepala di tabel (tidak lagi jadi kandidat)
+    void remove(Node* node) {
+        SpamFingerprint& fp = node->fingerprint;
+        if (fp.exactNext != nullptr) {
+            fp.exactNext->fingerprint.exactPrev = fp.exactPrev;
+        }
+        if (fp.exactPrev != nullptr) {
+            fp.exactPrev->fingerprint.exactNext = fp.exactNext;
+        } else {
+            exactBuckets.setHead(exactKey(fp.textHash), fp.exactNext);
+        }
+        fp.exactNext = nullptr;
+        fp.exactPrev = nullptr;
+        for (int b = 0; b < LSH_BANDS; b++) {
+            if (fp.looseBands & (1u << b)) {
+                continue;
             }
-            printf("╔════════════════════╗");
-            resetColor();
-            
-            gotoxy(10, buttonY + 1);
-            if (focusArea == 1 && selectedButton == 0) {
-                setColor(47); setColor(30);
+            Node* next = bandNeighbor(node, fp.bandNext[b]);
+            Node* prev = bandNeighbor(node, fp.bandPrev[b]);
+            int delta = (next != nullptr && prev != nullptr) ? idDelta(prev, next) : 0;
+            if (next != nullptr) {
+                next->fingerprint.bandPrev[b] = -delta;
             }
-            printf("║  [✓ KIRIM]     ║");
-            resetColor();
-            printf("  ");
-            if (focusArea == 1 && selectedButton == 1) {
-                setColor(47); setColor(30);
+            if (prev != nullptr) {
+                prev->fingerprint.bandNext[b] = delta;
+            } else {
+                unsigned long long bucket = bandKey(b, fp.bandKeys[b]);
+                if (lshBuckets.find(bucket) == node) {
+                    lshBuckets.setHead(bucket, next); // Node adalah kepala rantai
+                }
             }
-            printf("║  [← KEMBALI]       ║");
-            resetColor();
-            
-            gotoxy(10, buttonY + 2);
-            if (focusArea == 1 && selectedButton == 0) {
-                setColor(47); setColor(30);
+            fp.bandNext[b] = 0;
+            fp.bandPrev[b] = 0;
+        }
+    }
+    
+    // Pindahkan isi index ke exact/lsh (dibebaskan pemanggil) lalu mulai dari
+    // index kosong; riwayat Bloom filter tetap dan node lama tidak disentuh
+    void detachIndex(BucketTable& exact, BucketTable& lsh) {
+        exactBuckets.swap(exact);
+        lshBuckets.swap(lsh);
+    }
+};
+
+// Automaton Aho-Corasick untuk blocklist frasa (case-insensitive ASCII).
+// Transisi disimpan di satu tabel datar [state][kelas byte]; byte yang tidak
+// muncul di pola mana pun berbagi satu kelas sehingga tabel tetap kecil.
+class KeywordAutomaton {
+private:
+    vector<string> patterns;
+    unsigned char byteClass[256]; // Byte -> kelas (huruf besar = huruf kecil)
+    int classCount;
+    vector<int> transitions;      // stateCount x classCount
+    vector<int> matchOf;          // Pola yang cocok saat berada di state (-1 = tidak ada)
+    
+public:
+    explicit KeywordAutomaton(const vector<string>& phrases) : classCount(1) {
+        memset(byteClass, 0, sizeof(byteClass));
+        for (int i = 0; i < (int)phrases.size(); i++) {
+            string folded = phrases[i];
+            foldAsciiInPlace(folded);
+            if (folded.empty()) continue;
+            patterns.push_back(folded);
+            for (int j = 0; j < (int)folded.length(); j++) {
+                unsigned char c = folded[j];
+                if (byteClass[c] == 0) {
+                    byteClass[c] = classCount++;
+                }
             }
-            printf("╚════════════════╝");
-            resetColor();
-            printf("  ");
-            if (focusArea == 1 && selectedButton == 1) {
-                setColor(47); setColor(30);
+        }
+        for (int c = 'A'; c <= 'Z'; c++) {
+            byteClass[c] = byteClass[c + ('a' - 'A')];
+        }
+        
+        // Trie: -1 berarti belum ada anak
+        transitions.assign(classCount, -1);
+        matchOf.assign(1, -1);
+        for (int p = 0; p < (int)patterns.size(); p++) {
+            int state = 0;
+            for (int j = 0; j < (int)patterns[p].length(); j++) {
+                int c = byteClass[(unsigned char)patterns[p][j]];
+                if (transitions[state * classCount + c] < 0) {
+                    transitions[state * classCount + c] = (int)matchOf.size();
+                    transitions.resize(transitions.size() + classCount, -1);
+                    matchOf.push_back(-1);
+                }
+                state = transitions[state * classCount + c];
             }
-            printf("╚════════════════════╝");
-            resetColor();
-            
-            gotoxy(10, buttonY + 4);
-            setColor(36);
-            if (focusArea == 0) {
-                printf("←→ kursor | Ctrl+←→ loncat kata | Shift+←→ blok | Alt+←→ blok kata");
+            if (matchOf[state] < 0) {
+                matchOf[state] = p;
+            }
+        }
+        
+        // BFS: isi failure link dan lengkapi tabel menjadi DFA penuh
+        vector<int> fail(matchOf.size(), 0);
+        deque<int> pending;
+        for (int c = 0; c < classCount; c++) {
+            int child = transitions[c];
+            if (child < 0) {
+                transitions[c] = 0;
             } else {
-                printf("Tombol: ←→ pilih | Enter/Klik 2x konfirmasi | ↑ ke text");
+                pending.push_back(child);
             }
-            resetColor();
-            fflush(stdout);
-            
-            // Read input
-            char c;
-            if (read(STDIN_FILENO, &c, 1) == 1) {
-                if (c == '\033') { // ESC sequence
-                    char seq[10];
-                    memset(seq, 0, sizeof(seq));
-                    if (read(STDIN_FILENO, &seq[0], 1) == 1) {
-                        if (seq[0] == '[') {
-                            if (read(STDIN_FILENO, &seq[1], 1) == 1) {
-                                // Check for extended sequences (Shift, Ctrl+Shift)
-                                if (seq[1] == '1') {
-                                    if (read(STDIN_FILENO, &seq[2], 1) == 1) {
-                                        if (seq[2] == ';') {
-                                            if (read(STDIN_FILENO, &seq[3], 1) == 1) {
-                                                if (read(STDIN_FILENO, &seq[4], 1) == 1) {
-                                                    // Modifier values:
-                                                    // 2 = Shift
-                                                    // 3 = Alt
-                                                    // 4 = Shift+Alt
-                                                    // 5 = Ctrl
-                                                    // 6 = Ctrl+Shift
-                                                    // 7 = Ctrl+Alt
-                                                    // 8 = Ctrl+Shift+Alt
-                                                    bool isShift = (seq[3] == '2');
-                                                    bool isCtrl = (seq[3] == '5');
-                                                    bool isCtrlShift = (seq[3] == '6');
-                                                    bool isAlt = (seq[3] == '3');
-                                                    
-                                                    // Handle Alt+Arrow (word selection)
-                                                    if (focusArea == 0 && isAlt) {
-                                                        if (seq[4] == 'C') { // Alt+Right - extend selection word right
-                                                            if (selectionStart == -1) {
-                                                                // Mulai seleksi dari posisi saat ini
-                                                                selectionStart = cursorPos;
-                                                                selectionEnd = cursorPos;
-                                                            }
-                                                            
-                                                            // Extend dari ujung seleksi (yang lebih besar)
-                                                            int extendFrom = (selectionStart < selectionEnd) ? selectionEnd : selectionStart;
-                                                            cursorPos = extendFrom;
-                                                            
-                                                            // Skip spasi jika ada di posisi saat ini
-                                                            while (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
-                                                                cursorPos++;
-                                                            }
-                                                            
-                                                            // Blok 1 kata (sampai ketemu spasi atau akhir)
-                                                            while (cursorPos < (int)message.length() && message[cursorPos] != ' ') {
-                                                                cursorPos++;
-                                                            }
-                                                            
-                                                            // Update selectionEnd
-                                                            selectionEnd = cursorPos;
-                                                        } else if (seq[4] == 'D') { // Alt+Left - extend selection word left
-                                                            if (selectionStart == -1) {
-                                                                // Mulai seleksi dari posisi saat ini
-                                                                selectionStart = cursorPos;
-                                                                selectionEnd = cursorPos;
-                                                            }
-                                                            
-                                                            // Extend dari ujung seleksi (yang lebih kecil)
-                                                            int extendFrom = (selectionStart < selectionEnd) ? selectionStart : selectionEnd;
-                                                            cursorPos = extendFrom;
-                                                            
-                                                            if (cursorPos > 0) {
-                                                                cursorPos--;
-                                                                
-                                                                // Skip spasi jika ada di posisi saat ini
-                                                                while (cursorPos > 0 && message[cursorPos] == ' ') {
-                                                                    cursorPos--;
-                                                                }
-                                                                
-                                                                // Blok 1 kata ke kiri (sampai ketemu spasi atau awal)
-                                                                while (cursorPos > 0 && message[cursorPos - 1] != ' ') {
-                                                                    cursorPos--;
-                                                                }
-                                                            }
-                                                            
-                                                            // Update selectionStart (untuk extend ke kiri)
-                                                            selectionStart = cursorPos;
-                                                        }
-                                                    }
-                                                    
-                                                    // Handle Ctrl+Arrow (jump per word without selection)
-                                                    if (focusArea == 0 && isCtrl && !isCtrlShift && !isShift) {
-                                                        if (seq[4] == 'C') { // Ctrl+Right
-                                                            // Jump per kata ke kanan (tanpa seleksi)
-                                                            selectionStart = -1;
-                                                            selectionEnd = -1;
-                                                            
-                                                            if (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
-                                                                while (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
-                                                                    cursorPos++;
-                                                                }
-                                                            } else {
-                                                                while (cursorPos < (int)message.length() && message[cursorPos] != ' ') {
-                                                                    cursorPos++;
-                                                                }
-                                                            }
-                                                        } else if (seq[4] == 'D') { // Ctrl+Left
-                                                            // Jump per kata ke kiri (tanpa seleksi)
-                                                            selectionStart = -1;
-                                                            selectionEnd = -1;
-                                                            
-                                                            if (cursorPos > 0) {
-                                                                cursorPos--;
-                                                                if (message[cursorPos] == ' ') {
-                                                                    while (cursorPos > 0 && message[cursorPos] == ' ') {
-                                                                        cursorPos--;
-                                                                    }
-                                                                    if (cursorPos > 0 || message[0] != ' ') {
-                                                                        cursorPos++;
-                                                                    }
-                                                                } else {
-                                                                    while (cursorPos > 0 && message[cursorPos - 1] != ' ') {
-                                                                        cursorPos--;
-                                                                    }
-                                                                }
-                                                            }
-                                                        }
-                                                    }
-                                                    
-                                                    if (focusArea == 0 && (isShift || isCtrlShift)) {
-                                                        if (seq[4] == 'C') { // Shift+Right atau Ctrl+Shift+Right
-                                                            if (selectionStart == -1) {
-                                                                selectionStart = cursorPos;
-                                                            }
-                                                            
-                                                            if (isCtrlShift) {
-                                                                // Blok per kata ke kanan
-                                                                // Jika di spasi, skip spasi sampai ketemu huruf
-                                                                if (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
-                                                                    while (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
-                                                                        cursorPos++;
-                                                                    }
-                                                                } else {
-                                                                    // Jika di huruf, maju sampai ketemu spasi atau akhir
-                                                                    while (cursorPos < (int)message.length() && message[cursorPos] != ' ') {
-                                                                        cursorPos++;
-                                                                    }
-                                                                }
-                                                            } else {
-                                                                // Geser 1 karakter
-                                                                if (cursorPos < (int)message.length()) cursorPos++;
-                                                            }
-                                                            selectionEnd = cursorPos;
-                                                        } else if (seq[4] == 'D') { // Shift+Left atau Ctrl+Shift+Left
-                                                            if (selectionStart == -1) {
-                                                                selectionStart = cursorPos;
-                                                            }
-                                                            
-                                                            if (isCtrlShift) {
-                                                                // Blok per kata ke kiri
-                                                                // Mundur satu langkah dulu
-                                                                if (cursorPos > 0) {
-                                                                    cursorPos--;
-                                                                    
-                                                                    // Jika di spasi, skip spasi sampai ketemu huruf
-                                                                    if (message[cursorPos] == ' ') {
-                                                                        while (cursorPos > 0 && message[cursorPos] == ' ') {
-                                                                            cursorPos--;
-                                                                        }
-                                                                        // Posisikan di akhir kata sebelumnya
-                                                                        if (cursorPos > 0 || message[0] != ' ') {
-                                                                            cursorPos++;
-                                                                        }
-                                                                    } else {
-                                                                        // Jika di huruf, mundur sampai ketemu spasi atau awal
-                                                                        while (cursorPos > 0 && message[cursorPos - 1] != ' ') {
-                                                                            cursorPos--;
-                                                                        }
-                                                                    }
-                                                                }
-                                                            } else {
-                                                                // Geser 1 karakter
-                                                                if (cursorPos > 0) cursorPos--;
-                                                            }
-                                                            selectionEnd = cursorPos;
-                                                        } else if (seq[4] == 'A') { // Shift+Up
-                                                            if (selectionStart == -1) {
-                                                                selectionStart = cursorPos;
-                                                            }
-                                                            // Geser ke atas 1 baris (55 karakter)
-                                                            const int INPUT_WIDTH = 55;
-                                                            if (cursorPos >= INPUT_WIDTH) {
-                                                                cursorPos -= INPUT_WIDTH;
-                                                            } else {
-                                                                cursorPos = 0; // Ke awal text
-                                                            }
-                                                            selectionEnd = cursorPos;
-                                                        } else if (seq[4] == 'B') { // Shift+Down
-                                                            if (selectionStart == -1) {
-                                                                selectionStart = cursorPos;
-                                                            }
-                                                            // Geser ke bawah 1 baris (55 karakter)
-                                                            const int INPUT_WIDTH = 55;
-                                                            if (cursorPos + INPUT_WIDTH <= (int)message.length()) {
-                                                                cursorPos += INPUT_WIDTH;
-                                                            } else {
-                                                                cursorPos = message.length(); // Ke akhir text
-                                                            }
-                                                            selectionEnd = cursorPos;
-                                                        }
-                                                    }
-                                                }
-                                            }
-                                        }
-                                    }
-                                } else if (seq[1] == 'A') { // Up arrow
-                                    if (focusArea == 1) {
-                                        focusArea = 0; // Kembali ke text input
-                                    } else if (focusArea == 0) {
-                                        // Navigasi ke atas 1 baris dalam text
-                                        const int INPUT_WIDTH = 55;
-                                        
-                                        // Hitung posisi baris saat ini berdasarkan newline
-                                        int currentLine = 0;
-                                        int charCount = 0;
-                                        for (int i = 0; i < cursorPos && i < (int)message.length(); i++) {
-                                            if (message[i] == '\n') {
-                                                currentLine++;
-                                                charCount = 0;
-                                            } else {
-                                                charCount++;
-                                                if (charCount >= INPUT_WIDTH) {
-                                                    currentLine++;
-                                                    charCount = 0;
-                                                }
-                                            }
-                                        }
-                                        
-                                        if (currentLine > 0) {
-                                            // Ada baris di atas, naik
-                                            int targetLine = currentLine - 1;
-                                            int newPos = 0;
-                                            int line = 0;
+        }
+        while (!pending.empty()) {
+            int state = pending.front();
+            pending.pop_front();
+            if (matchOf[state] < 0) {
+                matchOf[state] = matchOf[fail[state]]; // Pola yang berakhir di suffix
+            }
+            for (int c = 0; c < classCount; c++) {
+                int& next = transitions[state * classCount + c];
+                int viaFail = transitions[fail[state] * classCount + c];
+                if (next < 0) {
+                    next = viaFail;
+                } else {
+                    fail[next] = viaFail;
+                    pending.push_back(next);
+                }
+            }
+        }
+    }
+    
+    // Scan text sekali jalan; return index pola pertama yang ditemukan (-1 = bersih)
+    int findFirst(const string& text) const {
+        const int* table = transitions.data();
+        const int* match = matchOf.data();
+        int state = 0;
+        for (size_t i = 0; i < text.length(); i++) {
+            state = table[state * classCount + byteClass[(unsigned char)text[i]]];
+            if (match[state] >= 0) {
+                return match[state];
+            }
+        }
+        return -1;
+    }
+    
+    const string& getPattern(int index) const {
+        return patterns[index];
+    }
+    
+    int getPatternCount() const {
+        return (int)patterns.size();
+    }
+    
+    int getStateCount() const {
+        return (int)matchOf.size();
+    }
+};
+
+// Fungsi untuk membaca daftar frasa dari file (satu per baris, '#' = komentar)
+bool loadPhrases(const string& path, vector<string>& phrases) {
+    FILE* in = fopen(path.c_str(), "r");
+    if (in == nullptr) {
+        return false;
+    }
+    char* lineBuf = nullptr;
+    size_t lineCap = 0;
+    ssize_t lineLen;
+    while ((lineLen = getline(&lineBuf, &lineCap, in)) != -1) {
+        string line(lineBuf, lineLen);
+        size_t first = line.find_first_not_of(" \t\r\n");
+        if (first == string::npos || line[first] == '#') continue;
+        size_t last = line.find_last_not_of(" \t\r\n");
+        phrases.push_back(line.substr(first, last - first + 1));
+    }
+    free(lineBuf);
+    fclose(in);
+    return true;
+}
+
+// Blocklist yang bisa di-reload saat file berubah. Automaton baru dibangun di
+// thread pengawas lalu ditukar secara atomik, jadi pengirim tidak pernah menunggu.
+class Blocklist {
+private:
+    string path;
+    shared_ptr<const KeywordAutomaton> automaton;
+    time_t loadedMtime;
+    long loadedMtimeNs;
+    
+    thread watcher;
+    mutex watchMutex;
+    condition_variable watchWake;
+    bool stopWatching;
+    
+    bool readMtime(time_t& sec, long& nsec) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            return false;
+        }
+        sec = st.st_mtim.tv_sec;
+        nsec = st.st_mtim.tv_nsec;
+        return true;
+    }
+    
+    // Thread pengawas: cek mtime file secara berkala dan reload jika berubah
+    void watchLoop(int intervalMs) {
+        unique_lock<mutex> lock(watchMutex);
+        while (!stopWatching) {
+            watchWake.wait_for(lock, chrono::milliseconds(intervalMs));
+            if (stopWatching) break;
+            time_t sec;
+            long nsec;
+            if (readMtime(sec, nsec) && (sec != loadedMtime || nsec != loadedMtimeNs)) {
+                lock.unlock();
+                reload();
+                lock.lock();
+            }
+        }
+    }
+    
+public:
+    Blocklist() : loadedMtime(0), loadedMtimeNs(0), stopWatching(false) {}
+    
+    ~Blocklist() {
+        stopWatch();
+    }
+    
+    // Muat (ulang) blocklist dari file; automaton lama tetap dipakai jika gagal
+    bool load(const string& filePath) {
+        path = filePath;
+        return reload();
+    }
+    
+    bool reload() {
+        time_t sec = 0;
+        long nsec = 0;
+        readMtime(sec, nsec);
+        vector<string> phrases;
+        if (!loadPhrases(path, phrases)) {
+            return false;
+        }
+        shared_ptr<const KeywordAutomaton> fresh = make_shared<KeywordAutomaton>(phrases);
+        atomic_store(&automaton, fresh);
+        loadedMtime = sec;
+        loadedMtimeNs = nsec;
+        return true;
+    }
+    
+    // Mulai thread yang me-reload blocklist saat file diubah
+    void startWatch(int intervalMs) {
+        if (watcher.joinable() || path.empty()) return;
+        stopWatching = false;
+        watcher = thread(&Blocklist::watchLoop, this, intervalMs);
+    }
+    
+    void stopWatch() {
+        if (!watcher.joinable()) return;
+        {
+            lock_guard<mutex> lock(watchMutex);
+            stopWatching = true;
+        }
+        watchWake.notify_all();
+        watcher.join();
+    }
+    
+    // Snapshot automaton saat ini (nullptr jika belum dimuat)
+    shared_ptr<const KeywordAutomaton> current() const {
+        return atomic_load(&automaton);
+    }
+};
+
+// Rate limiter sliding window: ring counter per detik untuk `windowSec` detik
+// terakhir. Keputusan O(1) (geser ring maksimal windowSec bucket), memory tetap.
+class RateLimiter {
+private:
+    static const int MAX_WINDOW = 60;
+    int limit;               // Maksimal pesan per window (0 = nonaktif)
+    int windowSec;
+    int counters[MAX_WINDOW];
+    long long currentSecond; // Detik terbaru yang sudah dimasukkan ke ring
+    int total;               // Jumlah semua counter di ring
+    
+    // Buang bucket yang sudah keluar dari window sampai detik `second`
+    void advance(long long second) {
+        if (second <= currentSecond) return;
+        if (second - currentSecond >= windowSec) {
+            memset(counters, 0, sizeof(counters));
+            total = 0;
+        } else {
+            for (long long s = currentSecond + 1; s <= second; s++) {
+                int slot = (int)(s % windowSec);
+                total -= counters[slot];
+                counters[slot] = 0;
+            }
+        }
+        currentSecond = second;
+    }
+    
+public:
+    RateLimiter() : limit(0), windowSec(1), currentSecond(0), total(0) {
+        memset(counters, 0, sizeof(counters));
+    }
+    
+    // Atur batas: maksimal `maxMessages` pesan per `seconds` detik
+    void configure(int maxMessages, int seconds) {
+        limit = maxMessages > 0 ? maxMessages : 0;
+        windowSec = seconds < 1 ? 1 : (seconds > MAX_WINDOW ? MAX_WINDOW : seconds);
+        memset(counters, 0, sizeof(counters));
+        currentSecond = 0;
+        total = 0;
+    }
+    
+    bool isEnabled() const {
+        return limit > 0;
+    }
+    
+    // Apakah pesan baru masih boleh dikirim pada waktu nowMs
+    bool allow(long long nowMs) {
+        if (limit == 0) return true;
+        advance(nowMs / 1000);
+        return total < limit;
+    }
+    
+    // Catat pesan yang diterima pada waktu nowMs
+    void record(long long nowMs) {
+        if (limit == 0) return;
+        advance(nowMs / 1000);
+        counters[currentSecond % windowSec]++;
+        total++;
+    }
+    
+    // Waktu tunggu sampai bucket tertua keluar dari window (ms)
+    long long retryAfterMs(long long nowMs) {
+        advance(nowMs / 1000);
+        for (long long s = currentSecond - windowSec + 1; s <= currentSecond; s++) {
+            if (s >= 0 && counters[s % windowSec] > 0) {
+                long long wait = (s + windowSec) * 1000 - nowMs;
+                return wait > 0 ? wait : 0;
+            }
+        }
+        return 0;
+    }
+    
+    int getLimit() const {
+        return limit;
+    }
+    
+    int getWindowSec() const {
+        return windowSec;
+    }
+};
+
+// Fungsi untuk memecah text menjadi hash token (huruf/angka ASCII dan byte UTF-8,
+// case-insensitive), hasil terurut dan unik
+void collectTokens(const string& text, vector<unsigned long long>& tokens) {
+    thread_local string folded;
+    folded.assign(text);
+    foldAsciiInPlace(folded);
+    
+    tokens.clear();
+    unsigned long long h = 0;
+    bool inToken = false;
+    for (size_t i = 0; i <= folded.length(); i++) {
+        unsigned char c = (i < folded.length()) ? folded[i] : ' ';
+        bool tokenChar = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80;
+        if (tokenChar) {
+            if (!inToken) {
+                h = 14695981039346656037ULL;
+                inToken = true;
+            }
+            h = (h ^ c) * 1099511628211ULL;
+        } else if (inToken) {
+            tokens.push_back(h);
+            inToken = false;
+        }
+    }
+    sort(tokens.begin(), tokens.end());
+    tokens.erase(unique(tokens.begin(), tokens.end()), tokens.end());
+}
+
+// Inverted index: hash token -> posting list ID pesan (terurut naik karena ID
+// selalu bertambah). Pesan yang dihapus dari depan/belakang queue langsung
+// dibuang dari ujung list; pesan di tengah ditandai mati (ID negatif, urutan
+// tetap menurut nilai mutlak) dan list dipadatkan saat separuhnya mati.
+class SearchIndex {
+private:
+    struct PostingList {
+        vector<long long> ids;
+        size_t head; // ids[0..head) sudah dibuang (dipotong berkala)
+        size_t dead; // Entry mati (negatif) di ids[head..)
+        
+        PostingList() : head(0), dead(0) {}
+        size_t activeSize() const { return ids.size() - head - dead; }
+    };
+    
+    static bool idLess(long long id, long long entry) {
+        return id < llabs(entry);
+    }
+    
+    // Buang prefix yang sudah dipotong dan semua entry mati - O(panjang list)
+    static void compact(PostingList& list) {
+        size_t out = 0;
+        for (size_t k = list.head; k < list.ids.size(); k++) {
+            if (list.ids[k] > 0) {
+                list.ids[out++] = list.ids[k];
+            }
+        }
+        list.ids.resize(out);
+        list.head = 0;
+        list.dead = 0;
+    }
+    
+    unordered_map<unsigned long long, PostingList> postings;
+    vector<unsigned long long> tokens; // Buffer kerja
+    unordered_map<unsigned long long, vector<long long>> pending; // Buffer kerja addBatch
+    vector<long long> merged;
+    
+    // Cari batas atas target di ids[head, hi): galloping mundur dari hi lalu
+    // binary search, jadi murah untuk loncatan kecil maupun besar
+    static size_t gallopBack(const vector<long long>& ids, size_t head, size_t hi, long long target) {
+        size_t bound = hi;
+        size_t step = 1;
+        while (bound - head > step && llabs(ids[bound - step]) > target) {
+            bound -= step;
+            step *= 2;
+        }
+        size_t lo = (bound - head > step) ? bound - step : head;
+        return upper_bound(ids.begin() + lo, ids.begin() + bound, target, idLess) - ids.begin();
+    }
+    
+    // ID di luar rentang list: push_back, atau mundurkan head - O(1)
+    static bool addAtEnd(PostingList& list, long long id) {
+        if (list.activeSize() == 0 || list.ids.back() < id) {
+            list.ids.push_back(id);
+            return true;
+        }
+        if (list.head > 0 && id < list.ids[list.head]) {
+            list.ids[--list.head] = id;
+            return true;
+        }
+        return false;
+    }
+    
+    // ID di tengah list: entry mati dengan ID yang sama dihidupkan lagi lewat
+    // binary search - O(log n). ID yang belum ada disisipkan jika insert =
+    // true; return false jika ID belum ada dan tidak disisipkan
+    static bool placeSorted(PostingList& list, long long id, bool insert) {
+        auto pos = upper_bound(list.ids.begin() + list.head, list.ids.end(), id, idLess);
+        if (pos != list.ids.begin() + list.head && llabs(*(pos - 1)) == id) {
+            if (*(pos - 1) < 0) {
+                *(pos - 1) = id;
+                list.dead--;
+            }
+            return true;
+        }
+        if (insert) {
+            list.ids.insert(pos, id);
+        }
+        return insert;
+    }
+    
+    // Gabung ID urut naik ke posting list dalam satu pass; entry mati dengan
+    // ID yang sama dihidupkan lagi
+    void mergeInto(PostingList& list, const vector<long long>& added) {
+        merged.clear();
+        size_t a = list.head;
+        size_t b = 0;
+        while (a < list.ids.size() || b < added.size()) {
+            if (b == added.size() || (a < list.ids.size() && llabs(list.ids[a]) < added[b])) {
+                merged.push_back(list.ids[a++]);
+            } else {
+                if (a < list.ids.size() && llabs(list.ids[a]) == added[b]) {
+                    if (list.ids[a] < 0) list.dead--;
+                    a++;
+                }
+                merged.push_back(added[b++]);
+            }
+        }
+        list.ids.swap(merged);
+        list.head = 0;
+    }
+    
+public:
+    // ID baru selalu paling besar (push_back); ID lama yang dikembalikan lewat
+    // undo disisipkan di posisi urutnya, di depan list cukup O(1) lewat head
+    void add(long long id, const string& text) {
+        collectTokens(text, tokens);
+        for (size_t i = 0; i < tokens.size(); i++) {
+            PostingList& list = postings[tokens[i]];
+            if (!addAtEnd(list, id)) {
+                placeSorted(list, id, true);
+            }
+        }
+    }
+    
+    // Tambah banyak pesan sekaligus (urut ID naik, mis. hasil undo). ID yang
+    // jatuh di ujung list langsung ditaruh di sana (pesan diproses dari ID
+    // terbesar jika range kembali ke depan/tengah, dari terkecil jika ke
+    // belakang); sisanya dikumpulkan per token. Yang masih ada sebagai entry
+    // mati dihidupkan lagi lewat binary search, dan hanya ID yang benar-benar
+    // baru digabung dalam satu pass (atau disisipkan satu per satu jika
+    // sedikit). Biayanya tidak pernah satu sisipan di tengah vector per pesan,
+    // dan undo satu pesan di tengah tidak menyalin seluruh list
+    void addBatch(const vector<Node*>& nodes, bool atBack) {
+        pending.clear();
+        for (size_t n = 0; n < nodes.size(); n++) {
+            const Node* node = atBack ? nodes[n] : nodes[nodes.size() - 1 - n];
+            collectTokens(node->data.text, tokens);
+            for (size_t i = 0; i < tokens.size(); i++) {
+                if (!addAtEnd(postings[tokens[i]], node->data.id)) {
+                    pending[tokens[i]].push_back(node->data.id);
+                }
+            }
+        }
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            PostingList& list = postings[it->first];
+            vector<long long>& added = it->second;
+            if (!atBack) {
+                reverse(added.begin(), added.end());
+            }
+            size_t missing = 0;
+            for (size_t k = 0; k < added.size(); k++) {
+                if (!placeSorted(list, added[k], false)) {
+                    added[missing++] = added[k];
+                }
+            }
+            added.resize(missing);
+            if (missing <= 8) {
+                for (size_t k = 0; k < missing; k++) {
+                    placeSorted(list, added[k], true);
+                }
+            } else {
+                mergeInto(list, added);
+            }
+        }
+    }
+    
+    // Pesan di posisi mana pun: ujung list dipotong (entry mati yang ikut
+    // terbuka di ujung ikut dibuang), di tengah ditandai mati lewat binary search
+    void remove(long long id, const string& text) {
+        collectTokens(text, tokens);
+        for (size_t i = 0; i < tokens.size(); i++) {
+            auto it = postings.find(tokens[i]);
+            if (it == postings.end()) continue;
+            PostingList& list = it->second;
+            if (list.ids[list.head] == id) {
+                list.head++;
+                while (list.head < list.ids.size() && list.ids[list.head] < 0) {
+                    list.head++;
+                    list.dead--;
+                }
+            } else if (list.ids.back() == id) {
+                list.ids.pop_back();
+                while (list.ids.size() > list.head && list.ids.back() < 0) {
+                    list.ids.pop_back();
+                    list.dead--;
+                }
+            } else {
+                auto pos = upper_bound(list.ids.begin() + list.head, list.ids.end(), id, idLess);
+                if (pos != list.ids.begin() + list.head && *(pos - 1) == id) {
+                    *(pos - 1) = -id;
+                    list.dead++;
+                }
+            }
+            if (list.activeSize() == 0) {
+                postings.erase(it);
+            } else if (list.dead * 2 > list.ids.size() - list.head ||
+                       (list.head >= 32 && list.head * 2 >= list.ids.size())) {
+                compact(list);
+            }
+        }
+    }
+    
+    // Query AND semua token; hasil terbaru dulu, maksimal limit ID yang lolos isLive
+    template <typename IsLive>
+    void search(const string& query, int limit, vector<long long>& results, IsLive isLive) {
+        results.clear();
+        collectTokens(query, tokens);
+        if (tokens.empty()) return;
+        
+        vector<const PostingList*> lists;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            auto it = postings.find(tokens[i]);
+            if (it == postings.end()) return; // Ada token yang tidak pernah muncul
+            lists.push_back(&it->second);
+        }
+        sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) {
+            return a->activeSize() < b->activeSize();
+        });
+        
+        // Iterasi list terpendek dari belakang, cek ID di list lain
+        vector<size_t> hi(lists.size());
+        for (size_t j = 0; j < lists.size(); j++) {
+            hi[j] = lists[j]->ids.size();
+        }
+        const PostingList& smallest = *lists[0];
+        for (size_t k = smallest.ids.size(); k > smallest.head && (int)results.size() < limit; k--) {
+            long long id = smallest.ids[k - 1];
+            if (id < 0) continue; // Entry mati
+            bool inAll = true;
+            for (size_t j = 1; j < lists.size() && inAll; j++) {
+                hi[j] = gallopBack(lists[j]->ids, lists[j]->head, hi[j], id);
+                if (hi[j] == lists[j]->head) return; // Tidak ada ID lebih kecil lagi
+                inAll = (lists[j]->ids[hi[j] - 1] == id);
+            }
+            if (inAll && isLive(id)) {
+                results.push_back(id);
+            }
+        }
+    }
+    
+    size_t getTokenCount() const {
+        return postings.size();
+    }
+    
+    void swap(SearchIndex& other) {
+        postings.swap(other.postings);
+    }
+};
+
+// Pool node bekas: node yang dihapus disambung utuh ke free list (lewat next)
+// tanpa delete, lalu dipakai ulang oleh enqueue berikutnya beserta kapasitas
+// string-nya. Jumlahnya dibatasi agar memory kembali setelah hapus massal.
+class NodePool {
+private:
+    Node* freeList;
+    long long count;
+    long long limit;
+    
+public:
+    NodePool() : freeList(nullptr), count(0), limit(65536) {}
+    
+    ~NodePool() {
+        while (freeList != nullptr) {
+            Node* node = freeList;
+            freeList = node->next;
+            delete node;
+        }
+    }
+    
+    Node* acquire(const Pesan& pesan) {
+        if (freeList == nullptr) {
+            return new Node(pesan);
+        }
+        Node* node = freeList;
+        freeList = node->next;
+        count--;
+        node->data = pesan; // Copy-assign memakai ulang buffer string lama
+        node->memberReads.clear();
+        node->memberReadsVersion = 0;
+        node->next = nullptr;
+        node->prev = nullptr;
+        return node;
+    }
+    
+    // Sambung rantai first..last (n node, lewat next) ke pool - O(1).
+    // false jika pool akan melebihi limit; rantai tidak diambil
+    bool release(Node* first, Node* last, long long n) {
+        if (count + n > limit) {
+            return false;
+        }
+        last->next = freeList;
+        freeList = first;
+        count += n;
+        return true;
+    }
+    
+    long long getCount() const {
+        return count;
+    }
+};
+
+// Thread pembersih: memory dari hapus massal (rantai node, index lama)
+// dibebaskan di background, jadi hapus jutaan pesan tidak menunggu jutaan free()
+class Reclaimer {
+private:
+    mutex lock;
+    condition_variable wake;
+    condition_variable idle; // Diberi sinyal setiap kali antrian habis dibebaskan
+    vector<function<void()>> pending;
+    bool busy;
+    bool stopping;
+    thread worker;
+    
+    void run() {
+        // Prioritas idle: di mesin dengan sedikit core, pembersihan tidak
+        // merebut CPU dari thread utama
+        struct sched_param param;
+        param.sched_priority = 0;
+        sched_setscheduler(0, SCHED_IDLE, &param);
+        
+        vector<function<void()>> batch; // Bergantian dengan pending, kapasitas dipakai ulang
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [&] { return stopping || !pending.empty(); });
+            if (pending.empty()) {
+                return; // stopping dan semua sudah dibebaskan
+            }
+            batch.swap(pending);
+            busy = true;
+            guard.unlock();
+            for (size_t i = 0; i < batch.size(); i++) {
+                batch[i]();
+            }
+            batch.clear(); // Objek yang ditangkap closure ikut dibebaskan di sini
+            guard.lock();
+            busy = false;
+            if (pending.empty()) {
+                idle.notify_all();
+            }
+        }
+    }
+    
+public:
+    Reclaimer() : busy(false), stopping(false) {}
+    
+    ~Reclaimer() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    
+    // Jadwalkan task pembersih; thread dibuat saat pertama kali dibutuhkan
+    void dispose(function<void()> task) {
+        {
+            lock_guard<mutex> guard(lock);
+            pending.push_back(task);
+            if (!worker.joinable()) {
+                worker = thread(&Reclaimer::run, this);
+            }
+        }
+        wake.notify_one();
+    }
+    
+    // Tunggu sampai semua task pembersih selesai (dipakai benchmark)
+    void drain() {
+        unique_lock<mutex> guard(lock);
+        idle.wait(guard, [&] { return pending.empty() && !busy; });
+    }
+};
+
+// Epoch-based reclamation untuk pembaca di thread lain: pembaca mengumumkan
+// epoch global saat mulai scan dan mengosongkan slotnya saat selesai. Writer
+// yang melepas node mengambil stempel epoch (sekaligus memajukan epoch), dan
+// node baru boleh dipakai ulang / dihapus setelah semua pembaca yang masih
+// aktif mulai scan sesudah stempel itu. Writer tetap satu thread
+class EpochDomain {
+private:
+    static const int MAX_READERS = 64;
+    static const unsigned long long IDLE = ULLONG_MAX; // Slot tidak sedang scan
+    
+    struct alignas(64) Slot {
+        atomic<unsigned long long> epoch;
+        atomic<bool> taken;
+    };
+    
+    Slot slots[MAX_READERS];
+    alignas(64) atomic<unsigned long long> epoch;
+    atomic<int> readers; // Slot yang sedang dipakai
+    
+public:
+    EpochDomain() : epoch(1), readers(0) {
+        for (int i = 0; i < MAX_READERS; i++) {
+            slots[i].epoch.store(IDLE, memory_order_relaxed);
+            slots[i].taken.store(false, memory_order_relaxed);
+        }
+    }
+    
+    // Ambil slot untuk satu thread pembaca (-1 jika semua slot terpakai)
+    int attach() {
+        for (int i = 0; i < MAX_READERS; i++) {
+            bool expected = false;
+            if (slots[i].taken.compare_exchange_strong(expected, true)) {
+                readers.fetch_add(1);
+                return i;
+            }
+        }
+        return -1;
+    }
+    
+    void detach(int slot) {
+        readers.fetch_sub(1);
+        slots[slot].taken.store(false, memory_order_release);
+    }
+    
+    // Mulai scan: setelah fence, semua node yang dilepas sebelum epoch ini
+    // sudah tidak terjangkau dari front
+    void enter(int slot) {
+        slots[slot].epoch.store(epoch.load(), memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+    
+    void leave(int slot) {
+        slots[slot].epoch.store(IDLE, memory_order_release);
+    }
+    
+    // Writer: true jika ada pembaca terdaftar (tanpa pembaca, node yang
+    // dilepas langsung aman dipakai ulang)
+    bool hasReaders() {
+        atomic_thread_fence(memory_order_seq_cst);
+        return readers.load(memory_order_relaxed) > 0;
+    }
+    
+    // Writer: stempel untuk node yang baru saja dilepas dari list
+    unsigned long long stamp() {
+        return epoch.fetch_add(1);
+    }
+    
+    // Writer: epoch terlama yang masih dipakai scan (IDLE jika tidak ada).
+    // Node dengan stempel < nilai ini aman dipakai ulang
+    unsigned long long oldestActive() {
+        atomic_thread_fence(memory_order_seq_cst);
+        unsigned long long oldest = IDLE;
+        for (int i = 0; i < MAX_READERS; i++) {
+            unsigned long long value = slots[i].epoch.load(memory_order_acquire);
+            if (value < oldest) oldest = value;
+        }
+        return oldest;
+    }
+};
+
+// Jenis perubahan queue yang bisa di-undo
+enum JournalOp {
+    JOURNAL_INSERT,    // Pesan masuk (enqueue)
+    JOURNAL_REMOVE,    // Pesan keluar (dequeue, cancelLast, removeById, hapus massal)
+    JOURNAL_MARK_READ  // Pesan ditandai dibaca
+};
+
+// Satu perubahan di journal undo. Pesan yang sedang berada di luar queue
+// (dihapus dan belum di-undo, atau dikirim lalu di-undo) disimpan sebagai
+// rantai node lepas, jadi tidak ada salinan text; pesan yang ada di queue
+// cukup dicatat ID-nya
+struct JournalEntry {
+    JournalOp op;
+    int count;
+    Node* nodes;           // Rantai lewat next, urut ID naik (nullptr = pesan ada di queue)
+    Node* nodesLast;
+    long long id;          // ID jika count == 1
+    vector<long long> ids; // ID jika count > 1 (hanya valid jika nodes == nullptr)
+    // Petunjuk posisi untuk undo, dicatat saat pesan dilepas (0 = tidak ada;
+    // selalu dicek ulang karena pesan tetangganya bisa sudah hilang)
+    long long successorId;          // Pesan hidup tepat setelah run pertama (0 = di belakang)
+    vector<long long> successorIds; // Penerus run berikutnya jika rantai terpecah
+    long long lanePrevId;           // Tetangga lane sebelumnya jika count == 1
+    
+    JournalEntry(JournalOp o, int n) : op(o), count(n), nodes(nullptr), nodesLast(nullptr), id(0),
+        successorId(0), lanePrevId(0) {}
+    
+    long long idAt(int i) const {
+        return count == 1 ? id : ids[i];
+    }
+};
+
+// Journal undo/redo berbatas: maksimal maxEntries perubahan dan maxMessages
+// pesan; perubahan tertua dibuang lebih dulu. Entry yang dibuang dikembalikan
+// ke pemanggil agar rantai node-nya bisa dipakai ulang
+class UndoJournal {
+private:
+    deque<JournalEntry> undoStack; // Terbaru di belakang
+    vector<JournalEntry> redoStack;
+    int maxEntries;
+    long long maxMessages;
+    long long messages; // Jumlah count semua entry di kedua stack
+    
+    static void freeNodes(Node* node) {
+        while (node != nullptr) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+    
+public:
+    UndoJournal() : maxEntries(100), maxMessages(1000000), messages(0) {}
+    
+    ~UndoJournal() {
+        for (size_t i = 0; i < undoStack.size(); i++) freeNodes(undoStack[i].nodes);
+        for (size_t i = 0; i < redoStack.size(); i++) freeNodes(redoStack[i].nodes);
+    }
+    
+    bool isEnabled() const {
+        return maxEntries > 0;
+    }
+    
+    // Atur batas journal; semua entry lama dipindah ke dropped
+    void configure(int entries, long long messageLimit, vector<JournalEntry>& dropped) {
+        maxEntries = entries > 0 ? entries : 0;
+        maxMessages = messageLimit;
+        clear(dropped);
+    }
+    
+    void clear(vector<JournalEntry>& dropped) {
+        while (!undoStack.empty()) {
+            dropped.push_back(std::move(undoStack.front()));
+            undoStack.pop_front();
+        }
+        while (!redoStack.empty()) {
+            dropped.push_back(std::move(redoStack.back()));
+            redoStack.pop_back();
+        }
+        messages = 0;
+    }
+    
+    // Catat perubahan baru: redo dibuang, lalu entry tertua dibuang sampai
+    // batas terpenuhi. Perubahan yang lebih besar dari batas tidak bisa di-undo
+    // sama sekali, jadi seluruh journal dikosongkan
+    void record(JournalEntry& entry, vector<JournalEntry>& dropped) {
+        while (!redoStack.empty()) {
+            messages -= redoStack.back().count;
+            dropped.push_back(std::move(redoStack.back()));
+            redoStack.pop_back();
+        }
+        if (entry.count > maxMessages) {
+            clear(dropped);
+            dropped.push_back(std::move(entry));
+            return;
+        }
+        messages += entry.count;
+        undoStack.push_back(std::move(entry));
+        while ((int)undoStack.size() > maxEntries || messages > maxMessages) {
+            messages -= undoStack.front().count;
+            dropped.push_back(std::move(undoStack.front()));
+            undoStack.pop_front();
+        }
+    }
+    
+    // Buang entry teratas tanpa di-undo/redo (semua pesannya sudah kedaluwarsa)
+    void dropUndo() {
+        messages -= undoStack.back().count;
+        undoStack.pop_back();
+    }
+    
+    void dropRedo() {
+        messages -= redoStack.back().count;
+        redoStack.pop_back();
+    }
+    
+    // count pesan dibuang dari entry karena sudah kedaluwarsa
+    void forgetMessages(int count) {
+        messages -= count;
+    }
+    
+    bool canUndo() const {
+        return !undoStack.empty();
+    }
+    
+    bool canRedo() const {
+        return !redoStack.empty();
+    }
+    
+    // Entry yang akan di-undo / di-redo berikutnya
+    const JournalEntry& peekUndo() const {
+        return undoStack.back();
+    }
+    
+    const JournalEntry& peekRedo() const {
+        return redoStack.back();
+    }
+    
+    // Pindahkan entry teratas dari stack undo ke redo (atau sebaliknya) setelah
+    // pemanggil membalik perubahannya
+    JournalEntry& beginUndo() {
+        redoStack.push_back(std::move(undoStack.back()));
+        undoStack.pop_back();
+        return redoStack.back();
+    }
+    
+    JournalEntry& beginRedo() {
+        undoStack.push_back(std::move(redoStack.back()));
+        redoStack.pop_back();
+        return undoStack.back();
+    }
+    
+    int getUndoCount() const {
+        return undoStack.size();
+    }
+    
+    int getRedoCount() const {
+        return redoStack.size();
+    }
+};
+
+// Class Queue menggunakan Doubly Linked List
+class QueuePesan {
+private:
+    Node* front;  // Depan antrian (untuk dequeue)
+    Node* rear;   // Belakang antrian (untuk enqueue)
+    int size;
+    int unreadCount; // Pesan yang belum dibaca (untuk daftar chat)
+    SpamFilter spamFilter;
+    RejectReason lastReject; // Alasan penolakan enqueue terakhir
+    string lastBlockedPhrase; // Frasa blocklist yang membuat pesan ditolak
+    long long lastRetryAfterMs; // Waktu tunggu jika ditolak rate limiter
+    const Blocklist* blocklist;
+    RateLimiter rateLimiter;
+    long long nextId; // ID untuk pesan berikutnya
+    HandleTable handles; // ID -> node
+    SearchIndex searchIndex;
+    // Thread pembersih: milik bersama (mis. per shard ChatEngine, lewat
+    // setReclaimer) atau dibuat sendiri saat pertama dibutuhkan. Dideklarasikan
+    // sebelum pool: dihancurkan paling akhir
+    unique_ptr<Reclaimer> ownReclaimer;
+    Reclaimer* reclaimer;
+    NodePool pool;
+    UndoJournal journal;
+    vector<JournalEntry> dropped; // Buffer entry yang dibuang journal
+    vector<Node*> restored;       // Buffer kerja restoreEntry
+    vector<long long> runSuccessors; // Penerus run ke-2 dst dari unlinkRuns, diambil retire
+    function<void()> onEnqueue;   // Dipanggil setiap enqueue berhasil
+    atomic<EpochDomain*> epochs;  // Pembaca scan() di thread lain (dibuat saat pembaca pertama)
+    
+    // Index kedaluwarsa: min-heap (expiresAt, ID). Entry pesan yang sudah
+    // dihapus tidak dicari di heap, tetapi dilewati saat sampai di puncak
+    typedef pair<long long, long long> ExpiryEntry;
+    priority_queue<ExpiryEntry, vector<ExpiryEntry>, greater<ExpiryEntry> > expiryIndex;
+    long long defaultTtlMs;       // TTL pesan baru di chat ini, 0 = permanen
+    long long expiredCount;
+    vector<Node*> expiring;       // Buffer kerja expire
+    long long journalCheckedAt;   // expiredCount saat puncak journal terakhir diperiksa
+    function<void(long long)> onExpiryChange; // Dipanggil saat deadline terdekat maju
+    
+    // Lane prioritas: setiap lane FIFO sendiri lewat laneNext/lanePrev (urut
+    // ID) di atas list utama yang tetap kronologis. Bit lane di laneMask
+    // menyala selama lane tidak kosong, jadi lane terdepan cukup satu ctz
+    Node* laneHead[PRIORITY_LANES];
+    Node* laneTail[PRIORITY_LANES];
+    int laneSize[PRIORITY_LANES];
+    unsigned laneMask;
+    int laneCredit[PRIORITY_LANES]; // Sisa jatah lane di putaran round robin
+    unsigned creditMask;            // Bit lane yang jatahnya belum habis
+    vector<Node*> picked;           // Buffer kerja dequeue(count)
+
+    // Rantai yang sudah dilepas tetapi mungkin masih dibaca scan() yang aktif
+    struct RetiredChain {
+        unsigned long long stamp;
+        Node* first;
+        Node* last;
+        int count;
+    };
+    deque<RetiredChain> limbo;
+    
+    // Link yang bisa dibaca scan() di thread lain ditulis atomic (release),
+    // jadi pembaca selalu melihat node yang sudah lengkap
+    static void setNext(Node* node, Node* next) {
+        __atomic_store_n(&node->next, next, __ATOMIC_RELEASE);
+    }
+    
+    void setFront(Node* node) {
+        __atomic_store_n(&front, node, __ATOMIC_RELEASE);
+    }
+    
+    // Writer: domain pembaca, nullptr jika belum pernah ada pembaca. Fence
+    // berpasangan dengan CAS di attachReader, seperti EpochDomain::hasReaders
+    EpochDomain* readerDomain() {
+        atomic_thread_fence(memory_order_seq_cst);
+        return epochs.load(memory_order_acquire);
+    }
+    
+    Reclaimer& backgroundReclaimer() {
+        if (reclaimer == nullptr) {
+            ownReclaimer.reset(new Reclaimer());
+            reclaimer = ownReclaimer.get();
+        }
+        return *reclaimer;
+    }
+    
+    // Index lama yang dilepas saat rebuild, dibebaskan oleh reclaimer
+    struct DetachedIndex {
+        BucketTable exact;
+        BucketTable lsh;
+        SearchIndex search;
+        HandleTable handles;
+    };
+    
+    // Kembalikan rantai first..last ke pool; jika pool penuh, rantai kecil
+    // langsung dihapus dan rantai besar dibebaskan di background. Selama ada
+    // pembaca scan(), rantai ditahan dulu sampai tidak ada scan yang bisa
+    // berdiri di atasnya
+    void recycle(Node* first, Node* last, int count) {
+        EpochDomain* domain = readerDomain();
+        if (limbo.empty() && (domain == nullptr || !domain->hasReaders())) {
+            freeChain(first, last, count);
+            return;
+        }
+        RetiredChain chain;
+        chain.stamp = domain->stamp();
+        chain.first = first;
+        chain.last = last;
+        chain.count = count;
+        limbo.push_back(chain);
+        reclaimRetired();
+    }
+    
+    // Bebaskan rantai di limbo yang sudah tidak mungkin dibaca scan()
+    void reclaimRetired() {
+        if (limbo.empty()) {
+            return;
+        }
+        unsigned long long oldest = readerDomain()->oldestActive();
+        while (!limbo.empty() && limbo.front().stamp < oldest) {
+            RetiredChain chain = limbo.front();
+            limbo.pop_front();
+            freeChain(chain.first, chain.last, chain.count);
+        }
+    }
+    
+    void freeChain(Node* first, Node* last, int count) {
+        if (pool.release(first, last, count)) {
+            return;
+        }
+        last->next = nullptr;
+        if (count < 64) {
+            while (first != nullptr) {
+                Node* node = first;
+                first = first->next;
+                delete node;
+            }
+            return;
+        }
+        backgroundReclaimer().dispose([first]() {
+            Node* node = first;
+            while (node != nullptr) {
+                Node* next = node->next;
+                delete node;
+                node = next;
+            }
+        });
+    }
+    
+    // Kembalikan rantai node dari entry yang dibuang journal
+    void recycleDropped() {
+        for (size_t i = 0; i < dropped.size(); i++) {
+            if (dropped[i].nodes != nullptr) {
+                recycle(dropped[i].nodes, dropped[i].nodesLast, dropped[i].count);
+            }
+        }
+        dropped.clear();
+    }
+    
+    void record(JournalEntry& entry) {
+        journal.record(entry, dropped);
+        recycleDropped();
+    }
+    
+    // Rantai first..last yang sudah dilepas dari list dan index disimpan di
+    // journal untuk undo; tanpa journal (atau undoable = false) langsung di-recycle.
+    // successor: pesan hidup tepat setelah first (nullptr = di belakang),
+    // dicatat bersama penerus run lain (runSuccessors) sebagai petunjuk undo
+    void retire(Node* first, Node* last, int count, Node* successor, bool undoable = true) {
+        setNext(last, nullptr);
+        if (!undoable || !journal.isEnabled()) {
+            runSuccessors.clear();
+            recycle(first, last, count);
+            return;
+        }
+        JournalEntry entry(JOURNAL_REMOVE, count);
+        entry.nodes = first;
+        entry.nodesLast = last;
+        entry.successorId = (successor != nullptr) ? successor->data.id : 0;
+        entry.successorIds.swap(runSuccessors);
+        if (count == 1 && first->lanePrev != nullptr) {
+            entry.lanePrevId = first->lanePrev->data.id;
+        }
+        record(entry);
+    }
+    
+    // Daftarkan node ke semua index (kebalikan unindex, tanpa riwayat spam)
+    void reindex(Node* node) {
+        spamFilter.link(node);
+        searchIndex.add(node->data.id, node->data.text);
+        handles.insert(node->data.id, node);
+        linkLane(node, laneTail[node->data.priority]);
+    }
+    
+    // Sambungkan node ke lane-nya tepat setelah after (nullptr = kepala lane).
+    // Node baru dan rebuild index selalu ke ekor lane; node yang dipulihkan
+    // undo memakai lanePredecessor
+    void linkLane(Node* node, Node* after) {
+        int lane = node->data.priority;
+        node->lanePrev = after;
+        node->laneNext = (after != nullptr) ? after->laneNext : laneHead[lane];
+        if (after != nullptr) {
+            after->laneNext = node;
+        } else {
+            laneHead[lane] = node;
+        }
+        if (node->laneNext != nullptr) {
+            node->laneNext->lanePrev = node;
+        } else {
+            laneTail[lane] = node;
+        }
+        laneSize[lane]++;
+        laneMask |= 1u << lane;
+    }
+    
+    void unlinkLane(Node* node) {
+        int lane = node->data.priority;
+        if (node->lanePrev != nullptr) {
+            node->lanePrev->laneNext = node->laneNext;
+        } else {
+            laneHead[lane] = node->laneNext;
+        }
+        if (node->laneNext != nullptr) {
+            node->laneNext->lanePrev = node->lanePrev;
+        } else {
+            laneTail[lane] = node->lanePrev;
+        }
+        if (--laneSize[lane] == 0) {
+            laneMask &= ~(1u << lane);
+            if (laneMask == 0) {
+                creditMask = 0; // Queue kosong: putaran round robin mulai dari awal
+            }
+        }
+    }
+    
+    // true jika node bisa disambung tepat setelah after di lane-nya (urut ID)
+    bool fitsInLane(Node* after, Node* node) {
+        int lane = node->data.priority;
+        if (after != nullptr && (after->data.priority != lane || after->data.id > node->data.id)) {
+            return false;
+        }
+        Node* next = (after != nullptr) ? after->laneNext : laneHead[lane];
+        return next == nullptr || next->data.id > node->data.id;
+    }
+    
+    // Node lane yang sama tepat sebelum node yang dipulihkan undo (nullptr =
+    // kepala lane) tanpa menyusuri list: ekor lane, node lane ini yang baru
+    // saja dipulihkan, atau tetangga lane yang dicatat saat dilepas (hintId).
+    // Semua kandidat dicek; hanya jika tidak ada yang cocok (tetangganya
+    // sudah kedaluwarsa) dicari mundur lewat list utama (node->prev harus
+    // sudah tersambung)
+    Node* lanePredecessor(Node* node, Node* restoredBefore, long long hintId) {
+        Node* candidates[3] = {laneTail[node->data.priority], restoredBefore,
+            (hintId != 0) ? handles.find(hintId) : nullptr};
+        for (int i = 0; i < 3; i++) {
+            if (candidates[i] != nullptr && fitsInLane(candidates[i], node)) {
+                return candidates[i];
+            }
+        }
+        if (fitsInLane(nullptr, node)) {
+            return nullptr;
+        }
+        Node* after = node->prev;
+        while (after != nullptr && after->data.priority != node->data.priority) {
+            after = after->prev;
+        }
+        return after;
+    }
+    
+    // Kosongkan lane tanpa menyentuh jatah round robin (dipakai rebuild index)
+    void clearLanes() {
+        for (int i = 0; i < PRIORITY_LANES; i++) {
+            laneHead[i] = laneTail[i] = nullptr;
+            laneSize[i] = 0;
+        }
+        laneMask = 0;
+    }
+    
+    // Lane yang dilayani dequeue berikutnya di antara lane di nonEmpty
+    // (weighted round robin): lane paling mendesak yang jatahnya belum habis
+    // dilayani dulu, dan jatah semua lane diisi ulang (LANE_WEIGHTS) setelah
+    // lane yang menunggu kehabisan jatah. Lane normal tetap kebagian minimal
+    // 1 dari setiap 7 pesan, jadi tidak pernah kelaparan - O(1)
+    int nextLane(unsigned nonEmpty) {
+        unsigned ready = nonEmpty & creditMask;
+        if (ready == 0) {
+            for (int i = 0; i < PRIORITY_LANES; i++) {
+                laneCredit[i] = LANE_WEIGHTS[i];
+            }
+            creditMask = (1u << PRIORITY_LANES) - 1;
+            ready = nonEmpty;
+        }
+        int lane = __builtin_ctz(ready);
+        if (--laneCredit[lane] == 0) {
+            creditMask &= ~(1u << lane);
+        }
+        return lane;
+    }
+    
+    // Sama dengan count kali nextLane saat hanya lane ini yang berisi - O(1)
+    void consumeCredits(int lane, int count) {
+        unsigned bit = 1u << lane;
+        if (creditMask & bit) {
+            int taken = min(count, laneCredit[lane]);
+            laneCredit[lane] -= taken;
+            count -= taken;
+        }
+        if (count > 0) {
+            for (int i = 0; i < PRIORITY_LANES; i++) {
+                laneCredit[i] = LANE_WEIGHTS[i];
+            }
+            creditMask = (1u << PRIORITY_LANES) - 1;
+            laneCredit[lane] -= (count - 1) % LANE_WEIGHTS[lane] + 1;
+        }
+        if (laneCredit[lane] == 0) {
+            creditMask &= ~bit;
+        }
+    }
+    
+    // Lepas node (urut ID, tanpa duplikat) dari list utama per run yang
+    // bersebelahan (satu sambungan ulang per run) lalu sambung menjadi satu
+    // rantai first..last lewat next. Penerus run pertama dikembalikan lewat
+    // successor, penerus run berikutnya dicatat di runSuccessors untuk retire
+    void unlinkRuns(const vector<Node*>& nodes, Node*& first, Node*& last, Node*& successor) {
+        first = last = successor = nullptr;
+        runSuccessors.clear();
+        for (size_t i = 0; i < nodes.size(); ) {
+            Node* runFirst = nodes[i];
+            Node* runLast = runFirst;
+            while (++i < nodes.size() && nodes[i] == runLast->next) {
+                runLast = nodes[i];
+            }
+            if (last == nullptr) {
+                successor = runLast->next;
+            } else {
+                runSuccessors.push_back((runLast->next != nullptr) ? runLast->next->data.id : 0);
+            }
+            if (runFirst->prev != nullptr) {
+                setNext(runFirst->prev, runLast->next);
+            } else {
+                setFront(runLast->next);
+            }
+            if (runLast->next != nullptr) {
+                runLast->next->prev = runFirst->prev;
+            } else {
+                rear = runFirst->prev;
+            }
+            runFirst->prev = last;
+            if (last == nullptr) {
+                first = runFirst;
+            } else {
+                setNext(last, runFirst);
+            }
+            last = runLast;
+        }
+        setNext(last, nullptr);
+    }
+    
+    // true jika pesan id bisa disisipkan tepat sebelum successor (nullptr = di belakang)
+    bool fitsBefore(Node* successor, long long id) {
+        if (successor != nullptr && successor->data.id < id) {
+            return false;
+        }
+        Node* before = (successor != nullptr) ? successor->prev : rear;
+        return before == nullptr || before->data.id < id;
+    }
+    
+    // Node hidup pertama dengan ID lebih besar dari id (nullptr = di
+    // belakang). hintId adalah penerus yang dicatat saat pesan dilepas
+    // (0 = di belakang); jika sudah tidak cocok, list disusuri dari ujung
+    // yang lebih dekat - tidak pernah lebih dari size langkah
+    Node* successorOf(long long id, long long hintId) {
+        Node* hinted = (hintId != 0) ? handles.find(hintId) : nullptr;
+        if ((hintId == 0 || hinted != nullptr) && fitsBefore(hinted, id)) {
+            return hinted;
+        }
+        if (fitsBefore(nullptr, id)) {
+            return nullptr;
+        }
+        if (fitsBefore(front, id)) {
+            return front;
+        }
+        Node* node;
+        if (id - front->data.id < rear->data.id - id) {
+            for (node = front; node->data.id < id; node = node->next) {}
+        } else {
+            for (node = rear; node->prev->data.id > id; node = node->prev) {}
+        }
+        return node;
+    }
+    
+    // Penerus node id saat rantai terpecah (ada pesan hidup di antara dua
+    // node rantai): penerus run berikutnya yang dicatat saat dilepas, atau
+    // jika sudah tidak cocok, maju dari penerus sebelumnya (from)
+    Node* nextRunSuccessor(const JournalEntry& entry, size_t& run, Node* from, long long id) {
+        const vector<long long>& hints = entry.successorIds;
+        while (run < hints.size() && hints[run] != 0 && hints[run] < id) {
+            run++;
+        }
+        if (run < hints.size()) {
+            Node* hinted = (hints[run] != 0) ? handles.find(hints[run]) : nullptr;
+            if ((hints[run] == 0 || hinted != nullptr) && fitsBefore(hinted, id)) {
+                return hinted;
+            }
+        }
+        while (from != nullptr && from->data.id < id) {
+            from = from->next;
+        }
+        return from;
+    }
+    
+    // Kembalikan rantai node entry ke posisi asalnya (list selalu urut ID).
+    // Posisi diambil dari penerus yang dicatat saat dilepas; node berikutnya
+    // di rantai cukup ditaruh setelah node sebelumnya, atau sebelum penerus
+    // run berikutnya jika rantai terpecah. Lane memakai petunjuk yang sama
+    // (lanePredecessor), jadi undo O(jumlah node), tidak bergantung pada
+    // jarak ID, ukuran queue, atau isi lane lain
+    void restoreEntry(JournalEntry& entry) {
+        Node* node = entry.nodes;
+        Node* successor = successorOf(node->data.id, entry.successorId);
+        Node* laneRestored[PRIORITY_LANES] = {};
+        size_t run = 0;
+        entry.ids.clear();
+        restored.clear();
+        while (node != nullptr) {
+            Node* nextInChain = node->next;
+            if (successor != nullptr && successor->data.id < node->data.id) {
+                successor = nextRunSuccessor(entry, run, successor, node->data.id);
+            }
+            setNext(node, successor);
+            node->prev = (successor != nullptr) ? successor->prev : rear;
+            if (node->prev != nullptr) {
+                setNext(node->prev, node);
+            } else {
+                setFront(node);
+            }
+            if (successor != nullptr) {
+                successor->prev = node;
+            } else {
+                rear = node;
+            }
+            spamFilter.link(node);
+            handles.insert(node->data.id, node);
+            Node* laneAfter = lanePredecessor(node, laneRestored[node->data.priority],
+                (entry.count == 1) ? entry.lanePrevId : 0);
+            linkLane(node, laneAfter);
+            laneRestored[node->data.priority] = node;
+            restored.push_back(node);
+            if (node->data.expiresAt > 0) {
+                trackExpiry(node);
+            }
+            if (!node->data.isRead) unreadCount++;
+            if (entry.count == 1) {
+                entry.id = node->data.id;
+            } else {
+                entry.ids.push_back(node->data.id);
+            }
+            node = nextInChain;
+        }
+        searchIndex.addBatch(restored, restored.back() == rear);
+        size += entry.count;
+        entry.nodes = entry.nodesLast = nullptr;
+        vector<long long>().swap(entry.successorIds);
+    }
+    
+    static void noteRunSuccessor(JournalEntry& entry, int run, Node* successor) {
+        long long id = (successor != nullptr) ? successor->data.id : 0;
+        if (run == 0) {
+            entry.successorId = id;
+        } else {
+            entry.successorIds.push_back(id);
+        }
+    }
+    
+    // Lepas pesan dengan ID di entry dari list dan index menjadi rantai node,
+    // sambil mencatat penerus tiap run dan tetangga lane untuk undo berikutnya
+    void detachEntry(JournalEntry& entry) {
+        Node* first = nullptr;
+        Node* last = nullptr;
+        Node* runNext = nullptr; // Penerus run yang sedang dilepas
+        int runs = 0;
+        entry.successorIds.clear();
+        entry.lanePrevId = 0;
+        for (int i = 0; i < entry.count; i++) {
+            Node* node = handles.find(entry.idAt(i));
+            if (i > 0 && node != runNext) {
+                noteRunSuccessor(entry, runs++, runNext);
+            }
+            runNext = node->next;
+            if (entry.count == 1 && node->lanePrev != nullptr) {
+                entry.lanePrevId = node->lanePrev->data.id;
+            }
+            unindex(node);
+            if (node->prev != nullptr) {
+                setNext(node->prev, node->next);
+            } else {
+                setFront(node->next);
+            }
+            if (node->next != nullptr) {
+                node->next->prev = node->prev;
+            } else {
+                rear = node->prev;
+            }
+            setNext(node, nullptr);
+            if (last == nullptr) {
+                first = node;
+            } else {
+                setNext(last, node);
+            }
+            last = node;
+        }
+        noteRunSuccessor(entry, runs, runNext);
+        size -= entry.count;
+        entry.nodes = first;
+        entry.nodesLast = last;
+        vector<long long>().swap(entry.ids);
+    }
+    
+    // Pesan kedaluwarsa tidak dicari di journal saat expire (biayanya akan
+    // sebanding ukuran journal). Entry yang merujuk pesan lewat ID baru
+    // diperiksa saat sampai di puncak stack: entry yang semua pesannya sudah
+    // hilang dibuang, ID yang hilang disaring saat entry dijalankan
+    bool isStale(const JournalEntry& entry) {
+        if (entry.nodes != nullptr) {
+            return false;
+        }
+        for (int i = 0; i < entry.count; i++) {
+            if (handles.find(entry.idAt(i)) != nullptr) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    // Cukup sekali setiap ada pesan baru yang kedaluwarsa atau puncak berubah
+    void trimStale() {
+        if (journalCheckedAt == expiredCount) {
+            return;
+        }
+        journalCheckedAt = expiredCount;
+        while (journal.canUndo() && isStale(journal.peekUndo())) {
+            journal.dropUndo();
+        }
+        while (journal.canRedo() && isStale(journal.peekRedo())) {
+            journal.dropRedo();
+        }
+    }
+    
+    void dropExpiredIds(JournalEntry& entry) {
+        if (entry.nodes != nullptr || entry.count < 2) {
+            return; // Entry 1 pesan yang kedaluwarsa sudah dibuang trimStale
+        }
+        size_t out = 0;
+        for (size_t i = 0; i < entry.ids.size(); i++) {
+            if (handles.find(entry.ids[i]) != nullptr) {
+                entry.ids[out++] = entry.ids[i];
+            }
+        }
+        journal.forgetMessages(entry.count - out);
+        entry.ids.resize(out);
+        entry.count = out;
+        if (out == 1) {
+            entry.id = entry.ids[0];
+            vector<long long>().swap(entry.ids);
+        }
+    }
+    
+    // Balik (undo) atau ulangi (redo) satu entry journal
+    void applyEntry(JournalEntry& entry, bool undo) {
+        dropExpiredIds(entry);
+        journalCheckedAt = -1; // Puncak stack berubah
+        if (entry.op == JOURNAL_MARK_READ) {
+            for (int i = 0; i < entry.count; i++) {
+                handles.find(entry.idAt(i))->data.isRead = !undo;
+            }
+            unreadCount += undo ? entry.count : -entry.count;
+        } else if ((entry.op == JOURNAL_INSERT) == undo) {
+            detachEntry(entry);
+        } else {
+            restoreEntry(entry);
+        }
+    }
+    
+    // Tandai satu pesan dibaca dan catat di journal jika statusnya berubah
+    void markNode(Node* node) {
+        if (node->data.isRead) {
+            return;
+        }
+        node->data.isRead = true;
+        unreadCount--;
+        if (journal.isEnabled()) {
+            JournalEntry entry(JOURNAL_MARK_READ, 1);
+            entry.id = node->data.id;
+            record(entry);
+        }
+    }
+    
+    static string describeEntry(const JournalEntry& entry) {
+        char buf[64];
+        if (entry.op == JOURNAL_INSERT) {
+            snprintf(buf, sizeof(buf), "kirim pesan #%lld", entry.idAt(0));
+        } else if (entry.op == JOURNAL_REMOVE && entry.count == 1) {
+            long long id = entry.nodes != nullptr ? entry.nodes->data.id : entry.id;
+            snprintf(buf, sizeof(buf), "hapus pesan #%lld", id);
+        } else if (entry.op == JOURNAL_REMOVE) {
+            snprintf(buf, sizeof(buf), "hapus %d pesan", entry.count);
+        } else if (entry.count == 1) {
+            snprintf(buf, sizeof(buf), "tandai pesan #%lld dibaca", entry.id);
+        } else {
+            snprintf(buf, sizeof(buf), "tandai %d pesan dibaca", entry.count);
+        }
+        return buf;
+    }
+    
+    // Lepaskan node dari semua index (termasuk lane prioritas) sebelum dihapus
+    void unindex(Node* node) {
+        if (!node->data.isRead) unreadCount--;
+        spamFilter.remove(node);
+        searchIndex.remove(node->data.id, node->data.text);
+        handles.erase(node->data.id);
+        unlinkLane(node);
+    }
+    
+    // Buang rantai first..last (sudah dilepas dari list, count node) dari
+    // index lalu kembalikan ke pool. Jika yang dihapus lebih banyak dari yang
+    // tersisa, index lama dilepas utuh dan dibangun ulang dari sisa pesan,
+    // jadi biayanya O(min(count, sisa)) dan menghapus semua pesan cukup O(1)
+    void reclaimRange(Node* first, Node* last, int count, Node* successor, bool undoable = true) {
+        int remaining = size - count;
+        if (count <= remaining) {
+            for (Node* node = first; node != nullptr; node = node->next) {
+                unindex(node);
+            }
+        } else {
+            DetachedIndex* old = new DetachedIndex();
+            spamFilter.detachIndex(old->exact, old->lsh);
+            searchIndex.swap(old->search);
+            handles.swap(old->handles);
+            if (count >= 64) {
+                backgroundReclaimer().dispose([old]() { delete old; });
+            } else {
+                delete old;
+            }
+            unreadCount = 0;
+            clearLanes();
+            for (Node* node = front; node != nullptr; node = node->next) {
+                reindex(node);
+                if (!node->data.isRead) unreadCount++;
+            }
+            if (laneMask == 0) {
+                creditMask = 0; // Sama dengan unlinkLane: queue kosong, putaran mulai dari awal
+            }
+        }
+        size = remaining;
+        retire(first, last, count, successor, undoable);
+    }
+    
+    // Daftarkan deadline node ke index kedaluwarsa. Jika heap sudah lebih
+    // dari 2x jumlah pesan (sisa entry pesan yang dihapus), heap dibangun
+    // ulang dari list: O(n) setelah minimal n push, jadi amortized O(log n)
+    void trackExpiry(Node* node) {
+        bool earliest = expiryIndex.empty() || node->data.expiresAt < expiryIndex.top().first;
+        expiryIndex.push(ExpiryEntry(node->data.expiresAt, node->data.id));
+        if (expiryIndex.size() > 2 * (size_t)size + 64) {
+            vector<ExpiryEntry> live;
+            for (Node* current = front; current != nullptr; current = current->next) {
+                if (current->data.expiresAt > 0) {
+                    live.push_back(ExpiryEntry(current->data.expiresAt, current->data.id));
+                }
+            }
+            expiryIndex = priority_queue<ExpiryEntry, vector<ExpiryEntry>, greater<ExpiryEntry> >(
+                greater<ExpiryEntry>(), std::move(live));
+        }
+        if (earliest && onExpiryChange) {
+            onExpiryChange(node->data.expiresAt);
+        }
+    }
+    
+    // Entry heap masih milik pesan yang ada di queue dengan deadline yang sama
+    bool isLiveExpiry(const ExpiryEntry& entry) {
+        Node* node = handles.find(entry.second);
+        return node != nullptr && node->data.expiresAt == entry.first;
+    }
+    
+    // Node ke-index dari depan, jalan dari ujung yang lebih dekat
+    Node* nodeAt(int index) {
+        if (index < size / 2) {
+            Node* current = front;
+            for (int i = 0; i < index; i++) current = current->next;
+            return current;
+        }
+        Node* current = rear;
+        for (int i = size - 1; i > index; i--) current = current->prev;
+        return current;
+    }
+    
+public:
+    QueuePesan() : front(nullptr), rear(nullptr), size(0), unreadCount(0), spamFilter(&handles),
+                   lastReject(REJECT_NONE), lastRetryAfterMs(0), blocklist(nullptr), nextId(1),
+                   reclaimer(nullptr), epochs(nullptr), defaultTtlMs(0), expiredCount(0),
+                   journalCheckedAt(0) {
+        clearLanes();
+        memset(laneCredit, 0, sizeof(laneCredit));
+        creditMask = 0;
+    }
+    
+    // Destructor untuk membersihkan memory
+    ~QueuePesan() {
+        while (front != nullptr) {
+            Node* temp = front;
+            front = front->next;
+            delete temp;
+        }
+        // Semua pembaca sudah selesai: rantai di limbo aman dibebaskan
+        while (!limbo.empty()) {
+            freeChain(limbo.front().first, limbo.front().last, limbo.front().count);
+            limbo.pop_front();
+        }
+        delete epochs.load();
+    }
+    
+    // Mengecek apakah queue kosong
+    bool isEmpty() {
+        return front == nullptr;
+    }
+    
+    // Mendapatkan jumlah pesan
+    int getSize() {
+        return size;
+    }
+    
+    // Mendapatkan jumlah pesan yang belum dibaca - O(1)
+    int getUnreadCount() {
+        return unreadCount;
+    }
+    
+    // Pesan yang akan diambil dequeue() berikutnya, tanpa memakai giliran
+    // lane (nullptr jika kosong) - O(1)
+    Node* peekNext() {
+        if (laneMask == 0) {
+            return nullptr;
+        }
+        unsigned ready = laneMask & creditMask;
+        return laneHead[__builtin_ctz(ready != 0 ? ready : laneMask)];
+    }
+    
+    // Jumlah pesan di lane prioritas (MessagePriority) - O(1)
+    int getLaneSize(int lane) {
+        return laneSize[lane];
+    }
+    
+    // Pesan terlama di lane prioritas (nullptr jika lane kosong)
+    Node* getLaneFront(int lane) {
+        return laneHead[lane];
+    }
+    
+    // TTL untuk pesan baru di chat ini (pesan yang sudah ada tidak berubah)
+    void setTtl(long long ttlMs) {
+        defaultTtlMs = ttlMs > 0 ? ttlMs : 0;
+    }
+    
+    long long getTtl() {
+        return defaultTtlMs;
+    }
+    
+    long long getExpiredCount() {
+        return expiredCount;
+    }
+    
+    // Callback saat deadline kedaluwarsa terdekat menjadi lebih awal
+    void setExpiryListener(function<void(long long)> listener) {
+        onExpiryChange = listener;
+    }
+    
+    // Deadline kedaluwarsa terdekat (-1 jika tidak ada); entry basi dibuang
+    long long nextExpiryMs() {
+        while (!expiryIndex.empty() && !isLiveExpiry(expiryIndex.top())) {
+            expiryIndex.pop();
+        }
+        return expiryIndex.empty() ? -1 : expiryIndex.top().first;
+    }
+    
+    // Hapus semua pesan yang kedaluwarsa sampai nowMs sekaligus. Node yang
+    // bersebelahan di list dilepas per run (unlinkRuns), lalu seluruh
+    // rantai dibuang dari index dalam satu reclaimRange. Pesan
+    // kedaluwarsa hilang permanen: tidak masuk journal, dan entry journal
+    // yang merujuknya dibersihkan saat dipakai (trimStale)
+    int expire(long long nowMs) {
+        expiring.clear();
+        while (!expiryIndex.empty() && expiryIndex.top().first <= nowMs) {
+            if (isLiveExpiry(expiryIndex.top())) {
+                expiring.push_back(handles.find(expiryIndex.top().second));
+            }
+            expiryIndex.pop();
+        }
+        if (expiring.empty()) {
+            return 0;
+        }
+        ScopedLatency timer(STAT_EXPIRE);
+        sort(expiring.begin(), expiring.end(), [](Node* a, Node* b) {
+            return a->data.id < b->data.id;
+        });
+        // Pesan yang dipulihkan undo bisa punya dua entry heap dengan deadline sama
+        expiring.erase(unique(expiring.begin(), expiring.end()), expiring.end());
+        
+        Node* first;
+        Node* last;
+        Node* successor;
+        unlinkRuns(expiring, first, last, successor);
+        
+        int count = expiring.size();
+        expiredCount += count;
+        reclaimRange(first, last, count, successor, false);
+        return count;
+    }
+    
+    // Callback setiap pesan baru masuk (mis. untuk urutan daftar chat)
+    void setEnqueueListener(function<void()> listener) {
+        onEnqueue = listener;
+    }
+    
+    // Enqueue - Menambah pesan baru (dengan spam filter). ttlMs: umur pesan
+    // sebelum hilang otomatis; -1 = TTL chat (setTtl), 0 = permanen.
+    // priority: lane pesan; -1 = ditentukan dari text (classifyPriority)
+    bool enqueue(string text, long long ttlMs = -1, int priority = -1) {
+        ScopedLatency timer(STAT_ENQUEUE);
+        
+        // Rate limiter: O(1), dicek sebelum filter lain yang lebih mahal
+        long long now = currentTimeMs();
+        if (!rateLimiter.allow(now)) {
+            lastReject = REJECT_RATE_LIMITED;
+            lastRetryAfterMs = rateLimiter.retryAfterMs(now);
+            return false;
+        }
+        
+        // Blocklist: satu kali scan Aho-Corasick
+        if (blocklist != nullptr) {
+            shared_ptr<const KeywordAutomaton> automaton = blocklist->current();
+            int match = (automaton != nullptr) ? automaton->findFirst(text) : -1;
+            if (match >= 0) {
+                lastReject = REJECT_BLOCKED;
+                lastBlockedPhrase = automaton->getPattern(match);
+                return false;
+            }
+        }
+        
+        // Spam Filter: tolak pesan yang sama persis atau terlalu mirip
+        SpamFingerprint fingerprint;
+        lastReject = spamFilter.check(text, fingerprint);
+        if (lastReject != REJECT_NONE) {
+            return false; // Tolak pesan (spam)
+        }
+        
+        Pesan newPesan(text, false, now);
+        newPesan.id = nextId++;
+        if (ttlMs < 0) {
+            ttlMs = defaultTtlMs;
+        }
+        newPesan.expiresAt = ttlMs > 0 ? now + ttlMs : 0;
+        newPesan.priority = (priority >= 0 && priority < PRIORITY_LANES) ? priority : classifyPriority(text);
+        Node* newNode = pool.acquire(newPesan);
+        newNode->fingerprint = fingerprint;
+        newNode->foldedText = newPesan.text;
+        foldAsciiInPlace(newNode->foldedText);
+        spamFilter.add(newNode);
+        searchIndex.add(newPesan.id, newPesan.text);
+        handles.insert(newPesan.id, newNode);
+        rateLimiter.record(now);
+        if (journal.isEnabled()) {
+            JournalEntry entry(JOURNAL_INSERT, 1);
+            entry.id = newPesan.id;
+            record(entry);
+        }
+        
+        if (isEmpty()) {
+            setFront(newNode);
+            rear = newNode;
+        } else {
+            setNext(rear, newNode);
+            newNode->prev = rear;
+            rear = newNode;
+        }
+        linkLane(newNode, laneTail[newPesan.priority]);
+        size++;
+        unreadCount++;
+        if (newPesan.expiresAt > 0) {
+            trackExpiry(newNode);
+        }
+        if (onEnqueue) {
+            onEnqueue();
+        }
+        return true;
+    }
+    
+    // Dequeue - Menghapus pesan berikutnya sesuai prioritas: pesan terlama
+    // di lane yang mendapat giliran (nextLane). Jika semua pesan satu lane,
+    // ini selalu pesan pertama (FIFO biasa)
+    bool dequeue() {
+        ScopedLatency timer(STAT_DEQUEUE);
+        
+        if (isEmpty()) {
+            return false;
+        }
+        
+        Node* temp = laneHead[nextLane(laneMask)];
+        unindex(temp);
+        if (temp->prev != nullptr) {
+            setNext(temp->prev, temp->next);
+        } else {
+            setFront(temp->next);
+        }
+        if (temp->next != nullptr) {
+            temp->next->prev = temp->prev;
+        } else {
+            rear = temp->prev;
+        }
+        
+        retire(temp, temp, 1, temp->next);
+        size--;
+        return true;
+    }
+    
+    // Dequeue n pesan berikutnya sekaligus (urutan sama dengan n kali
+    // dequeue()); mengembalikan jumlah yang terhapus
+    int dequeue(int count) {
+        ScopedLatency timer(STAT_BULK_REMOVE);
+        
+        if (count > size) count = size;
+        if (count <= 0) {
+            return 0;
+        }
+        
+        // Pesan dari beberapa lane: pilih n pesan sesuai giliran lane (kursor
+        // per lane, tanpa mengubah list), lalu lepas per run seperti expire
+        if ((laneMask & (laneMask - 1)) != 0 && count < size) {
+            Node* cursor[PRIORITY_LANES];
+            for (int i = 0; i < PRIORITY_LANES; i++) {
+                cursor[i] = laneHead[i];
+            }
+            unsigned nonEmpty = laneMask;
+            picked.clear();
+            for (int i = 0; i < count; i++) {
+                int lane = nextLane(nonEmpty);
+                picked.push_back(cursor[lane]);
+                cursor[lane] = cursor[lane]->laneNext;
+                if (cursor[lane] == nullptr) {
+                    nonEmpty &= ~(1u << lane);
+                }
+            }
+            sort(picked.begin(), picked.end(), [](Node* a, Node* b) {
+                return a->data.id < b->data.id;
+            });
+            Node* first;
+            Node* last;
+            Node* successor;
+            unlinkRuns(picked, first, last, successor);
+            reclaimRange(first, last, count, successor);
+            return count;
+        }
+        
+        // Satu lane (atau semua pesan): n pesan pertama di list
+        if (count < size) {
+            consumeCredits(__builtin_ctz(laneMask), count);
+        }
+        Node* first = front;
+        Node* last = (count == size) ? rear : nodeAt(count - 1);
+        setFront(last->next);
+        if (front == nullptr) {
+            rear = nullptr;
+        } else {
+            front->prev = nullptr;
+        }
+        setNext(last, nullptr);
+        
+        reclaimRange(first, last, count, front);
+        return count;
+    }
+    
+    // Membatalkan pesan terakhir (Rear) - Fitur khusus Doubly Linked List
+    bool cancelLast() {
+        ScopedLatency timer(STAT_CANCEL_LAST);
+        
+        if (isEmpty()) {
+            return false;
+        }
+        
+        Node* temp = rear;
+        unindex(temp);
+        rear = rear->prev;
+        
+        if (rear == nullptr) {
+            setFront(nullptr);
+        } else {
+            setNext(rear, nullptr);
+        }
+        
+        retire(temp, temp, 1, nullptr);
+        size--;
+        return true;
+    }
+    
+    // Membatalkan n pesan terakhir sekaligus; mengembalikan jumlah yang terhapus
+    int cancelLast(int count) {
+        ScopedLatency timer(STAT_BULK_REMOVE);
+        
+        if (count > size) count = size;
+        if (count <= 0) {
+            return 0;
+        }
+        
+        Node* first = (count == size) ? front : nodeAt(size - count);
+        Node* last = rear;
+        rear = first->prev;
+        if (rear == nullptr) {
+            setFront(nullptr);
+        } else {
+            setNext(rear, nullptr);
+        }
+        first->prev = nullptr;
+        
+        reclaimRange(first, last, count, nullptr);
+        return count;
+    }
+    
+    // Menandai pesan sebagai dibaca
+    bool markAsRead(int index) {
+        ScopedLatency timer(STAT_MARK_READ);
+        
+        if (isEmpty() || index < 0 || index >= size) {
+            return false;
+        }
+        
+        Node* current = front;
+        for (int i = 0; i < index && current != nullptr; i++) {
+            current = current->next;
+        }
+        
+        if (current != nullptr) {
+            markNode(current);
+            return true;
+        }
+        return false;
+    }
+    
+    // Mencari pesan berdasarkan ID - O(1)
+    Node* findById(long long id) {
+        return handles.find(id);
+    }
+    
+    // Menandai pesan sebagai dibaca berdasarkan ID - O(1)
+    bool markAsReadById(long long id) {
+        ScopedLatency timer(STAT_MARK_READ);
+        
+        Node* node = handles.find(id);
+        if (node == nullptr) {
+            return false;
+        }
+        markNode(node);
+        return true;
+    }
+    
+    // Menandai banyak pesan sekaligus (satu langkah undo); mengembalikan
+    // jumlah ID yang ditemukan
+    int markAsReadByIds(const vector<long long>& ids) {
+        ScopedLatency timer(STAT_MARK_READ);
+        
+        JournalEntry entry(JOURNAL_MARK_READ, 0);
+        int found = 0;
+        for (size_t i = 0; i < ids.size(); i++) {
+            Node* node = handles.find(ids[i]);
+            if (node == nullptr) continue;
+            found++;
+            if (!node->data.isRead) {
+                node->data.isRead = true;
+                unreadCount--;
+                entry.ids.push_back(ids[i]);
+            }
+        }
+        entry.count = entry.ids.size();
+        if (entry.count == 1) {
+            entry.id = entry.ids[0];
+            entry.ids.clear();
+        }
+        if (entry.count > 0 && journal.isEnabled()) {
+            record(entry);
+        }
+        return found;
+    }
+    
+    // Tandai banyak pesan sudah terkirim ke penerima (ack dari pipeline
+    // delivery); ID yang sudah dihapus dilewati. Return jumlah yang berubah
+    int markDelivered(const long long* ids, int count) {
+        int changed = 0;
+        for (int i = 0; i < count; i++) {
+            Node* node = handles.find(ids[i]);
+            if (node != nullptr && !node->data.isDelivered) {
+                node->data.isDelivered = true;
+                changed++;
+            }
+        }
+        return changed;
+    }
+    
+    // Undo perubahan terakhir; false jika journal kosong
+    bool undo() {
+        ScopedLatency timer(STAT_UNDO);
+        
+        trimStale();
+        if (!journal.canUndo()) {
+            return false;
+        }
+        applyEntry(journal.beginUndo(), true);
+        return true;
+    }
+    
+    // Ulangi perubahan yang terakhir di-undo; false jika tidak ada
+    bool redo() {
+        ScopedLatency timer(STAT_REDO);
+        
+        trimStale();
+        if (!journal.canRedo()) {
+            return false;
+        }
+        applyEntry(journal.beginRedo(), false);
+        return true;
+    }
+    
+    bool canUndo() {
+        trimStale();
+        return journal.canUndo();
+    }
+    
+    bool canRedo() {
+        trimStale();
+        return journal.canRedo();
+    }
+    
+    // Deskripsi singkat perubahan yang akan di-undo / di-redo ("hapus 3 pesan")
+    string describeUndo() {
+        trimStale();
+        return journal.canUndo() ? describeEntry(journal.peekUndo()) : "";
+    }
+    
+    string describeRedo() {
+        trimStale();
+        return journal.canRedo() ? describeEntry(journal.peekRedo()) : "";
+    }
+    
+    // Mengatur batas journal undo (0 entry = nonaktif); riwayat lama dibuang
+    void setUndoLimit(int entries, long long messages) {
+        journal.configure(entries, messages, dropped);
+        recycleDropped();
+    }
+    
+    // Menghapus pesan berdasarkan ID (di posisi mana pun) - O(1)
+    bool removeById(long long id) {
+        ScopedLatency timer(STAT_REMOVE_BY_ID);
+        
+        Node* node = handles.find(id);
+        if (node == nullptr) {
+            return false;
+        }
+        unindex(node);
+        if (node->prev != nullptr) {
+            setNext(node->prev, node->next);
+        } else {
+            setFront(node->next);
+        }
+        if (node->next != nullptr) {
+            node->next->prev = node->prev;
+        } else {
+            rear = node->prev;
+        }
+        retire(node, node, 1, node->next);
+        size--;
+        return true;
+    }
+    
+    // ID pesan paling depan dan paling belakang (0 jika kosong)
+    long long getFirstId() {
+        return front != nullptr ? front->data.id : 0;
+    }
+    
+    long long getLastId() {
+        return rear != nullptr ? rear->data.id : 0;
+    }
+    
+    // Mendapatkan alasan penolakan enqueue terakhir
+    RejectReason getLastReject() {
+        return lastReject;
+    }
+    
+    // Mendapatkan frasa blocklist yang membuat enqueue terakhir ditolak
+    const string& getLastBlockedPhrase() {
+        return lastBlockedPhrase;
+    }
+    
+    // Mendapatkan waktu tunggu (ms) jika enqueue terakhir ditolak rate limiter
+    long long getLastRetryAfterMs() {
+        return lastRetryAfterMs;
+    }
+    
+    // Mengatur rate limit: maksimal maxMessages pesan per seconds detik (0 = nonaktif)
+    void setRateLimit(int maxMessages, int seconds) {
+        rateLimiter.configure(maxMessages, seconds);
+    }
+    
+    // Mengatur window riwayat pesan terkirim (0 = nonaktif)
+    void setHistoryWindow(long long window) {
+        spamFilter.getHistory().configure(window, 0.01);
+    }
+    
+    // Mendapatkan riwayat Bloom filter (untuk statistik)
+    const SpamHistory& getHistory() {
+        return spamFilter.getHistory();
+    }
+    
+    // Memasang blocklist frasa terlarang (nullptr = nonaktif)
+    void setBlocklist(const Blocklist* list) {
+        blocklist = list;
+    }
+    
+    // Mengatur ambang kemiripan spam filter (>= 1.0 = hanya duplikat persis)
+    void setSimilarityThreshold(double threshold) {
+        spamFilter.setThreshold(threshold);
+    }
+    
+    // Cari pesan yang mengandung semua kata di query (terbaru dulu, maksimal limit)
+    void search(const string& query, int limit, vector<Node*>& results) {
+        vector<long long> ids;
+        searchIndex.search(query, limit, ids, [&](long long id) {
+            return handles.find(id) != nullptr;
+        });
+        results.clear();
+        for (size_t i = 0; i < ids.size(); i++) {
+            results.push_back(handles.find(ids[i]));
+        }
+    }
+    
+    // Tunggu memory dari hapus massal selesai dibebaskan thread pembersih
+    void drainReclaimer() {
+        if (reclaimer != nullptr) {
+            reclaimer->drain();
+        }
+    }
+    
+    // Pakai thread pembersih bersama (harus hidup lebih lama dari queue)
+    // sebagai ganti thread sendiri; dipanggil sebelum ada pesan yang dihapus
+    void setReclaimer(Reclaimer* shared) {
+        reclaimer = shared;
+    }
+    
+    // Pembaca di thread lain: ambil slot sekali per thread sebelum scan()
+    // (-1 jika slot habis), lepas dengan detachReader setelah selesai
+    int attachReader() {
+        EpochDomain* domain = epochs.load();
+        if (domain == nullptr) {
+            EpochDomain* created = new EpochDomain();
+            if (epochs.compare_exchange_strong(domain, created)) {
+                domain = created;
+            } else {
+                delete created; // Pembaca lain lebih dulu membuat domain
+            }
+        }
+        return domain->attach();
+    }
+    
+    void detachReader(int reader) {
+        EpochDomain* domain = epochs.load();
+        domain->leave(reader);
+        domain->detach(reader);
+    }
+    
+    // Scan tanpa lock dari thread lain, bersamaan dengan writer yang menghapus
+    // pesan. Yang dibaca hanya ID dan text (tidak berubah selama node hidup);
+    // pesan yang dihapus di tengah scan boleh masih terlihat, dan scan bisa
+    // berhenti lebih awal jika berdiri di pesan yang baru dihapus
+    template <typename Visit>
+    void scan(int reader, Visit visit) {
+        EpochDomain* domain = epochs.load(memory_order_acquire);
+        domain->enter(reader);
+        for (Node* node = __atomic_load_n(&front, __ATOMIC_ACQUIRE); node != nullptr;
+             node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) {
+            visit(node->data.id, node->data.text);
+        }
+        domain->leave(reader);
+    }
+    
+    // Writer: bebaskan rantai yang tertahan setelah scan yang lama selesai
+    void collectRetired() {
+        reclaimRetired();
+    }
+    
+    // Jumlah rantai node yang masih menunggu scan selesai
+    int getRetiredCount() {
+        return limbo.size();
+    }
+    
+    // Mendapatkan pointer ke front (untuk display)
+    Node* getFront() {
+        return front;
+    }
+    
+    // Mendapatkan pointer ke rear (pesan terakhir, untuk preview)
+    Node* getRear() {
+        return rear;
+    }
+};
+
+// Ring MPSC berbatas (gaya Vyukov): banyak producer merebut slot lewat CAS di
+// tail, satu konsumen membaca dari head tanpa operasi atomic read-modify-write.
+// Nomor urut per slot menandai slot sudah terisi / sudah kosong lagi
+template <typename T>
+class MpscRing {
+private:
+    struct Slot {
+        atomic<size_t> sequence;
+        T value;
+    };
+    
+    unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) atomic<size_t> tail; // Ditulis producer
+    alignas(64) size_t head;         // Hanya dibaca/ditulis konsumen
+    
+public:
+    explicit MpscRing(size_t capacity) : head(0) {
+        size_t size = 2;
+        while (size < capacity) size *= 2;
+        slots.reset(new Slot[size]);
+        mask = size - 1;
+        for (size_t i = 0; i < size; i++) {
+            slots[i].sequence.store(i, memory_order_relaxed);
+        }
+        tail.store(0, memory_order_relaxed);
+    }
+    
+    // false jika ring penuh (value tidak dipindah)
+    bool tryPush(T& value) {
+        size_t pos = tail.load(memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            long long diff = (long long)sequence - (long long)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+    
+    // Hanya dipanggil thread konsumen
+    bool tryPop(T& out) {
+        Slot& slot = slots[head & mask];
+        size_t sequence = slot.sequence.load(memory_order_acquire);
+        if (sequence != head + 1) {
+            return false;
+        }
+        out = std::move(slot.value);
+        slot.sequence.store(head + mask + 1, memory_order_release);
+        head++;
+        return true;
+    }
+    
+    bool isEmpty() {
+        return slots[head & mask].sequence.load(memory_order_acquire) != head + 1;
+    }
+};
+
+// Perintah untuk satu chat, diproses oleh thread shard pemilik chat
+enum ChatOp {
+    CHAT_SEND,
+    CHAT_DEQUEUE,   // arg = jumlah pesan
+    CHAT_CANCEL,    // arg = jumlah pesan
+    CHAT_MARK_READ, // arg = ID pesan
+    CHAT_FORWARD    // arg = ID pesan (0 = terakhir), diteruskan ke targetChat
+};
+
+struct ChatCommand {
+    ChatOp op;
+    long long chatId;
+    long long arg;
+    long long targetChat;
+    string text;
+    
+    ChatCommand() : op(CHAT_SEND), chatId(0), arg(0), targetChat(0) {}
+};
+
+// Statistik satu shard; hanya ditulis thread shard-nya
+struct ChatShardStats {
+    long long chats;
+    long long messages;   // Pesan yang sedang ada di semua chat shard
+    long long accepted;
+    long long rejected;
+    long long forwarded;  // Forward yang dikirim ke chat lain
+    long long allocations;
+    
+    ChatShardStats() : chats(0), messages(0), accepted(0), rejected(0), forwarded(0), allocations(0) {}
+};
+
+// Engine banyak chat: setiap chat dimiliki tepat satu shard (dipilih dari hash
+// chat ID) dan hanya thread shard itu yang menyentuh QueuePesan-nya, jadi hot
+// path tanpa lock. Semua perintah, termasuk forward antar shard, dikirim
+// lewat ring MPSC milik shard tujuan
+class ChatEngine {
+private:
+    struct Shard {
+        MpscRing<ChatCommand> inbox;
+        deque<ChatCommand> outbox; // Forward yang belum muat di ring shard tujuan
+        Reclaimer reclaimer; // Thread pembersih bersama semua chat di shard ini
+        unordered_map<long long, QueuePesan*> chats;
+        ChatShardStats stats;
+        thread worker;
+        mutex sleepLock;
+        condition_variable wake;
+        atomic<bool> sleeping;
+        
+        Shard() : inbox(4096), sleeping(false) {}
+        
+        ~Shard() {
+            for (auto it = chats.begin(); it != chats.end(); ++it) {
+                delete it->second;
+            }
+        }
+    };
+    
+    vector<unique_ptr<Shard>> shards;
+    atomic<bool> stopping;
+    // Perintah masuk dan selesai di semua shard (untuk flush)
+    alignas(64) atomic<long long> submitted;
+    alignas(64) atomic<long long> processed;
+    
+    Shard& shardFor(long long chatId) {
+        return *shards[shardOf(chatId)];
+    }
+    
+    static void wakeShard(Shard& shard) {
+        atomic_thread_fence(memory_order_seq_cst); // Pasangan fence di waitForWork
+        if (shard.sleeping.load(memory_order_relaxed)) {
+            lock_guard<mutex> guard(shard.sleepLock);
+            shard.wake.notify_one();
+        }
+    }
+    
+    // Kirim dari luar worker: tunggu (yield) selama ring tujuan penuh
+    void submit(ChatCommand& command) {
+        Shard& shard = shardFor(command.chatId);
+        submitted.fetch_add(1);
+        while (!shard.inbox.tryPush(command)) {
+            wakeShard(shard);
+            this_thread::yield();
+        }
+        wakeShard(shard);
+    }
+    
+    QueuePesan& chatFor(Shard& shard, long long chatId) {
+        QueuePesan*& queue = shard.chats[chatId];
+        if (queue == nullptr) {
+            queue = new QueuePesan();
+            queue->setUndoLimit(0, 0); // Journal undo hanya untuk TUI
+            queue->setReclaimer(&shard.reclaimer);
+            shard.stats.chats++;
+        }
+        return *queue;
+    }
+    
+    void execute(Shard& shard, ChatCommand& command) {
+        QueuePesan& queue = chatFor(shard, command.chatId);
+        int before = queue.getSize();
+        switch (command.op) {
+            case CHAT_SEND:
+                if (queue.enqueue(std::move(command.text))) {
+                    shard.stats.accepted++;
+                } else {
+                    shard.stats.rejected++;
+                }
+                break;
+            case CHAT_DEQUEUE:
+                queue.dequeue((int)command.arg);
+                break;
+            case CHAT_CANCEL:
+                queue.cancelLast((int)command.arg);
+                break;
+            case CHAT_MARK_READ:
+                queue.markAsReadById(command.arg);
+                break;
+            case CHAT_FORWARD: {
+                long long id = command.arg != 0 ? command.arg : queue.getLastId();
+                Node* node = queue.findById(id);
+                if (node != nullptr) {
+                    // Shard lain tidak boleh menyentuh queue ini: kirim salinan text
+                    ChatCommand send;
+                    send.op = CHAT_SEND;
+                    send.chatId = command.targetChat;
+                    send.text = node->data.text;
+                    submitted.fetch_add(1);
+                    shard.outbox.push_back(std::move(send));
+                    shard.stats.forwarded++;
+                }
+                break;
+            }
+        }
+        shard.stats.messages += queue.getSize() - before;
+    }
+    
+    // Kirim forward yang tertunda tanpa memblokir (dua shard yang saling
+    // forward dengan ring penuh tidak boleh saling menunggu)
+    void flushOutbox(Shard& shard) {
+        while (!shard.outbox.empty()) {
+            Shard& target = shardFor(shard.outbox.front().chatId);
+            if (!target.inbox.tryPush(shard.outbox.front())) {
+                return;
+            }
+            shard.outbox.pop_front();
+            wakeShard(target);
+        }
+    }
+    
+    // Tidur sampai ada perintah baru; flag sleeping + fence mencegah wakeup hilang
+    void waitForWork(Shard& shard) {
+        unique_lock<mutex> guard(shard.sleepLock);
+        shard.sleeping.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        while (shard.inbox.isEmpty() && !stopping.load()) {
+            shard.wake.wait_for(guard, chrono::milliseconds(100));
+        }
+        shard.sleeping.store(false, memory_order_relaxed);
+    }
+    
+    void run(Shard* shard) {
+        long long allocStart = allocationCount;
+        ChatCommand command;
+        int idleSpins = 0;
+        while (true) {
+            flushOutbox(*shard);
+            if (shard->inbox.tryPop(command)) {
+                execute(*shard, command);
+                shard->stats.allocations = allocationCount - allocStart;
+                processed.fetch_add(1); // Setelah forward (jika ada) tercatat di submitted
+                idleSpins = 0;
+                continue;
+            }
+            if (stopping.load() && shard->outbox.empty()) {
+                return;
+            }
+            if (!shard->outbox.empty() || ++idleSpins < 64) {
+                this_thread::yield();
+            } else {
+                waitForWork(*shard);
+                idleSpins = 0;
+            }
+        }
+    }
+    
+public:
+    explicit ChatEngine(int shardCount) : stopping(false), submitted(0), processed(0) {
+        if (shardCount < 1) shardCount = 1;
+        for (int i = 0; i < shardCount; i++) {
+            shards.push_back(unique_ptr<Shard>(new Shard()));
+        }
+        for (int i = 0; i < shardCount; i++) {
+            shards[i]->worker = thread(&ChatEngine::run, this, shards[i].get());
+        }
+    }
+    
+    ~ChatEngine() {
+        flush();
+        stopping.store(true);
+        for (size_t i = 0; i < shards.size(); i++) {
+            {
+                lock_guard<mutex> guard(shards[i]->sleepLock);
+                shards[i]->wake.notify_one();
+            }
+            shards[i]->worker.join();
+        }
+    }
+    
+    int getShardCount() const {
+        return shards.size();
+    }
+    
+    // Shard pemilik chat (hash agar chat ID berurutan tersebar rata)
+    int shardOf(long long chatId) const {
+        unsigned long long h = (unsigned long long)chatId * 0x9E3779B97F4A7C15ULL;
+        return (int)((h >> 32) % shards.size());
+    }
+    
+    void send(long long chatId, string text) {
+        ChatCommand command;
+        command.op = CHAT_SEND;
+        command.chatId = chatId;
+        command.text = std::move(text);
+        submit(command);
+    }
+    
+    void dequeue(long long chatId, int count) {
+        ChatCommand command;
+        command.op = CHAT_DEQUEUE;
+        command.chatId = chatId;
+        command.arg = count;
+        submit(command);
+    }
+    
+    void cancelLast(long long chatId, int count) {
+        ChatCommand command;
+        command.op = CHAT_CANCEL;
+        command.chatId = chatId;
+        command.arg = count;
+        submit(command);
+    }
+    
+    void markAsRead(long long chatId, long long messageId) {
+        ChatCommand command;
+        command.op = CHAT_MARK_READ;
+        command.chatId = chatId;
+        command.arg = messageId;
+        submit(command);
+    }
+    
+    // Teruskan pesan (0 = pesan terakhir) dari satu chat ke chat lain
+    void forward(long long fromChat, long long messageId, long long toChat) {
+        ChatCommand command;
+        command.op = CHAT_FORWARD;
+        command.chatId = fromChat;
+        command.arg = messageId;
+        command.targetChat = toChat;
+        submit(command);
+    }
+    
+    // Tunggu sampai semua perintah (termasuk forward turunannya) selesai.
+    // processed dibaca lebih dulu: forward dicatat di submitted sebelum
+    // perintah asalnya dihitung processed, jadi sama berarti benar-benar selesai
+    void flush() {
+        while (true) {
+            long long done = processed.load();
+            if (done == submitted.load()) {
+                return;
+            }
+            for (size_t i = 0; i < shards.size(); i++) {
+                wakeShard(*shards[i]);
+            }
+            this_thread::yield();
+        }
+    }
+    
+    // Statistik per shard; panggil setelah flush()
+    vector<ChatShardStats> collectStats() {
+        vector<ChatShardStats> result;
+        for (size_t i = 0; i < shards.size(); i++) {
+            result.push_back(shards[i]->stats);
+        }
+        return result;
+    }
+};
+
+// Status baca per anggota di chat grup. Setiap anggota punya watermark
+// ("sudah baca sampai ID X"), jadi menandai semua pesan sampai X cukup satu
+// update watermark. Pesan yang dibaca satu per satu di atas watermark dicatat
+// di bitmap anggota milik node-nya (dialokasikan saat pertama dipakai).
+// Jumlah anggota per nilai watermark disimpan di Fenwick tree, sehingga
+// "dibaca k dari N" = anggota dengan watermark >= ID + popcount bitmap
+class GroupReceipts {
+private:
+    int memberCount;
+    unsigned long long version;   // Naik setiap ada watermark yang maju
+    vector<long long> watermarks; // Per anggota, 0 = belum membaca apa pun
+    vector<int> tree;             // Fenwick: index = watermark + 1
+    
+    void treeAdd(long long mark, int delta) {
+        for (size_t i = mark + 1; i < tree.size(); i += i & (~i + 1)) {
+            tree[i] += delta;
+        }
+    }
+    
+    // Jumlah anggota dengan watermark < id
+    int countBelow(long long id) {
+        if (id <= 0) return 0;
+        int total = 0;
+        for (size_t i = min((size_t)id, tree.size() - 1); i > 0; i -= i & (~i + 1)) {
+            total += tree[i];
+        }
+        return total;
+    }
+    
+    // Perbesar tree (kapasitas x2) lalu bangun ulang dari watermark anggota
+    void grow(long long mark) {
+        size_t capacity = tree.size();
+        while ((long long)capacity <= mark + 1) capacity *= 2;
+        tree.assign(capacity, 0);
+        for (int m = 0; m < memberCount; m++) {
+            treeAdd(watermarks[m], 1);
+        }
+    }
+    
+public:
+    explicit GroupReceipts(int members) : memberCount(members < 1 ? 1 : members), version(1) {
+        watermarks.assign(memberCount, 0);
+        tree.assign(1024, 0);
+        treeAdd(0, memberCount);
+    }
+    
+    int getMemberCount() {
+        return memberCount;
+    }
+    
+    long long getWatermark(int member) {
+        return watermarks[member];
+    }
+    
+    // Anggota sudah membaca semua pesan sampai ID tertentu - O(log ID)
+    void markReadUpTo(int member, long long id) {
+        if (id <= watermarks[member]) {
+            return; // Watermark hanya maju
+        }
+        if (id + 1 >= (long long)tree.size()) {
+            grow(id);
+        }
+        treeAdd(watermarks[member], -1);
+        treeAdd(id, 1);
+        watermarks[member] = id;
+        version++;
+    }
+    
+    // Anggota membaca satu pesan (di luar urutan) - set 1 bit
+    void markRead(int member, const Node* node) {
+        if (watermarks[member] >= node->data.id) {
+            return;
+        }
+        size_t words = (memberCount + 63) / 64;
+        if (node->memberReads.size() < words) {
+            node->memberReads.resize(words, 0);
+        }
+        node->memberReads[member / 64] |= 1ULL << (member % 64);
+    }
+    
+    bool isReadBy(int member, const Node* node) {
+        if (watermarks[member] >= node->data.id) {
+            return true;
+        }
+        return !node->memberReads.empty() &&
+               (node->memberReads[member / 64] >> (member % 64) & 1) != 0;
+    }
+    
+    // Jumlah anggota yang sudah membaca pesan. Bit anggota yang watermark-nya
+    // sudah melewati pesan ini dibuang di sini, sekali per perubahan
+    // watermark; selama watermark tidak berubah query cukup popcount
+    int countReaders(const Node* node) {
+        long long id = node->data.id;
+        int readers = memberCount - countBelow(id);
+        if (readers == 0 || node->memberReadsVersion == version) {
+            // Tidak ada bit yang tumpang tindih dengan watermark
+            for (size_t w = 0; w < node->memberReads.size(); w++) {
+                readers += __builtin_popcountll(node->memberReads[w]);
+            }
+            return readers;
+        }
+        node->memberReadsVersion = version;
+        bool anyBit = false;
+        for (size_t w = 0; w < node->memberReads.size(); w++) {
+            unsigned long long bits = node->memberReads[w];
+            for (unsigned long long rest = bits; rest != 0; rest &= rest - 1) {
+                int member = w * 64 + __builtin_ctzll(rest);
+                if (watermarks[member] >= id) {
+                    bits &= ~(1ULL << (member % 64));
+                }
+            }
+            node->memberReads[w] = bits;
+            readers += __builtin_popcountll(bits);
+            anyBit = anyBit || bits != 0;
+        }
+        if (!anyBit && !node->memberReads.empty()) {
+            vector<unsigned long long>().swap(node->memberReads);
+        }
+        return readers;
+    }
+};
+
+// Timer wheel hierarkis: 4 level x 64 slot, 1 tick = TICK_MS. Level 0 berisi
+// timer yang jatuh tempo < 64 tick lagi, setiap level berikutnya 64x lebih
+// kasar (level 3 sampai ~46 jam, lebih jauh ditaruh di level 3 lalu diatur
+// ulang). Schedule dan cancel O(1) lewat list ganda per slot; saat level 0
+// berputar penuh, satu slot level atas di-cascade ke level yang lebih halus.
+// Bitmask slot terisi dipakai untuk melompati tick kosong dan menghitung
+// deadline berikutnya untuk timeout poll
+template <typename T>
+class TimerWheel {
+public:
+    static const int TICK_MS = 10;
+    
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    
+    struct Entry {
+        long long dueMs;
+        long long dueTick;
+        int prev;   // -1 = awal list slot
+        int next;   // -1 = akhir list slot (atau akhir free list)
+        int slot;   // level * SLOTS + index, -1 = entry bebas
+        unsigned int generation;
+        T value;
+    };
+    
+    vector<Entry> entries;
+    int freeHead;
+    int heads[LEVELS * SLOTS];
+    unsigned long long occupied[LEVELS]; // Bit i = slot i di level itu tidak kosong
+    long long currentTick;               // Tick berikutnya yang belum diproses
+    int count;
+    vector<int> cascaded;                // Buffer kerja cascade
+    
+    // Masukkan entry ke slot sesuai jarak jatuh temponya dari currentTick
+    void link(int index) {
+        Entry& entry = entries[index];
+        long long tick = max(entry.dueTick, currentTick);
+        long long delta = tick - currentTick;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (1LL << (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        int position = (int)((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        int slot = level * SLOTS + position;
+        entry.slot = slot;
+        entry.prev = -1;
+        entry.next = heads[slot];
+        if (heads[slot] >= 0) {
+            entries[heads[slot]].prev = index;
+        }
+        heads[slot] = index;
+        occupied[level] |= 1ULL << position;
+    }
+    
+    void unlink(int index) {
+        Entry& entry = entries[index];
+        if (entry.prev >= 0) {
+            entries[entry.prev].next = entry.next;
+        } else {
+            heads[entry.slot] = entry.next;
+        }
+        if (entry.next >= 0) {
+            entries[entry.next].prev = entry.prev;
+        }
+        if (heads[entry.slot] < 0) {
+            occupied[entry.slot / SLOTS] &= ~(1ULL << (entry.slot % SLOTS));
+        }
+    }
+    
+    void release(int index) {
+        Entry& entry = entries[index];
+        entry.slot = -1;
+        entry.generation++;
+        entry.value = T();
+        entry.next = freeHead;
+        freeHead = index;
+        count--;
+    }
+    
+    // Level 0 baru berputar penuh: slot level atas yang periodenya dimulai
+    // sekarang dipindah ke level yang lebih halus
+    void cascade() {
+        for (int level = 1; level < LEVELS; level++) {
+            int position = (int)((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+            int slot = level * SLOTS + position;
+            cascaded.clear();
+            for (int index = heads[slot]; index >= 0; index = entries[index].next) {
+                cascaded.push_back(index);
+            }
+            heads[slot] = -1;
+            occupied[level] &= ~(1ULL << position);
+            for (size_t i = 0; i < cascaded.size(); i++) {
+                link(cascaded[i]);
+            }
+            if (position != 0) {
+                break; // Level ini belum berputar penuh: level atasnya belum perlu
+            }
+        }
+    }
+    
+public:
+    explicit TimerWheel(long long startMs) : freeHead(-1), currentTick(startMs / TICK_MS), count(0) {
+        for (int i = 0; i < LEVELS * SLOTS; i++) heads[i] = -1;
+        for (int i = 0; i < LEVELS; i++) occupied[i] = 0;
+    }
+    
+    // Jadwalkan value pada dueMs (tidak pernah lebih awal, paling telat 1
+    // tick). Return handle untuk cancel
+    long long schedule(long long dueMs, T value) {
+        int index;
+        if (freeHead >= 0) {
+            index = freeHead;
+            freeHead = entries[index].next;
+        } else {
+            index = entries.size();
+            entries.push_back(Entry());
+            entries[index].generation = 1;
+        }
+        Entry& entry = entries[index];
+        entry.dueMs = dueMs;
+        entry.dueTick = (dueMs + TICK_MS - 1) / TICK_MS;
+        entry.value = std::move(value);
+        link(index);
+        count++;
+        return ((long long)entry.generation << 32) | index;
+    }
+    
+    // Batalkan timer - O(1). false jika sudah jatuh tempo / dibatalkan
+    bool cancel(long long handle) {
+        int index = (int)(handle & 0xFFFFFFFFLL);
+        if (!isPending(handle)) {
+            return false;
+        }
+        unlink(index);
+        release(index);
+        return true;
+    }
+    
+    bool isPending(long long handle) const {
+        long long index = handle & 0xFFFFFFFFLL;
+        return index < (long long)entries.size() && entries[index].slot >= 0 &&
+               entries[index].generation == (unsigned int)(handle >> 32);
+    }
+    
+    // Proses semua tick sampai nowMs; value yang jatuh tempo dipindah ke out
+    // (per slot sekaligus). Tick kosong dilompati lewat bitmask level 0
+    void advance(long long nowMs, vector<T>& out) {
+        long long target = nowMs / TICK_MS;
+        while (currentTick <= target) {
+            int position = (int)(currentTick & (SLOTS - 1));
+            if (occupied[0] & (1ULL << position)) {
+                int index = heads[position];
+                heads[position] = -1;
+                occupied[0] &= ~(1ULL << position);
+                while (index >= 0) {
+                    int next = entries[index].next;
+                    out.push_back(std::move(entries[index].value));
+                    release(index);
+                    index = next;
+                }
+            }
+            // Lompat ke slot level 0 terisi berikutnya atau ke batas cascade
+            long long boundary = (currentTick | (SLOTS - 1)) + 1;
+            long long next = boundary;
+            if (position + 1 < SLOTS) {
+                unsigned long long rest = occupied[0] >> (position + 1);
+                if (rest != 0) {
+                    next = currentTick + 1 + __builtin_ctzll(rest);
+                }
+            }
+            currentTick = min(next, target + 1);
+            if ((currentTick & (SLOTS - 1)) == 0) {
+                cascade(); // Langsung saat tiba di batas, agar level atas selalu periode mendatang
+            }
+        }
+    }
+    
+    // Waktu (ms) advance berikutnya perlu dipanggil, -1 jika kosong. Untuk
+    // timer di level atas ini adalah batas cascade berikutnya
+    long long nextDueMs() const {
+        if (count == 0) {
+            return -1;
+        }
+        int position = (int)(currentTick & (SLOTS - 1));
+        unsigned long long rest = occupied[0] >> position;
+        if (rest != 0) {
+            return (currentTick + __builtin_ctzll(rest)) * TICK_MS;
+        }
+        return ((currentTick | (SLOTS - 1)) + 1) * TICK_MS;
+    }
+    
+    // `limit` timer paling awal (urut jatuh tempo) sebagai handle. Slot
+    // dikunjungi urut batas bawah waktunya dan berhenti begitu batas itu
+    // melewati kandidat ke-limit, jadi slot jauh yang penuh tidak disentuh
+    void upcoming(int limit, vector<long long>& out) const {
+        out.clear();
+        if (limit <= 0 || count == 0) {
+            return;
+        }
+        vector<pair<long long, int> > bounds; // (tick paling awal, slot)
+        for (int level = 0; level < LEVELS; level++) {
+            long long base = currentTick >> (SLOT_BITS * level);
+            int current = (int)(base & (SLOTS - 1));
+            for (unsigned long long bits = occupied[level]; bits != 0; bits &= bits - 1) {
+                int position = __builtin_ctzll(bits);
+                long long steps = (position - current) & (SLOTS - 1);
+                if (level > 0 && steps == 0) steps = SLOTS; // Periode yang sama 64 putaran lagi
+                long long start = level == 0 ? currentTick + steps : (base + steps) << (SLOT_BITS * level);
+                bounds.push_back(make_pair(start, level * SLOTS + position));
+            }
+        }
+        sort(bounds.begin(), bounds.end());
+        priority_queue<pair<long long, int> > best; // Max-heap (dueMs, index)
+        for (size_t b = 0; b < bounds.size(); b++) {
+            if ((int)best.size() == limit && bounds[b].first * TICK_MS > best.top().first) {
+                break;
+            }
+            for (int index = heads[bounds[b].second]; index >= 0; index = entries[index].next) {
+                if ((int)best.size() < limit) {
+                    best.push(make_pair(entries[index].dueMs, index));
+                } else if (entries[index].dueMs < best.top().first) {
+                    best.pop();
+                    best.push(make_pair(entries[index].dueMs, index));
+                }
+            }
+        }
+        while (!best.empty()) {
+            int index = best.top().second;
+            out.push_back(((long long)entries[index].generation << 32) | index);
+            best.pop();
+        }
+        reverse(out.begin(), out.end());
+    }
+    
+    // Value dan jatuh tempo timer yang masih pending (handle dari upcoming)
+    const T& valueOf(long long handle) const {
+        return entries[handle & 0xFFFFFFFFLL].value;
+    }
+    
+    long long dueOf(long long handle) const {
+        return entries[handle & 0xFFFFFFFFLL].dueMs;
+    }
+    
+    int getCount() const {
+        return count;
+    }
+};
+
+// Satu percakapan di daftar chat, sekaligus node list intrusif yang
+// diurutkan dari aktivitas terbaru
+struct Conversation {
+    long long id;
+    string name;
+    QueuePesan queue;
+    unique_ptr<GroupReceipts> group; // nullptr = chat pribadi
+    long long lastActivityMs;
+    Conversation* newer; // Ke arah atas daftar
+    Conversation* older; // Ke arah bawah daftar
+    long long expiryWakeMs;  // Jadwal expire chat ini di wheel ChatList, -1 = tidak ada
+    long long expiryHandle;
+    
+    Conversation(long long i, const string& n)
+        : id(i), name(n), lastActivityMs(currentTimeMs()), newer(nullptr), older(nullptr),
+          expiryWakeMs(-1), expiryHandle(0) {}
+};
+
+// Daftar chat terurut aktivitas terakhir (seperti urutan LRU): setiap enqueue
+// memindahkan chat-nya ke paling atas dalam O(1), tanpa sorting ulang.
+// Chat yang punya pesan dengan TTL dijadwalkan di timer wheel pada deadline
+// terdekatnya; saat bangun, semua pesan yang kedaluwarsa sampai
+// EXPIRY_BATCH_MS berikutnya ikut dihapus dalam satu batch (paling cepat
+// 250 ms sebelum waktunya). Chat tanpa TTL tidak pernah diperiksa
+class ChatList {
+public:
+    static const int EXPIRY_BATCH_MS = 250;
+
+private:
+    Conversation* newest;
+    Conversation* oldest;
+    vector<unique_ptr<Conversation>> owned;
+    unordered_map<string, Conversation*> byName;
+    function<void(QueuePesan&)> setupQueue; // Pengaturan awal queue chat baru
+    function<void(Conversation*)> onMessage; // Dipanggil setiap pesan baru masuk
+    TimerWheel<Conversation*> expiryWheel;
+    vector<Conversation*> expiryDue; // Buffer kerja expireDue
+    long long expiredTotal;
+    
+    // Jadwalkan expire chat paling lambat pada dueMs
+    void wakeForExpiry(Conversation* chat, long long wakeMs) {
+        if (chat->expiryWakeMs >= 0) {
+            if (chat->expiryWakeMs <= wakeMs) {
+                return;
+            }
+            expiryWheel.cancel(chat->expiryHandle);
+        }
+        chat->expiryWakeMs = wakeMs;
+        chat->expiryHandle = expiryWheel.schedule(wakeMs, chat);
+    }
+
+    void unlink(Conversation* chat) {
+        if (chat->newer != nullptr) {
+            chat->newer->older = chat->older;
+        } else {
+            newest = chat->older;
+        }
+        if (chat->older != nullptr) {
+            chat->older->newer = chat->newer;
+        } else {
+            oldest = chat->newer;
+        }
+        chat->newer = chat->older = nullptr;
+    }
+    
+    void pushNewest(Conversation* chat) {
+        chat->older = newest;
+        if (newest != nullptr) {
+            newest->newer = chat;
+        } else {
+            oldest = chat;
+        }
+        newest = chat;
+    }
+    
+public:
+    ChatList() : newest(nullptr), oldest(nullptr), expiryWheel(currentTimeMs()), expiredTotal(0) {}
+    
+    explicit ChatList(function<void(QueuePesan&)> setup)
+        : newest(nullptr), oldest(nullptr), setupQueue(setup), expiryWheel(currentTimeMs()), expiredTotal(0) {}
+    
+    // Cari chat berdasarkan nama (nullptr jika belum ada)
+    Conversation* find(const string& name) {
+        unordered_map<string, Conversation*>::iterator it = byName.find(name);
+        return it != byName.end() ? it->second : nullptr;
+    }
+    
+    // Buka chat berdasarkan nama; chat baru dibuat di paling atas daftar
+    Conversation* open(const string& name) {
+        Conversation* chat = find(name);
+        if (chat != nullptr) {
+            return chat;
+        }
+        chat = new Conversation(owned.size() + 1, name);
+        owned.push_back(unique_ptr<Conversation>(chat));
+        byName[name] = chat;
+        if (setupQueue) {
+            setupQueue(chat->queue);
+        }
+        chat->queue.setEnqueueListener([this, chat]() {
+            touch(chat);
+            if (onMessage) {
+                onMessage(chat);
+            }
+        });
+        chat->queue.setExpiryListener([this, chat](long long dueMs) {
+            wakeForExpiry(chat, dueMs);
+        });
+        pushNewest(chat);
+        return chat;
+    }
+    
+    // Buka chat grup dengan memberCount anggota (chat pribadi yang sudah ada
+    // dengan nama sama dijadikan grup)
+    Conversation* openGroup(const string& name, int memberCount) {
+        Conversation* chat = open(name);
+        if (chat->group == nullptr) {
+            chat->group.reset(new GroupReceipts(memberCount));
+        }
+        return chat;
+    }
+    
+    // Pindahkan chat ke paling atas daftar - O(1)
+    void touch(Conversation* chat) {
+        chat->lastActivityMs = currentTimeMs();
+        if (chat == newest) {
+            return;
+        }
+        unlink(chat);
+        pushNewest(chat);
+    }
+    
+    // Callback untuk setiap pesan baru di chat mana pun
+    void setMessageListener(function<void(Conversation*)> listener) {
+        onMessage = listener;
+    }
+    
+    Conversation* getNewest() {
+        return newest;
+    }
+    
+    int getCount() {
+        return owned.size();
+    }
+    
+    // Hapus pesan kedaluwarsa di chat yang jadwal expire-nya sudah tiba;
+    // return jumlah pesan yang dihapus
+    int expireDue(long long nowMs) {
+        expiryWheel.advance(nowMs, expiryDue);
+        int removed = 0;
+        for (size_t i = 0; i < expiryDue.size(); i++) {
+            Conversation* chat = expiryDue[i];
+            chat->expiryWakeMs = -1;
+            removed += chat->queue.expire(nowMs + EXPIRY_BATCH_MS);
+            long long next = chat->queue.nextExpiryMs();
+            if (next >= 0) {
+                wakeForExpiry(chat, next);
+            }
+        }
+        expiryDue.clear();
+        expiredTotal += removed;
+        return removed;
+    }
+    
+    // Waktu expireDue berikutnya perlu dipanggil (-1 jika tidak ada)
+    long long nextExpiryMs() const {
+        return expiryWheel.nextDueMs();
+    }
+    
+    long long getExpiredTotal() const {
+        return expiredTotal;
+    }
+};
+
+// Satu pesan yang sedang dikirim: queue asal dan ID pesannya
+struct DeliveryItem {
+    QueuePesan* queue;
+    long long id;
+    
+    DeliveryItem() : queue(nullptr), id(0) {}
+    DeliveryItem(QueuePesan* q, long long i) : queue(q), id(i) {}
+};
+
+// Pipeline status pesan: terkirim (✓) → diterima (✓✓) → dibaca (✓✓ biru).
+// Thread UI memasukkan pesan baru ke ring outbox, worker mensimulasikan
+// jaringan (delay + jitter) lalu mengembalikan ack lewat ring kedua dan
+// membangunkan UI lewat eventfd sekali per batch. Worker tidak pernah
+// menyentuh QueuePesan; ack diterapkan di thread UI dalam satu batch.
+// Backpressure: pesan di dalam pipeline dibatasi HIGH_WATERMARK; selebihnya
+// antre di backlog UI dan baru masuk lagi setelah turun ke LOW_WATERMARK
+class DeliveryPipeline {
+private:
+    static const int RING_SIZE = 8192;
+    static const int HIGH_WATERMARK = RING_SIZE;
+    static const int LOW_WATERMARK = RING_SIZE / 2;
+    
+    struct Scheduled {
+        long long dueMs;
+        DeliveryItem item;
+        
+        bool operator>(const Scheduled& other) const {
+            return dueMs > other.dueMs;
+        }
+    };
+    
+    MpscRing<DeliveryItem> outbox; // UI → worker
+    MpscRing<DeliveryItem> acks;   // Worker → UI
+    int wakeWorkerFd;
+    int ackFd;
+    atomic<bool> workerSleeping;
+    atomic<bool> stopping;
+    int delayMs;
+    thread worker;
+    
+    // Hanya disentuh thread UI
+    deque<DeliveryItem> backlog;
+    int inFlight;
+    bool throttled;
+    long long submitted;
+    long long delivered;
+    vector<long long> batchIds;
+    
+    void push(DeliveryItem& item) {
+        outbox.tryPush(item); // Tidak pernah penuh: inFlight <= ukuran ring
+        inFlight++;
+        submitted++;
+        atomic_thread_fence(memory_order_seq_cst); // Pasangan fence di run()
+        if (workerSleeping.load(memory_order_relaxed)) {
+            unsigned long long one = 1;
+            ssize_t n = write(wakeWorkerFd, &one, sizeof(one));
+            (void)n;
+        }
+    }
+    
+    void run() {
+        priority_queue<Scheduled, vector<Scheduled>, greater<Scheduled> > inTransit;
+        deque<DeliveryItem> ready; // Ack yang belum muat di ring
+        unsigned long long rng = 0x9E3779B97F4A7C15ULL;
+        DeliveryItem item;
+        
+        while (!stopping.load()) {
+            long long now = currentTimeMs();
+            while (outbox.tryPop(item)) {
+                rng ^= rng << 13;
+                rng ^= rng >> 7;
+                rng ^= rng << 17;
+                Scheduled next;
+                // Delay jaringan: 50%..150% dari delayMs
+                next.dueMs = now + (delayMs > 0 ? delayMs / 2 + (long long)(rng % (delayMs + 1)) : 0);
+                next.item = item;
+                inTransit.push(next);
+            }
+            while (!inTransit.empty() && inTransit.top().dueMs <= now) {
+                ready.push_back(inTransit.top().item);
+                inTransit.pop();
+            }
+            bool produced = false;
+            while (!ready.empty() && acks.tryPush(ready.front())) {
+                ready.pop_front();
+                produced = true;
+            }
+            if (produced) {
+                unsigned long long one = 1;
+                ssize_t n = write(ackFd, &one, sizeof(one));
+                (void)n;
+            }
+            
+            int timeoutMs = -1;
+            if (!ready.empty()) {
+                timeoutMs = 1; // Ring ack penuh: tunggu UI mengambil
+            } else if (!inTransit.empty()) {
+                timeoutMs = (int)max(0LL, inTransit.top().dueMs - currentTimeMs());
+            }
+            workerSleeping.store(true, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (outbox.isEmpty() && timeoutMs != 0) {
+                struct pollfd pfd;
+                pfd.fd = wakeWorkerFd;
+                pfd.events = POLLIN;
+                if (::poll(&pfd, 1, timeoutMs) > 0) {
+                    unsigned long long value;
+                    ssize_t n = read(wakeWorkerFd, &value, sizeof(value));
+                    (void)n;
+                }
+            }
+            workerSleeping.store(false, memory_order_relaxed);
+        }
+    }
+    
+public:
+    explicit DeliveryPipeline(int networkDelayMs)
+        : outbox(RING_SIZE), acks(RING_SIZE), workerSleeping(false), stopping(false),
+          delayMs(networkDelayMs < 0 ? 0 : networkDelayMs), inFlight(0), throttled(false),
+          submitted(0), delivered(0) {
+        wakeWorkerFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ackFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        worker = thread(&DeliveryPipeline::run, this);
+    }
+    
+    ~DeliveryPipeline() {
+        stopping.store(true);
+        unsigned long long one = 1;
+        ssize_t n = write(wakeWorkerFd, &one, sizeof(one));
+        (void)n;
+        worker.join();
+        close(wakeWorkerFd);
+        close(ackFd);
+    }
+    
+    // Kirim pesan baru (thread UI)
+    void submit(QueuePesan* queue, long long id) {
+        DeliveryItem item(queue, id);
+        if (throttled || !backlog.empty() || inFlight >= HIGH_WATERMARK) {
+            throttled = true;
+            backlog.push_back(item);
+            return;
+        }
+        push(item);
+    }
+    
+    // File descriptor yang siap dibaca saat ada ack (untuk poll di thread UI)
+    int getFd() {
+        return ackFd;
+    }
+    
+    // Ambil semua ack lalu terapkan per queue dalam batch (thread UI).
+    // Return jumlah pesan yang statusnya berubah
+    int collect() {
+        unsigned long long value;
+        ssize_t n = read(ackFd, &value, sizeof(value));
+        (void)n;
+        
+        int changed = 0;
+        QueuePesan* batchQueue = nullptr;
+        DeliveryItem item;
+        while (acks.tryPop(item)) {
+            inFlight--;
+            if (item.queue != batchQueue && !batchIds.empty()) {
+                changed += batchQueue->markDelivered(batchIds.data(), batchIds.size());
+                batchIds.clear();
+            }
+            batchQueue = item.queue;
+            batchIds.push_back(item.id);
+        }
+        if (!batchIds.empty()) {
+            changed += batchQueue->markDelivered(batchIds.data(), batchIds.size());
+            batchIds.clear();
+        }
+        delivered += changed;
+        
+        // Backlog baru dialirkan lagi setelah pipeline cukup kosong (hysteresis)
+        if (throttled && inFlight <= LOW_WATERMARK) {
+            while (!backlog.empty() && inFlight < HIGH_WATERMARK) {
+                push(backlog.front());
+                backlog.pop_front();
+            }
+            throttled = !backlog.empty();
+        }
+        return changed;
+    }
+    
+    int getInFlight() {
+        return inFlight;
+    }
+    
+    int getBacklog() {
+        return backlog.size();
+    }
+    
+    long long getSubmitted() {
+        return submitted;
+    }
+    
+    long long getDelivered() {
+        return delivered;
+    }
+};
+
+// Fungsi untuk membuat text unik yang tidak mirip satu sama lain (batch/benchmark)
+string benchText(const char* prefix, long long i) {
+    unsigned long long z = (unsigned long long)i * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s %016llx", prefix, z);
+    return buf;
+}
+
+// Sumber pesan background (--ingest): thread producer men-tail file (baris
+// baru = pesan baru, seperti tail -f) atau membangkitkan pesan sintetis dengan
+// rate tetap, lalu mengirim text lewat ring MPSC ke thread UI. Producer tidak
+// pernah menunggu UI menggambar: eventfd hanya ditulis sekali sampai UI
+// mengambil isi ring, dan saat ring penuh producer menahan pesannya sendiri
+class Ingestor {
+private:
+    static const int RING_SIZE = 4096;
+    static const int IDLE_SLEEP_MS = 20; // Jeda saat file belum bertambah
+    
+    MpscRing<string> ring;
+    int readyFd;
+    atomic<bool> notified; // true = UI sudah dibangunkan, ring belum diambil
+    atomic<bool> stopping;
+    atomic<long long> produced;
+    atomic<long long> stalls; // Berapa kali ring penuh
+    string path;              // File yang di-tail (kosong = generator)
+    int rate;                 // Pesan per detik untuk generator
+    int fileFd;
+    thread producer;
+    
+    // Hanya disentuh thread UI
+    QueuePesan* target;
+    long long accepted;
+    long long rejected;
+    
+    void notify() {
+        if (!notified.exchange(true)) {
+            unsigned long long one = 1;
+            ssize_t n = write(readyFd, &one, sizeof(one));
+            (void)n;
+        }
+    }
+    
+    // Masukkan satu pesan ke ring; saat penuh, bangunkan UI lalu coba lagi
+    void publish(string& text) {
+        while (!ring.tryPush(text)) {
+            if (stopping.load(memory_order_relaxed)) return;
+            stalls.fetch_add(1, memory_order_relaxed);
+            notify();
+            usleep(1000);
+        }
+        produced.fetch_add(1, memory_order_relaxed);
+    }
+    
+    void tailFile() {
+        char buffer[4096];
+        string partial; // Baris yang belum diakhiri '\n'
+        off_t offset = lseek(fileFd, 0, SEEK_END);
+        while (!stopping.load(memory_order_relaxed)) {
+            ssize_t n = read(fileFd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                // File dipotong (truncate/rotasi di tempat): mulai lagi dari awal
+                struct stat st;
+                if (fstat(fileFd, &st) == 0 && st.st_size < offset) {
+                    offset = lseek(fileFd, 0, SEEK_SET);
+                    partial.clear();
+                    continue;
+                }
+                usleep(IDLE_SLEEP_MS * 1000);
+                continue;
+            }
+            offset += n;
+            bool any = false;
+            for (ssize_t i = 0; i < n; i++) {
+                if (buffer[i] != '\n') {
+                    partial += buffer[i];
+                    continue;
+                }
+                if (!partial.empty() && partial[partial.length() - 1] == '\r') {
+                    partial.erase(partial.length() - 1);
+                }
+                if (!partial.empty()) {
+                    publish(partial);
+                    any = true;
+                }
+                partial.clear();
+            }
+            if (any) {
+                notify(); // Satu wakeup per blok yang dibaca
+            }
+        }
+    }
+    
+    void generate() {
+        long long startMs = currentTimeMs();
+        long long sequence = 0;
+        while (!stopping.load(memory_order_relaxed)) {
+            long long due = (currentTimeMs() - startMs) * rate / 1000;
+            bool any = false;
+            while (sequence < due && !stopping.load(memory_order_relaxed)) {
+                string text = benchText("Feed", ++sequence);
+                publish(text);
+                any = true;
+            }
+            if (any) {
+                notify();
+            }
+            usleep(10000);
+        }
+    }
+    
+    void run() {
+        if (path.empty()) {
+            generate();
+        } else {
+            tailFile();
+        }
+    }
+    
+public:
+    Ingestor()
+        : ring(RING_SIZE), notified(false), stopping(false), produced(0), stalls(0),
+          rate(0), fileFd(-1), target(nullptr), accepted(0), rejected(0) {
+        readyFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    
+    ~Ingestor() {
+        stopping.store(true);
+        if (producer.joinable()) {
+            producer.join();
+        }
+        if (fileFd >= 0) {
+            close(fileFd);
+        }
+        close(readyFd);
+    }
+    
+    // Mulai tail file `source`, atau generator jika source berbentuk "gen:<n>"
+    // (n pesan per detik), dengan pesan masuk ke `queue`. Return false jika
+    // sumber tidak bisa dibuka
+    bool start(const string& source, QueuePesan* queue, string& error) {
+        if (source.compare(0, 4, "gen:") == 0) {
+            rate = atoi(source.c_str() + 4);
+            if (rate <= 0) {
+                error = "rate generator harus > 0";
+                return false;
+            }
+        } else {
+            fileFd = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fileFd < 0) {
+                error = strerror(errno);
+                return false;
+            }
+            path = source;
+        }
+        target = queue;
+        producer = thread(&Ingestor::run, this);
+        return true;
+    }
+    
+    // File descriptor yang siap dibaca saat ada pesan baru (untuk poll di thread UI)
+    int getFd() {
+        return readyFd;
+    }
+    
+    // Ambil semua pesan di ring dan masukkan ke queue tujuan (thread UI).
+    // Return jumlah pesan yang diterima queue
+    int collect() {
+        unsigned long long value;
+        ssize_t n = read(readyFd, &value, sizeof(value));
+        (void)n;
+        // Reset sebelum mengambil: pesan yang masuk setelah ini memicu wakeup baru
+        notified.exchange(false, memory_order_acq_rel);
+        
+        int added = 0;
+        string text;
+        while (ring.tryPop(text)) {
+            if (target->enqueue(text)) {
+                added++;
+            } else {
+                rejected++;
+            }
+        }
+        accepted += added;
+        return added;
+    }
+    
+    long long getProduced() {
+        return produced.load(memory_order_relaxed);
+    }
+    
+    long long getAccepted() {
+        return accepted;
+    }
+    
+    long long getRejected() {
+        return rejected;
+    }
+    
+    long long getStalls() {
+        return stalls.load(memory_order_relaxed);
+    }
+};
+
+// Pesan terjadwal: masuk ke queue chat tujuan saat jatuh tempo
+struct ScheduledMessage {
+    long long id;
+    Conversation* chat;
+    string text;
+    
+    ScheduledMessage() : id(0), chat(nullptr) {}
+};
+
+// Penjadwal pesan di atas TimerWheel. Dijalankan dari loop event (thread UI)
+// dengan waktu yang diberikan pemanggil, jadi mode batch bisa memakai jam
+// virtual. Pesan yang jatuh tempo dalam satu advance di-enqueue sekaligus
+class MessageScheduler {
+private:
+    TimerWheel<ScheduledMessage> wheel;
+    unordered_map<long long, long long> handleById; // ID jadwal -> handle wheel
+    vector<ScheduledMessage> due;                   // Buffer kerja advance
+    long long nextId;
+    long long sent;
+    long long rejected;
+    
+public:
+    explicit MessageScheduler(long long nowMs) : wheel(nowMs), nextId(1), sent(0), rejected(0) {}
+    
+    // Jadwalkan text masuk ke chat pada dueMs; return ID jadwal
+    long long schedule(Conversation* chat, const string& text, long long dueMs) {
+        ScheduledMessage message;
+        message.id = nextId++;
+        message.chat = chat;
+        message.text = text;
+        long long id = message.id;
+        handleById[id] = wheel.schedule(dueMs, std::move(message));
+        return id;
+    }
+    
+    // Batalkan jadwal berdasarkan ID; false jika sudah terkirim / tidak ada
+    bool cancel(long long id) {
+        unordered_map<long long, long long>::iterator it = handleById.find(id);
+        if (it == handleById.end()) {
+            return false;
+        }
+        wheel.cancel(it->second);
+        handleById.erase(it);
+        return true;
+    }
+    
+    // Kirim semua pesan yang jatuh tempo sampai nowMs. Return jumlah pesan
+    // yang diproses (terkirim atau ditolak filter chat tujuan)
+    int advance(long long nowMs) {
+        wheel.advance(nowMs, due);
+        int processed = due.size();
+        for (size_t i = 0; i < due.size(); i++) {
+            handleById.erase(due[i].id);
+            if (due[i].chat->queue.enqueue(due[i].text)) {
+                sent++;
+            } else {
+                rejected++;
+            }
+        }
+        due.clear();
+        return processed;
+    }
+    
+    long long nextDueMs() const {
+        return wheel.nextDueMs();
+    }
+    
+    // `limit` jadwal paling awal, urut jatuh tempo
+    void upcoming(int limit, vector<const ScheduledMessage*>& messages, vector<long long>& dueMs) const {
+        vector<long long> handles;
+        wheel.upcoming(limit, handles);
+        messages.clear();
+        dueMs.clear();
+        for (size_t i = 0; i < handles.size(); i++) {
+            messages.push_back(&wheel.valueOf(handles[i]));
+            dueMs.push_back(wheel.dueOf(handles[i]));
+        }
+    }
+    
+    int getPending() const {
+        return wheel.getCount();
+    }
+    
+    long long getSent() const {
+        return sent;
+    }
+    
+    long long getRejected() const {
+        return rejected;
+    }
+};
+
+// Protokol server lokal (--server): setiap frame diawali panjang u32 (urutan
+// byte host) untuk sisa frame.
+//   Request : [u32 len][u8 op][u8 panjang nama chat][nama chat][payload]
+//             nama kosong = chat aktif; payload SEND = text, DEQUEUE/CANCEL =
+//             u32 jumlah, MARK_READ = u64 ID pesan, SIZE = kosong,
+//             MEMBER_READ = u32 anggota (mulai 0) + u64 ID + u8 (1 = sampai ID)
+//   Response: [u32 len = 9][u8 status][u64 nilai]
+//             nilai SEND = ID pesan (atau RejectReason jika ditolak),
+//             DEQUEUE/CANCEL = jumlah terhapus, SIZE = jumlah pesan,
+//             MEMBER_READ = jumlah anggota yang sudah membaca pesan ID
+enum ServerOp {
+    SERVER_SEND = 1,
+    SERVER_DEQUEUE = 2,
+    SERVER_CANCEL = 3,
+    SERVER_MARK_READ = 4,
+    SERVER_SIZE = 5,
+    SERVER_MEMBER_READ = 6
+};
+
+enum ServerStatus {
+    SERVER_OK = 0,
+    SERVER_REJECTED = 1,
+    SERVER_NOT_FOUND = 2,
+    SERVER_BAD_REQUEST = 3,
+    SERVER_STATUS_COUNT
+};
+
+const size_t SERVER_MAX_FRAME = 64 * 1024;
+const size_t SERVER_RESPONSE_SIZE = 4 + 1 + 8;
+
+// Fungsi untuk menulis frame request ke buffer (dipakai load generator)
+void appendServerRequest(string& out, ServerOp op, const string& chat, const char* payload, size_t payloadLen) {
+    unsigned int length = 1 + 1 + chat.length() + payloadLen;
+    out.append((const char*)&length, 4);
+    out += (char)op;
+    out += (char)chat.length();
+    out += chat;
+    out.append(payload, payloadLen);
+}
+
+// Server Unix domain socket dengan loop epoll (level-triggered, non-blocking).
+// Berjalan di thread TUI: request diproses saat TUI menunggu input, jadi
+// QueuePesan tetap hanya disentuh satu thread. Request boleh di-pipeline;
+// response dikirim berurutan
+class ChatServer {
+private:
+    struct Client {
+        int fd;
+        string in;      // Byte yang belum lengkap menjadi frame
+        size_t inPos;
+        string out;     // Response yang belum terkirim
+        size_t outPos;
+        bool wantWrite; // EPOLLOUT sedang terdaftar
+        
+        Client(int f) : fd(f), inPos(0), outPos(0), wantWrite(false) {}
+    };
+    
+    int listenFd;
+    int epollFd;
+    string socketPath;
+    ChatList& chats;
+    Conversation*& active;
+    unordered_map<int, Client*> clients;
+    long long requests;
+    long long changes; // Request yang mengubah isi chat
+    
+    void closeClient(Client* client) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, client->fd, nullptr);
+        close(client->fd);
+        clients.erase(client->fd);
+        delete client;
+    }
+    
+    void acceptClients() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return; // EAGAIN: antrian accept sudah kosong
+            }
+            Client* client = new Client(fd);
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+            clients[fd] = client;
+        }
+    }
+    
+    static void appendResponse(string& out, ServerStatus status, unsigned long long value) {
+        unsigned int length = 1 + 8;
+        out.append((const char*)&length, 4);
+        out += (char)status;
+        out.append((const char*)&value, 8);
+    }
+    
+    // Jalankan satu request (frame tanpa prefix panjang)
+    void handle(const char* frame, size_t length, string& out) {
+        ScopedLatency timer(STAT_SERVER_REQUEST);
+        requests++;
+        
+        size_t nameLen = length >= 2 ? (unsigned char)frame[1] : 0;
+        if (length < 2 || length < 2 + nameLen) {
+            appendResponse(out, SERVER_BAD_REQUEST, 0);
+            return;
+        }
+        unsigned char op = frame[0];
+        const char* payload = frame + 2 + nameLen;
+        size_t payloadLen = length - 2 - nameLen;
+        Conversation* chat = active;
+        if (nameLen > 0) {
+            string name(frame + 2, nameLen);
+            chat = (op == SERVER_SEND) ? chats.open(name) : chats.find(name);
+            if (chat == nullptr) {
+                appendResponse(out, SERVER_NOT_FOUND, 0);
+                return;
+            }
+        }
+        QueuePesan& queue = chat->queue;
+        
+        unsigned int count = 0;
+        unsigned long long id = 0;
+        switch (op) {
+            case SERVER_SEND: {
+                string text(payload, payloadLen);
+                if (!textKernels.allWhitespace(text.data(), text.length()) && queue.enqueue(text)) {
+                    changes++;
+                    appendResponse(out, SERVER_OK, queue.getLastId());
+                } else {
+                    appendResponse(out, SERVER_REJECTED, queue.getLastReject());
+                }
+                return;
+            }
+            case SERVER_DEQUEUE:
+            case SERVER_CANCEL: {
+                if (payloadLen != 4) break;
+                memcpy(&count, payload, 4);
+                int removed = (op == SERVER_DEQUEUE) ? queue.dequeue((int)min(count, (unsigned int)INT_MAX))
+                                                     : queue.cancelLast((int)min(count, (unsigned int)INT_MAX));
+                if (removed > 0) changes++;
+                appendResponse(out, removed > 0 ? SERVER_OK : SERVER_NOT_FOUND, removed);
+                return;
+            }
+            case SERVER_MARK_READ: {
+                if (payloadLen != 8) break;
+                memcpy(&id, payload, 8);
+                bool ok = queue.markAsReadById((long long)id);
+                if (ok) changes++;
+                appendResponse(out, ok ? SERVER_OK : SERVER_NOT_FOUND, 0);
+                return;
+            }
+            case SERVER_SIZE:
+                appendResponse(out, SERVER_OK, queue.getSize());
+                return;
+            case SERVER_MEMBER_READ: {
+                if (payloadLen != 13) break;
+                unsigned int member;
+                memcpy(&member, payload, 4);
+                memcpy(&id, payload + 4, 8);
+                GroupReceipts* group = chat->group.get();
+                Node* node = queue.findById((long long)id);
+                if (group == nullptr || member >= (unsigned int)group->getMemberCount() || node == nullptr) {
+                    appendResponse(out, SERVER_NOT_FOUND, 0);
+                    return;
+                }
+                if (payload[12] != 0) {
+                    group->markReadUpTo(member, (long long)id);
+                } else {
+                    group->markRead(member, node);
+                }
+                changes++;
+                appendResponse(out, SERVER_OK, group->countReaders(node));
+                return;
+            }
+        }
+        appendResponse(out, SERVER_BAD_REQUEST, 0);
+    }
+    
+    // Kirim response yang tertunda; EPOLLOUT hanya didaftarkan selama socket penuh
+    bool flush(Client* client) {
+        while (client->outPos < client->out.length()) {
+            ssize_t n = send(client->fd, client->out.data() + client->outPos, client->out.length() - client->outPos, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return false;
+            }
+            client->outPos += n;
+        }
+        if (client->outPos == client->out.length()) {
+            client->out.clear();
+            client->outPos = 0;
+        }
+        bool wantWrite = !client->out.empty();
+        if (wantWrite != client->wantWrite) {
+            struct epoll_event ev;
+            ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+            ev.data.fd = client->fd;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, client->fd, &ev);
+            client->wantWrite = wantWrite;
+        }
+        return true;
+    }
+    
+    // Baca yang tersedia lalu proses semua frame lengkap; false = tutup koneksi
+    bool readClient(Client* client) {
+        char buf[16384];
+        for (int round = 0; round < 16; round++) { // Batas agar satu client tidak memonopoli loop
+            ssize_t n = read(client->fd, buf, sizeof(buf));
+            if (n == 0) {
+                return false;
+            }
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return false;
+            }
+            client->in.append(buf, n);
+            if (n < (ssize_t)sizeof(buf)) break;
+        }
+        
+        while (client->in.length() - client->inPos >= 4) {
+            unsigned int length;
+            memcpy(&length, client->in.data() + client->inPos, 4);
+            if (length == 0 || length > SERVER_MAX_FRAME) {
+                return false; // Frame rusak: protokol tidak bisa disinkronkan lagi
+            }
+            if (client->in.length() - client->inPos - 4 < length) {
+                break;
+            }
+            handle(client->in.data() + client->inPos + 4, length, client->out);
+            client->inPos += 4 + length;
+        }
+        if (client->inPos == client->in.length()) {
+            client->in.clear();
+            client->inPos = 0;
+        } else if (client->inPos > 4096 && client->inPos * 2 > client->in.length()) {
+            client->in.erase(0, client->inPos);
+            client->inPos = 0;
+        }
+        return flush(client);
+    }
+    
+public:
+    ChatServer(ChatList& list, Conversation*& current)
+        : listenFd(-1), epollFd(-1), chats(list), active(current), requests(0), changes(0) {}
+    
+    ~ChatServer() {
+        for (unordered_map<int, Client*>::iterator it = clients.begin(); it != clients.end(); ++it) {
+            close(it->first);
+            delete it->second;
+        }
+        if (listenFd >= 0) {
+            close(listenFd);
+            unlink(socketPath.c_str());
+        }
+        if (epollFd >= 0) {
+            close(epollFd);
+        }
+    }
+    
+    // Mulai listen di path; socket lama di path yang sama dihapus dulu
+    bool start(const char* path, string& error) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            error = "path socket terlalu panjang";
+            return false;
+        }
+        strcpy(addr.sun_path, path);
+        
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (listenFd < 0 || epollFd < 0) {
+            error = strerror(errno);
+            return false;
+        }
+        unlink(path);
+        if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 128) < 0) {
+            error = strerror(errno);
+            close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        socketPath = path;
+        
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = listenFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+        return true;
+    }
+    
+    // File descriptor epoll: bisa di-poll bersama stdin oleh TUI
+    int getFd() {
+        return epollFd;
+    }
+    
+    // Proses event yang siap (tunggu maksimal timeoutMs, -1 = tanpa batas).
+    // Return jumlah request yang mengubah isi chat
+    int poll(int timeoutMs) {
+        struct epoll_event events[64];
+        int ready = epoll_wait(epollFd, events, 64, timeoutMs);
+        long long before = changes;
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            unordered_map<int, Client*>::iterator it = clients.find(fd);
+            if (it == clients.end()) {
+                continue;
+            }
+            Client* client = it->second;
+            bool keep = true;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                keep = readClient(client);
+            } else if (events[i].events & EPOLLOUT) {
+                keep = flush(client);
+            }
+            if (!keep) {
+                closeClient(client);
+            }
+        }
+        return (int)(changes - before);
+    }
+    
+    int getClientCount() {
+        return clients.size();
+    }
+    
+    long long getRequestCount() {
+        return requests;
+    }
+    
+    long long getChangeCount() {
+        return changes;
+    }
+};
+
+// Server, pipeline delivery dan sumber ingest yang ikut dilayani saat TUI
+// menunggu input
+ChatServer* tuiServer = nullptr;
+DeliveryPipeline* tuiDelivery = nullptr;
+Ingestor* tuiIngest = nullptr;
+MessageScheduler* tuiScheduler = nullptr;
+ChatList* tuiChats = nullptr; // Untuk menghapus pesan kedaluwarsa (TTL)
+
+// Redraw karena event background dibatasi ke frame rate target (--fps):
+// event tetap dilayani segera, hanya penggambaran ulang yang ditunda
+int frameIntervalMs = 1000 / 30;
+long long lastFrameMs = 0;
+bool redrawPending = false;
+// Layar dengan hitung mundur (Pesan Terjadwal) digambar ulang tiap detik
+bool secondTicker = false;
+
+// Jumlah perubahan dari luar TUI; layar yang menyimpan pointer node
+// membandingkan nilai ini untuk tahu kapan harus membuang cache-nya
+long long externalChangeCount() {
+    return (tuiServer != nullptr ? tuiServer->getChangeCount() : 0) +
+           (tuiIngest != nullptr ? tuiIngest->getAccepted() : 0) +
+           (tuiScheduler != nullptr ? tuiScheduler->getSent() : 0) +
+           (tuiChats != nullptr ? tuiChats->getExpiredTotal() : 0);
+}
+
+// Fungsi untuk menunggu event background (server, ack delivery, ingest, pesan
+// terjadwal, pesan kedaluwarsa) dan stdin jika watchStdin. Return 1 jika ada perubahan yang perlu digambar ulang
+// (paling cepat satu frame setelah frame terakhir), 0 jika stdin siap dibaca
+// (atau tidak ada sumber background), -1 jika timeout
+int serviceBackground(bool watchStdin, int timeoutMs) {
+    struct pollfd fds[4];
+    int count = 0;
+    int serverIndex = -1;
+    int deliveryIndex = -1;
+    int ingestIndex = -1;
+    if (watchStdin) {
+        fds[count].fd = STDIN_FILENO;
+        fds[count++].events = POLLIN;
+    }
+    if (tuiServer != nullptr) {
+        serverIndex = count;
+        fds[count].fd = tuiServer->getFd();
+        fds[count++].events = POLLIN;
+    }
+    if (tuiDelivery != nullptr) {
+        deliveryIndex = count;
+        fds[count].fd = tuiDelivery->getFd();
+        fds[count++].events = POLLIN;
+    }
+    if (tuiIngest != nullptr) {
+        ingestIndex = count;
+        fds[count].fd = tuiIngest->getFd();
+        fds[count++].events = POLLIN;
+    }
+    bool timerPending = (tuiScheduler != nullptr && tuiScheduler->nextDueMs() >= 0) ||
+                        (tuiChats != nullptr && tuiChats->nextExpiryMs() >= 0);
+    if (count == (watchStdin ? 1 : 0) && !timerPending && !(watchStdin && secondTicker)) {
+        return 0;
+    }
+    // Redraw yang tertunda: tunggu paling lama sampai frame berikutnya boleh digambar
+    if (watchStdin && redrawPending) {
+        long long waitMs = max(0LL, lastFrameMs + frameIntervalMs - currentTimeMs());
+        if (timeoutMs < 0 || waitMs < timeoutMs) {
+            timeoutMs = (int)waitMs;
+        }
+    }
+    // Pesan terjadwal dan pesan kedaluwarsa: bangun saat timer wheel perlu dimajukan
+    long long wheelDue[2] = {
+        tuiScheduler != nullptr ? tuiScheduler->nextDueMs() : -1,
+        tuiChats != nullptr ? tuiChats->nextExpiryMs() : -1
+    };
+    for (int i = 0; i < 2; i++) {
+        if (wheelDue[i] < 0) continue;
+        long long waitMs = max(0LL, wheelDue[i] - currentTimeMs());
+        if (timeoutMs < 0 || waitMs < timeoutMs) {
+            timeoutMs = (int)waitMs;
+        }
+    }
+    if (watchStdin && secondTicker) {
+        long long waitMs = max(0LL, lastFrameMs + 1000 - currentTimeMs());
+        if (timeoutMs < 0 || waitMs < timeoutMs) {
+            timeoutMs = (int)waitMs;
+        }
+    }
+    int ready = ::poll(fds, count, timeoutMs);
+    bool changed = false;
+    if (ready > 0) {
+        if (serverIndex >= 0 && (fds[serverIndex].revents & POLLIN)) {
+            changed = tuiServer->poll(0) > 0 || changed;
+        }
+        if (deliveryIndex >= 0 && (fds[deliveryIndex].revents & POLLIN)) {
+            changed = tuiDelivery->collect() > 0 || changed;
+        }
+        if (ingestIndex >= 0 && (fds[ingestIndex].revents & POLLIN)) {
+            changed = tuiIngest->collect() > 0 || changed;
+        }
+    }
+    if (tuiScheduler != nullptr) {
+        changed = tuiScheduler->advance(currentTimeMs()) > 0 || changed;
+    }
+    if (tuiChats != nullptr) {
+        changed = tuiChats->expireDue(currentTimeMs()) > 0 || changed;
+    }
+    if (watchStdin && secondTicker && currentTimeMs() - lastFrameMs >= 1000) {
+        changed = true;
+    }
+    if (!watchStdin) {
+        return changed ? 1 : -1;
+    }
+    if (ready > 0 && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+        redrawPending = redrawPending || changed;
+        return 0; // Key didahulukan; frame setelah key ikut menampilkan perubahan
+    }
+    redrawPending = redrawPending || changed;
+    if (redrawPending && currentTimeMs() - lastFrameMs >= frameIntervalMs) {
+        return 1;
+    }
+    return -1; // Timeout, EINTR atau perubahan yang menunggu frame berikutnya
+}
+
+// ID widget yang bisa diklik dengan mouse
+enum WidgetId {
+    WIDGET_NONE = 0,
+    WIDGET_BACK,        // Tombol [← KEMBALI]
+    WIDGET_SEND,        // Tombol [✓ KIRIM]
+    WIDGET_MARK,        // Tombol [✓ TANDAI]
+    WIDGET_TEXT_INPUT,  // Area input text
+    WIDGET_SCHEDULE,    // Tombol [◷ JADWAL]
+    WIDGET_MENU_ITEM,   // Item menu ke-i = WIDGET_MENU_ITEM + i
+    WIDGET_CHAT_ROW = WIDGET_MENU_ITEM + 16, // Baris daftar chat ke-i = WIDGET_CHAT_ROW + i
+    WIDGET_COUNT = WIDGET_MENU_ITEM + 32
+};
+
+// Kotak area widget di layar (koordinat terminal, mulai dari 1)
+struct Region {
+    int x, y, width, height;
+
+    Region() : x(0), y(0), width(0), height(0) {}
+};
+
+// Peta region per frame: renderer mendaftarkan setiap tombol, item menu
+// dan area text yang digambar, lalu event mouse dicari lewat 1 lookup grid
+class RegionMap {
+private:
+    int width;
+    int height;
+    vector<unsigned char> cells; // Widget ID untuk setiap sel layar
+    Region regions[WIDGET_COUNT];
+
+public:
+    RegionMap() : width(0), height(0) {}
+
+    // Kosongkan peta untuk frame baru (ukuran mengikuti terminal)
+    void clear() {
+        struct winsize ws;
+        int newWidth = 80, newHeight = 24;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+            newWidth = ws.ws_col;
+            newHeight = ws.ws_row;
+        }
+        width = newWidth;
+        height = newHeight;
+        cells.assign(width * height, WIDGET_NONE);
+        for (int i = 0; i < WIDGET_COUNT; i++) {
+            regions[i] = Region();
+        }
+    }
+
+    // Daftarkan widget yang baru saja digambar
+    void add(int id, int x, int y, int w, int h) {
+        if (id <= WIDGET_NONE || id >= WIDGET_COUNT) {
+            return;
+        }
+        regions[id].x = x;
+        regions[id].y = y;
+        regions[id].width = w;
+        regions[id].height = h;
+
+        for (int row = y; row < y + h; row++) {
+            if (row < 1 || row > height) continue;
+            for (int col = x; col < x + w; col++) {
+                if (col < 1 || col > width) continue;
+                cells[(row - 1) * width + (col - 1)] = id;
+            }
+        }
+    }
+
+    // Cari widget di posisi (x, y) - O(1)
+    int hitTest(int x, int y) const {
+        if (x < 1 || y < 1 || x > width || y > height) {
+            return WIDGET_NONE;
+        }
+        return cells[(y - 1) * width + (x - 1)];
+    }
+
+    // Mendapatkan area widget (untuk menghitung posisi relatif klik)
+    const Region& get(int id) const {
+        return regions[id];
+    }
+
+    // Tinggi terminal pada frame ini (baris)
+    int getHeight() const {
+        return height;
+    }
+};
+
+// Peta region untuk frame yang sedang tampil
+RegionMap regions;
+
+// Ambang waktu double-click (milidetik), dipakai semua layar
+const int DOUBLE_CLICK_THRESHOLD = 500;
+
+// Deteksi double-click: menyimpan target dan waktu klik terakhir
+struct ClickTracker {
+    int lastTarget;
+    long long lastTime;
+
+    ClickTracker() : lastTarget(-1), lastTime(0) {}
+
+    // Return true jika klik ini klik kedua pada target yang sama
+    bool click(int target) {
+        long long now = currentTimeMs();
+        if (target == lastTarget && (now - lastTime) < DOUBLE_CLICK_THRESHOLD) {
+            lastTarget = -1; // Reset untuk prevent triple-click
+            return true;
+        }
+        lastTarget = target;
+        lastTime = now;
+        return false;
+    }
+};
+
+// Fungsi gotoxy untuk positioning di terminal
+void gotoxy(int x, int y) {
+    printf("\033[%d;%dH", y, x);
+}
+
+// Waktu mulai frame yang sedang digambar (0 = tidak diukur)
+long long frameStartNs = 0;
+
+// Fungsi untuk clear screen
+void clearScreen() {
+    if (statsEnabled) {
+        frameStartNs = currentTimeNs();
+    }
+    printf("\033[2J");
+    printf("\033[H");
+    fflush(stdout);
+
+    // Frame baru: region dari frame sebelumnya tidak berlaku lagi
+    regions.clear();
+}
+
+// Fungsi untuk menggambar ulang layar mulai baris `row` saja; baris di atasnya
+// tetap dari frame sebelumnya (tanpa kedip clear penuh saat update background)
+void clearScreenFrom(int row) {
+    if (statsEnabled) {
+        frameStartNs = currentTimeNs();
+    }
+    printf("\033[%d;1H\033[J", row);
+    regions.clear();
+}
+
+// Rekaman sesi (--record): setiap byte stdin disimpan dengan timestamp
+// Format per baris: "<mikrodetik sejak mulai> <K|C> <hex byte>"
+// K = byte pertama sebuah key (awal event), C = lanjutan escape sequence
+FILE* recordFile = nullptr;
+long long recordStartNs = 0;
+
+// Penanda akhir frame untuk replay (OSC yang diabaikan terminal biasa)
+const char FRAME_MARKER[] = "\033]777;wa-frame\007";
+bool emitFrameMarker = false;
+
+// Fungsi untuk membaca 1 byte stdin dan merekamnya jika --record aktif
+ssize_t readRecorded(char* c, char kind) {
+    ssize_t n = read(STDIN_FILENO, c, 1);
+    if (n == 1 && recordFile != nullptr) {
+        fprintf(recordFile, "%lld %c %02x\n", (currentTimeNs() - recordStartNs) / 1000,
+                kind, (unsigned char)*c);
+    }
+    return n;
+}
+
+// Fungsi untuk membaca lanjutan escape sequence
+ssize_t readInput(char* c) {
+    return readRecorded(c, 'C');
+}
+
+// Fungsi untuk membaca key pertama dari input; frame dianggap selesai di sini
+ssize_t readKey(char* c) {
+    if (frameStartNs != 0) {
+        threadStats().histograms[STAT_FRAME_RENDER].record(currentTimeNs() - frameStartNs);
+        frameStartNs = 0;
+    }
+    if (emitFrameMarker) {
+        fputs(FRAME_MARKER, stdout);
+        fflush(stdout);
+    }
+    // Frame baru saja selesai digambar: semua perubahan sebelumnya sudah tampil
+    lastFrameMs = currentTimeMs();
+    redrawPending = false;
+    // Request server, ack delivery dan ingest dilayani selama menunggu key;
+    // return 0 (tanpa key) jika ada perubahan agar layar digambar ulang
+    while (true) {
+        int result = serviceBackground(true, -1);
+        if (result == 1) {
+            return 0;
+        }
+        if (result == 0) {
+            break;
+        }
+    }
+    return readRecorded(c, 'K');
+}
+
+// Fungsi untuk set warna text
+void setColor(int color) {
+    printf("\033[%dm", color);
+}
+
+// Reset warna
+void resetColor() {
+    printf("\033[0m");
+}
+
+// Fungsi untuk convert string ke lowercase
+string toLowerCase(string str) {
+    foldAsciiInPlace(str);
+    return str;
+}
+
+// Fungsi untuk cek apakah string hanya berisi whitespace/newline
+bool isEmptyOrWhitespace(const string& str) {
+    return textKernels.allWhitespace(str.data(), str.length());
+}
+
+// Fungsi untuk parse input multiple message numbers
+// Format: "1,3,5" atau "1-3" atau "1,3-5,7" atau "all"
+// Return: vector berisi index yang dipilih (0-based)
+vector<int> parseMessageNumbers(const string& input, int maxSize) {
+    vector<int> result;
+    
+    if (toLowerCase(input) == "all") {
+        for (int i = 0; i < maxSize; i++) {
+            result.push_back(i);
+        }
+        return result;
+    }
+    
+    string current = "";
+    for (int i = 0; i <= (int)input.length(); i++) {
+        char ch = (i < (int)input.length()) ? input[i] : ',';
+        
+        if (ch == ',' || ch == ' ' || i == (int)input.length()) {
+            if (!current.empty()) {
+                // Check if it's a range (e.g., "1-3")
+                int dashPos = -1;
+                for (int j = 0; j < (int)current.length(); j++) {
+                    if (current[j] == '-') {
+                        dashPos = j;
+                        break;
+                    }
+                }
+                
+                if (dashPos != -1) {
+                    // Range format
+                    string startStr = current.substr(0, dashPos);
+                    string endStr = current.substr(dashPos + 1);
+                    int start = atoi(startStr.c_str());
+                    int end = atoi(endStr.c_str());
+                    
+                    if (start > 0 && end > 0 && start <= end && end <= maxSize) {
+                        for (int j = start; j <= end; j++) {
+                            result.push_back(j - 1); // Convert to 0-based
+                        }
+                    }
+                } else {
+                    // Single number
+                    int num = atoi(current.c_str());
+                    if (num > 0 && num <= maxSize) {
+                        result.push_back(num - 1); // Convert to 0-based
+                    }
+                }
+                current = "";
+            }
+        } else {
+            current += ch;
+        }
+    }
+    
+    return result;
+}
+
+// Fungsi untuk parse daftar ID pesan
+// Format: "12,15" atau "12-20" atau "12,15-18" atau "all"
+// Range dibatasi ke [minId, maxId] agar tidak loop di ID yang sudah tidak ada
+vector<long long> parseMessageIds(const string& input, long long minId, long long maxId) {
+    vector<long long> result;
+    if (minId <= 0 || maxId < minId) {
+        return result;
+    }
+    
+    if (toLowerCase(input) == "all") {
+        for (long long id = minId; id <= maxId; id++) {
+            result.push_back(id);
+        }
+        return result;
+    }
+    
+    string current = "";
+    for (int i = 0; i <= (int)input.length(); i++) {
+        char ch = (i < (int)input.length()) ? input[i] : ',';
+        
+        if (ch == ',' || ch == ' ') {
+            if (!current.empty()) {
+                size_t dashPos = current.find('-');
+                long long start = atoll(current.c_str());
+                long long end = (dashPos != string::npos) ? atoll(current.c_str() + dashPos + 1) : start;
+                if (start > 0 && start <= end) {
+                    for (long long id = max(start, minId); id <= min(end, maxId); id++) {
+                        result.push_back(id);
+                    }
+                }
+                current = "";
+            }
+        } else {
+            current += ch;
+        }
+    }
+    
+    return result;
+}
+
+// Fungsi untuk menandai pesan dari input daftar ID, return jumlah yang ditandai
+int markMessagesById(QueuePesan& queue, const string& input) {
+    vector<long long> ids = parseMessageIds(input, queue.getFirstId(), queue.getLastId());
+    return queue.markAsReadByIds(ids);
+}
+
+// Fungsi untuk enable mouse tracking
+void enableMouseTracking() {
+    printf("\033[?1000h"); // Enable mouse button tracking
+    printf("\033[?1002h"); // Enable mouse motion tracking
+    printf("\033[?1015h"); // Enable urxvt mouse mode
+    printf("\033[?1006h"); // Enable SGR mouse mode
+}
+
+// Fungsi untuk disable mouse tracking
+void disableMouseTracking() {
+    printf("\033[?1000l");
+    printf("\033[?1002l");
+    printf("\033[?1015l");
+    printf("\033[?1006l");
+}
+
+// Event mouse dari laporan SGR ("\033[<b;x;yM" atau "...m")
+struct MouseEvent {
+    int button;   // 0 = klik kiri, 32 = drag
+    int x;
+    int y;
+    bool pressed; // true = 'M' (tekan), false = 'm' (lepas)
+
+    MouseEvent() : button(0), x(0), y(0), pressed(false) {}
+};
+
+// Fungsi untuk membaca sisa laporan mouse setelah prefix "\033[<"
+bool readMouseEvent(MouseEvent& ev) {
+    int values[3] = {0, 0, 0};
+    int field = 0;
+    char ch;
+
+    while (readInput(&ch) == 1) {
+        if (ch >= '0' && ch <= '9') {
+            values[field] = values[field] * 10 + (ch - '0');
+        } else if (ch == ';') {
+            if (field < 2) field++;
+        } else if (ch == 'M' || ch == 'm') {
+            ev.button = values[0];
+            ev.x = values[1];
+            ev.y = values[2];
+            ev.pressed = (ch == 'M');
+            return true;
+        } else {
+            return false; // Format tidak dikenal
+        }
+    }
+    return false;
+}
+
+// Fungsi untuk set terminal ke raw mode
+struct termios orig_termios;
+
+void disableRawMode() {
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
+    fflush(stdout);
+}
+
+void enableRawMode() {
+    tcgetattr(STDIN_FILENO, &orig_termios);
+    atexit(disableRawMode);
+    
+    struct termios raw = orig_termios;
+    raw.c_lflag &= ~(ECHO | ICANON);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+}
+
+// Fungsi untuk menampilkan header
+void displayHeader() {
+    setColor(42); // Background hijau
+    setColor(30); // Text hitam
+    gotoxy(1, 1);
+    printf("╔════════════════════════════════════════════════════════════════════════╗");
+    gotoxy(1, 2);
+    printf("║              WhatsApp Simulator - Queue Implementation                 ║");
+    gotoxy(1, 3);
+    printf("╚════════════════════════════════════════════════════════════════════════╝");
+    resetColor();
+    fflush(stdout);
+}
+
+// Daftar menu utama
+const char* MENU_OPTIONS[] = {
+    "1. Tambah Pesan Baru",
+    "2. Hapus Pesan Berikutnya",
+    "3. Batalkan Pesan Terakhir",
+    "4. Lihat Semua Pesan",
+    "5. Tandai Sebagai Dibaca",
+    "6. Statistik",
+    "7. Cari Pesan",
+    "8. Daftar Chat",
+    "9. Pesan Terjadwal",
+    "10. Keluar"
+};
+const int MENU_COUNT = sizeof(MENU_OPTIONS) / sizeof(MENU_OPTIONS[0]);
+
+// Fungsi untuk menampilkan menu
+void displayMenu(int selected) {
+    int menuY = 5;
+    int menuX = 10;
+    
+    gotoxy(menuX, menuY);
+    printf("╔══════════════════════════════════════════════╗");
+    
+    for (int i = 0; i < MENU_COUNT; i++) {
+        gotoxy(menuX, menuY + 1 + i);
+        if (i == selected) {
+            setColor(47); // Background putih
+            setColor(30); // Text hitam
+            printf("║ > %-43s║", MENU_OPTIONS[i]);
+            resetColor();
+        } else {
+            printf("║   %-43s║", MENU_OPTIONS[i]);
+        }
+        regions.add(WIDGET_MENU_ITEM + i, menuX, menuY + 1 + i, 48, 1);
+    }
+    
+    gotoxy(menuX, menuY + MENU_COUNT + 1);
+    printf("╚══════════════════════════════════════════════╝");
+    
+    gotoxy(menuX, menuY + MENU_COUNT + 3);
+    setColor(36); // Cyan
+    printf("Mouse: Klik 2x | Keyboard: ↑↓ Enter | u Undo | r Redo | t Pesan sementara");
+    resetColor();
+    fflush(stdout);
+}
+
+// Fungsi untuk menampilkan chat yang sedang aktif di atas menu
+void displayActiveChat(Conversation& chat) {
+    gotoxy(10, 4);
+    setColor(36);
+    printf("Chat: %s", chat.name.c_str());
+    int unread = chat.queue.getUnreadCount();
+    if (unread > 0) {
+        printf(" (%d belum dibaca)", unread);
+    }
+    if (chat.queue.getTtl() > 0) {
+        printf(" ◷ pesan hilang setelah %s", formatDelay(chat.queue.getTtl()).c_str());
+    }
+    // Pesan prioritas yang menunggu ditampilkan lebih dulu dari yang lain
+    int alerts = chat.queue.getLaneSize(PRIORITY_ALERT);
+    int mentions = chat.queue.getLaneSize(PRIORITY_MENTION);
+    if (alerts > 0) {
+        setColor(31);
+        printf(" ‼ %d darurat", alerts);
+    }
+    if (mentions > 0) {
+        setColor(33);
+        printf(" @ %d mention", mentions);
+    }
+    resetColor();
+}
+
+// Fungsi untuk menampilkan status undo/redo di bawah menu
+void displayUndoStatus(QueuePesan& queue, const string& lastAction) {
+    int y = 5 + MENU_COUNT + 5;
+    gotoxy(10, y);
+    setColor(37);
+    if (queue.canUndo()) {
+        printf("u: undo %s", queue.describeUndo().c_str());
+    } else {
+        printf("u: tidak ada yang bisa di-undo");
+    }
+    gotoxy(10, y + 1);
+    if (queue.canRedo()) {
+        printf("r: redo %s", queue.describeRedo().c_str());
+    }
+    resetColor();
+    if (!lastAction.empty()) {
+        gotoxy(10, y + 3);
+        setColor(32);
+        printf("%s", lastAction.c_str());
+        resetColor();
+    }
+    fflush(stdout);
+}
+
+// Fungsi untuk menggambar tombol kembali (tanpa membaca input)
+void drawBackButton(int y) {
+    int buttonX = 10;
+    
+    gotoxy(buttonX, y);
+    setColor(37); // Tanpa highlight karena hanya 1 tombol
+    printf("╔════════════════════╗");
+    gotoxy(buttonX, y + 1);
+    printf("║  [← KEMBALI]       ║");
+    gotoxy(buttonX, y + 2);
+    printf("╚════════════════════╝");
+    resetColor();
+    regions.add(WIDGET_BACK, buttonX, y, 22, 3);
+}
+
+// Fungsi untuk menampilkan tombol kembali
+bool displayBackButton(int y, ClickTracker& clicks) {
+    int buttonY = y;
+    int buttonX = 10;
+    
+    drawBackButton(buttonY);
+    
+    gotoxy(buttonX, buttonY + 4);
+    setColor(36);
+    printf("Enter/Klik 2x untuk kembali");
+    resetColor();
+    fflush(stdout);
+    
+    // Read input
+    char c;
+    if (readKey(&c) == 1) {
+        ScopedLatency decodeTimer(STAT_INPUT_DECODE);
+        if (c == '\033') { // ESC sequence
+            char seq[5];
+            if (readInput(&seq[0]) == 1) {
+                if (seq[0] == '[') {
+                    if (readInput(&seq[1]) == 1) {
+                        if (seq[1] == '<') { // Mouse input
+                            MouseEvent ev;
+                            if (readMouseEvent(ev) && ev.pressed && ev.button == 0) {
+                                // Check if clicked on back button
+                                if (regions.hitTest(ev.x, ev.y) == WIDGET_BACK && clicks.click(WIDGET_BACK)) {
+                                    return true; // Double click - go back
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        } else if (c == '\n' || c == '\r') { // Enter key
+            return true; // Confirm - go back
+        }
+    }
+    return false;
+}
+
+// Fungsi untuk format umur pesan dari timestamp monotonic ("5 dtk lalu")
+string formatAge(long long timestampMs) {
+    long long seconds = (currentTimeMs() - timestampMs) / 1000;
+    char buf[32];
+    if (seconds < 1) {
+        return "baru saja";
+    } else if (seconds < 60) {
+        snprintf(buf, sizeof(buf), "%lld dtk lalu", seconds);
+    } else if (seconds < 3600) {
+        snprintf(buf, sizeof(buf), "%lld mnt lalu", seconds / 60);
+    } else {
+        snprintf(buf, sizeof(buf), "%lld jam lalu", seconds / 3600);
+    }
+    return buf;
+}
+
+// Fungsi untuk menghitung jumlah baris layar satu pesan di daftar pesan
+int messageLineCount(const string& text) {
+    int lines = 1;
+    for (int i = findNewline(text, 0); i < (int)text.length(); i = findNewline(text, i + 1)) {
+        lines++;
+    }
+    return lines;
+}
+
+// Fungsi untuk menampilkan satu pesan (multi-line) di daftar pesan
+void renderMessageLines(const Node* node, int& y, GroupReceipts* group = nullptr) {
+    // Render pesan dengan multi-line support
+    const string& pesan = node->data.text;
+    bool isRead = node->data.isRead;
+    
+    // Split pesan berdasarkan newline
+    int startPos = 0;
+    bool firstLine = true;
+    
+    while (startPos <= (int)pesan.length()) {
+        int i = findNewline(pesan, startPos);
+        gotoxy(10, y);
+        
+        if (firstLine) {
+            // Baris pertama dengan indikator
+            if (isRead) {
+                setColor(37); // Abu-abu (sudah dibaca)
+                printf("[√] Pesan #%lld: ", node->data.id);
+            } else {
+                setColor(32); // Hijau (belum dibaca)
+                printf("[-] Pesan #%lld: ", node->data.id);
+            }
+        } else {
+            // Baris selanjutnya dengan indentasi
+            char indent[50];
+            snprintf(indent, sizeof(indent), "[%c] Pesan #%lld: ", ' ', node->data.id);
+            for (int j = 0; j < (int)strlen(indent); j++) {
+                printf(" ");
+            }
+        }
+        
+        // Print substring
+        string line = pesan.substr(startPos, i - startPos);
+        if (isRead) {
+            setColor(37);
+        } else {
+            setColor(32);
+        }
+        printf("%s", line.c_str());
+        if (i == (int)pesan.length()) {
+            // Status delivery: ✓ terkirim, ✓✓ diterima, ✓✓ biru dibaca
+            // (di grup: biru jika dibaca semua anggota)
+            int readers = group != nullptr ? group->countReaders(node) : 0;
+            if (group != nullptr ? readers == group->getMemberCount() : isRead) {
+                setColor(34);
+                printf(" ✓✓");
+            } else {
+                setColor(90);
+                printf(node->data.isDelivered ? " ✓✓" : " ✓");
+            }
+            if (group != nullptr) {
+                setColor(90);
+                printf(" dibaca %d/%d", readers, group->getMemberCount());
+            }
+            if (node->data.priority == PRIORITY_ALERT) {
+                setColor(31);
+                printf(" ‼");
+            } else if (node->data.priority == PRIORITY_MENTION) {
+                setColor(33);
+                printf(" @");
+            }
+            setColor(90); // Abu-abu gelap
+            printf("  (%s)", formatAge(node->data.timestamp).c_str());
+            if (node->data.expiresAt > 0) {
+                printf(" ◷ %s", formatDelay(max(0LL, node->data.expiresAt - currentTimeMs())).c_str());
+            }
+        }
+        resetColor();
+        
+        y++;
+        startPos = i + 1;
+        firstLine = false;
+    }
+}
+
+// Filter daftar pesan saat mengetik: query yang bertambah panjang hanya
+// menyaring hasil sebelumnya, dan hasil setiap panjang query disimpan di
+// stack sehingga backspace tidak perlu scan ulang
+class MessageFilter {
+public:
+    typedef const Node* Hit;
+    
+private:
+    string query;                 // Query (huruf kecil) untuk level teratas stack
+    vector<vector<Hit> > levels;  // levels[k] = hasil untuk query.substr(0, lengths[k])
+    vector<size_t> lengths;
+    
+public:
+    // Terapkan query baru; return hasil (kosong = tidak ada yang cocok)
+    const vector<Hit>& apply(const string& newQuery, QueuePesan& queue) {
+        string folded = newQuery;
+        foldAsciiInPlace(folded);
+        
+        // Buang level yang bukan prefix dari query baru (backspace/ganti text)
+        while (!lengths.empty() &&
+               (lengths.back() > folded.length() || folded.compare(0, lengths.back(), query, 0, lengths.back()) != 0)) {
+            levels.pop_back();
+            lengths.pop_back();
+        }
+        query = folded;
+        if (!lengths.empty() && lengths.back() == folded.length()) {
+            return levels.back();
+        }
+        
+        vector<Hit> next;
+        if (levels.empty()) {
+            // Scan penuh hanya untuk level pertama
+            for (Node* current = queue.getFront(); current != nullptr; current = current->next) {
+                if (current->foldedText.find(folded) != string::npos) {
+                    next.push_back(current);
+                }
+            }
+        } else {
+            // Query bertambah panjang: cukup saring kandidat yang tersisa
+            const vector<Hit>& previous = levels.back();
+            for (size_t i = 0; i < previous.size(); i++) {
+                if (previous[i]->foldedText.find(folded) != string::npos) {
+                    next.push_back(previous[i]);
+                }
+            }
+        }
+        levels.push_back(next);
+        lengths.push_back(folded.length());
+        return levels.back();
+    }
+    
+    void clear() {
+        query.clear();
+        levels.clear();
+        lengths.clear();
+    }
+};
+
+// Fungsi untuk menampilkan pesan (ketik untuk memfilter daftar). Tanpa filter
+// hanya pesan terbaru yang muat di layar yang digambar, jadi biaya frame
+// tidak tumbuh dengan jumlah pesan; pesan yang masuk di background (server,
+// ingest) menggambar ulang bagian daftar saja
+void displayMessages(QueuePesan& queue, GroupReceipts* group = nullptr) {
+    const int FILTER_LIMIT = 50; // Maksimal hasil filter yang digambar
+    const int LIST_TOP = 9;      // Baris pertama daftar pesan
+    const int FOOTER_ROWS = 9;   // Total pesan, tombol kembali dan petunjuk
+    ClickTracker buttonClicks;
+    bool shouldReturn = false;
+    bool fullRedraw = true;
+    string filterText = "";
+    MessageFilter filter;
+    long long seenChanges = externalChangeCount();
+    
+    while (!shouldReturn) {
+        if (externalChangeCount() != seenChanges) {
+            filter.clear(); // Pesan berubah lewat server/ingest: hasil lama tidak valid
+            seenChanges = externalChangeCount();
+        }
+        if (fullRedraw) {
+            clearScreen();
+            displayHeader();
+            
+            gotoxy(10, 5);
+            setColor(33); // Kuning
+            printf("═══════════════════ DAFTAR PESAN ═══════════════════");
+            resetColor();
+        } else {
+            clearScreenFrom(7);
+        }
+        
+        gotoxy(10, 7);
+        setColor(36);
+        printf("Filter: ");
+        resetColor();
+        setColor(47); setColor(30);
+        printf("%s│", filterText.c_str());
+        resetColor();
+        
+        int y = LIST_TOP;
+        
+        if (queue.isEmpty()) {
+            gotoxy(10, y);
+            setColor(31); // Merah
+            printf("Tidak ada pesan.");
+            resetColor();
+            y++;
+        } else if (filterText.empty()) {
+            // Cari mundur dari pesan terbaru sampai layar penuh, lalu gambar maju
+            int budget = max(3, regions.getHeight() - LIST_TOP - FOOTER_ROWS - 1);
+            int older = queue.getSize();
+            Node* first = nullptr;
+            for (Node* current = queue.getRear(); current != nullptr; current = current->prev) {
+                int lines = messageLineCount(current->data.text);
+                if (first != nullptr && lines > budget) break;
+                first = current;
+                older--;
+                budget -= lines;
+                if (budget <= 0) break;
+            }
+            if (older > 0) {
+                gotoxy(10, y++);
+                setColor(37);
+                printf("... %d pesan sebelumnya (ketik untuk filter)", older);
+                resetColor();
+            }
+            for (Node* current = first; current != nullptr; current = current->next) {
+                renderMessageLines(current, y, group);
+            }
+        } else {
+            const vector<MessageFilter::Hit>& hits = filter.apply(filterText, queue);
+            if (hits.empty()) {
+                gotoxy(10, y);
+                setColor(31);
+                printf("Tidak ada pesan yang cocok.");
+                resetColor();
+                y++;
+            }
+            for (int i = 0; i < (int)hits.size() && i < FILTER_LIMIT; i++) {
+                renderMessageLines(hits[i], y, group);
+            }
+            if ((int)hits.size() > FILTER_LIMIT) {
+                gotoxy(10, y++);
+                setColor(37);
+                printf("... dan %d pesan lainnya", (int)hits.size() - FILTER_LIMIT);
+                resetColor();
+            }
+            gotoxy(10 + 8 + filterText.length() + 3, 7);
+            setColor(36);
+            printf("(%d cocok)", (int)hits.size());
+            resetColor();
+        }
+        
+        gotoxy(10, y + 2);
+        setColor(36);
+        printf("Total pesan: %d", queue.getSize());
+        resetColor();
+        
+        drawBackButton(y + 4);
+        gotoxy(10, y + 8);
+        setColor(36);
+        printf("Ketik untuk filter | Backspace hapus | Enter/Klik 2x untuk kembali");
+        resetColor();
+        fflush(stdout);
+        
+        // Read input
+        char c;
+        fullRedraw = readKey(&c) == 1;
+        if (fullRedraw) {
+            ScopedLatency decodeTimer(STAT_INPUT_DECODE);
+            if (c == '\033') { // ESC sequence
+                char seq[2];
+                if (readInput(&seq[0]) == 1 && seq[0] == '[' && readInput(&seq[1]) == 1 && seq[1] == '<') {
+                    MouseEvent ev;
+                    if (readMouseEvent(ev) && ev.pressed && ev.button == 0) {
+                        if (regions.hitTest(ev.x, ev.y) == WIDGET_BACK && buttonClicks.click(WIDGET_BACK)) {
+                            shouldReturn = true; // Double click - kembali
+                        }
+                    }
+                }
+            } else if (c == '\n' || c == '\r') { // Enter key
+                shouldReturn = true;
+            } else if (c == 127 || c == 8) { // Backspace
+                if (!filterText.empty()) {
+                    size_t cut = filterText.length() - 1;
+                    while (cut > 0 && ((unsigned char)filterText[cut] & 0xC0) == 0x80) cut--;
+                    filterText.erase(cut);
+                }
+            } else if ((unsigned char)c >= 32) {
+                filterText += c;
+            }
+        }
+    }
+}
+
+// Fungsi untuk menanyakan jeda lalu menjadwalkan pesan ke scheduler
+// Return: true jika pesan dijadwalkan (delayMs diisi), false jika dibatalkan
+bool scheduleMessage(Conversation& chat, const string& message, int row, long long& delayMs) {
+    if (tuiScheduler == nullptr) {
+        return false;
+    }
+    string input;
+    bool invalid = false;
+    while (true) {
+        gotoxy(10, row);
+        printf("\033[K");
+        setColor(33);
+        printf("◷ Kirim dalam (30s / 5m / 1j30m, Enter kosong = batal): ");
+        resetColor();
+        printf("%s│", input.c_str());
+        gotoxy(10, row + 1);
+        printf("\033[K");
+        if (invalid) {
+            setColor(31);
+            printf("✗ Format waktu tidak valid!");
+            resetColor();
+        }
+        fflush(stdout);
+
+        char c;
+        if (readKey(&c) != 1) {
+            continue; // Perubahan background: gambar ulang prompt saja
+        }
+        if (c == '\033') {
+            // Buang sisa escape sequence (panah/mouse) tanpa keluar dari prompt
+            char seq;
+            if (readInput(&seq) == 1 && seq == '[' && readInput(&seq) == 1 && seq == '<') {
+                MouseEvent ev;
+                readMouseEvent(ev);
+            }
+        } else if (c == '\n' || c == '\r') {
+            if (input.empty()) {
+                return false;
+            }
+            long long parsed = parseDelayMs(input);
+            if (parsed < 0) {
+                invalid = true;
+                continue;
+            }
+            delayMs = parsed;
+            tuiScheduler->schedule(&chat, message, currentTimeMs() + parsed);
+            return true;
+        } else if (c == 127 || c == 8) {
+            if (!input.empty()) input.erase(input.length() - 1);
+            invalid = false;
+        } else if (c >= 32 && c <= 126 && input.length() < 16) {
+            input += c;
+            invalid = false;
+        }
+    }
+}
+
+// Fungsi untuk input pesan baru (kirim sekarang atau jadwalkan)
+void inputNewMessage(Conversation& chat) {
+    QueuePesan& queue = chat.queue;
+    ClickTracker buttonClicks;
+    bool shouldReturn = false;
+    string message = "";
+    bool messageSent = false;
+    long long scheduledDelayMs = -1; // >= 0 jika pesan dijadwalkan, bukan dikirim
+    RejectReason rejectReason = REJECT_NONE; // Alasan jika pesan ditolak spam filter
+    int selectedButton = 0; // 0 = Kirim, 1 = Jadwal, 2 = Kembali
+    int focusArea = 0; // 0 = text input, 1 = buttons
+    int cursorPos = 0; // Posisi cursor dalam text
+    int selectionStart = -1; // -1 berarti tidak ada seleksi
+    int selectionEnd = -1;
+    int lastCursorPos = 0; // Untuk deteksi Ctrl+Shift alternative
+    
+    // For mouse double-click word selection
+    ClickTracker textClicks; // Double-click pada posisi text yang sama
+    bool isMousePressed = false; // Track apakah mouse sedang ditekan
+    bool isWordSelectionMode = false; // Mode seleksi per kata dengan drag
+    int wordSelectionAnchorStart = -1; // Anchor point saat double-click
+    int wordSelectionAnchorEnd = -1;
+    
+    // For double-click Ctrl+Arrow detection
+    time_t lastCtrlArrowTime = 0;
+    char lastCtrlArrowDir = 0; // 'C' for right, 'D' for left
+    const int CTRL_ARROW_DOUBLE_CLICK_THRESHOLD = 500; // milliseconds
+    
+    while (!shouldReturn) {
+        clearScreen();
+        displayHeader();
+        
+        gotoxy(10, 5);
+        setColor(33);
+        printf("═══════════════════ TAMBAH PESAN BARU ═══════════════════");
+        resetColor();
+        
+        if (!messageSent) {
+            // Tampilkan area input dengan cursor (multi-line)
+            const int INPUT_WIDTH = 55; // Lebar area input tetap
+            const int INPUT_START_X = 10;
+            const int INPUT_START_Y = 7;
+            
+            gotoxy(INPUT_START_X, INPUT_START_Y);
+            printf("Masukkan pesan:");
+            
+            // Hitung jumlah baris yang diperlukan
+            int totalChars = message.length() + 1; // +1 untuk cursor
+            // Hitung baris berdasarkan width dan newline
+            int lastLine = 0;
+            int charCount = 0;
+            visualPosition(message, message.length(), INPUT_WIDTH, lastLine, charCount);
+            int numLines = lastLine + 1;
+            // Tambah 1 baris untuk cursor jika di akhir
+            if (charCount > 0 || message.empty()) {
+                // Sudah termasuk di numLines
+            }
+            
+            // Render multi-line text area
+            int currentLine = 0;
+            int currentCol = 0;
+            int charIndex = 0;
+            
+            for (int line = 0; line < numLines && line < 20; line++) { // Max 20 baris
+                gotoxy(INPUT_START_X, INPUT_START_Y + 1 + line);
+                
+                // Set background color
+                if (focusArea == 0) {
+                    setColor(47); setColor(30); // Highlight area input
+                } else {
+                    setColor(37);
+                }
+                
+                // Render karakter per baris
+                int renderedChars = 0;
+                bool lineBreak = false;
+                
+                while (renderedChars < INPUT_WIDTH && charIndex <= (int)message.length()) {
+                    // Render cursor SEBELUM karakter di posisi ini
+                    if (charIndex == cursorPos && focusArea == 0 && 
+                        (selectionStart == -1 || selectionEnd == -1 || selectionStart == selectionEnd)) {
+                        printf("│");
+                        renderedChars++;
+                        if (renderedChars >= INPUT_WIDTH) break;
+                    }
+                    
+                    // Cek apakah posisi ini terseleksi
+                    bool isSelected = false;
+                    if (selectionStart != -1 && selectionEnd != -1 && selectionStart != selectionEnd) {
+                        int selStart = selectionStart < selectionEnd ? selectionStart : selectionEnd;
+                        int selEnd = selectionStart < selectionEnd ? selectionEnd : selectionStart;
+                        if (charIndex >= selStart && charIndex < selEnd) {
+                            isSelected = true;
+                        }
+                    }
+                    
+                    // Set warna untuk seleksi
+                    if (isSelected) {
+                        resetColor();
+                        setColor(40); // Background hitam
+                        setColor(37); // Text putih
+                    }
+                    
+                    // Render karakter
+                    if (charIndex < (int)message.length()) {
+                        char ch = message[charIndex];
+                        if (ch == '\n') {
+                            // Newline - isi sisa baris dengan spasi lalu break
+                            while (renderedChars < INPUT_WIDTH) {
+                                printf(" ");
+                                renderedChars++;
+                            }
+                            charIndex++;
+                            lineBreak = true;
+                            break;
+                        } else {
+                            printf("%c", ch);
+                            renderedChars++;
+                            charIndex++;
+                        }
+                    } else {
+                        // Sudah di akhir message, padding dengan spasi
+                        printf(" ");
+                        renderedChars++;
+                        charIndex++;
+                    }
+                    
+                    // Kembalikan warna jika habis seleksi
+                    if (isSelected) {
+                        resetColor();
+                        if (focusArea == 0) {
+                            setColor(47); setColor(30);
+                        } else {
+                            setColor(37);
+                        }
+                    }
+                }
+                
+                // Padding sisa baris jika belum penuh
+                while (renderedChars < INPUT_WIDTH) {
+                    printf(" ");
+                    renderedChars++;
+                }
+                
+                resetColor();
+                
+                // Jika line break, lanjut ke baris berikutnya
+                if (lineBreak) continue;
+            }
+            regions.add(WIDGET_TEXT_INPUT, INPUT_START_X, INPUT_START_Y + 1, INPUT_WIDTH, numLines);
+            
+            // Update posisi tombol berdasarkan jumlah baris
+            int buttonY = INPUT_START_Y + 1 + numLines + 1;
+            
+            // Tombol Kirim, Jadwal dan Kembali (3 baris per tombol)
+            const char* buttonRows[3][3] = {
+                {"╔════════════════╗", "╔════════════════╗", "╔════════════════════╗"},
+                {"║  [✓ KIRIM]     ║", "║  [◷ JADWAL]    ║", "║  [← KEMBALI]       ║"},
+                {"╚════════════════╝", "╚════════════════╝", "╚════════════════════╝"}
+            };
+            for (int row = 0; row < 3; row++) {
+                gotoxy(10, buttonY + row);
+                for (int b = 0; b < 3; b++) {
+                    if (b > 0) {
+                        printf("  ");
+                    }
+                    if (focusArea == 1 && selectedButton == b) {
+                        setColor(47); setColor(30);
+                    }
+                    printf("%s", buttonRows[row][b]);
+                    resetColor();
+                }
+            }
+            regions.add(WIDGET_SEND, 10, buttonY, 19, 3);
+            regions.add(WIDGET_SCHEDULE, 30, buttonY, 19, 3);
+            regions.add(WIDGET_BACK, 50, buttonY, 23, 3);
+            
+            gotoxy(10, buttonY + 4);
+            setColor(36);
+            if (focusArea == 0) {
+                printf("←→ kursor | Ctrl+←→ loncat kata | Shift+←→ blok | Alt+←→ blok kata");
+            } else {
+                printf("Tombol: ←→ pilih | Enter/Klik 2x konfirmasi | ↑ ke text");
+            }
+            resetColor();
+            fflush(stdout);
+            
+            // Read input
+            char c;
+            if (readKey(&c) == 1) {
+                ScopedLatency decodeTimer(STAT_INPUT_DECODE);
+                if (c == '\033') { // ESC sequence
+                    char seq[10];
+                    memset(seq, 0, sizeof(seq));
+                    if (readInput(&seq[0]) == 1) {
+                        if (seq[0] == '[') {
+                            if (readInput(&seq[1]) == 1) {
+                                // Check for extended sequences (Shift, Ctrl+Shift)
+                                if (seq[1] == '1') {
+                                    if (readInput(&seq[2]) == 1) {
+                                        if (seq[2] == ';') {
+                                            if (readInput(&seq[3]) == 1) {
+                                                if (readInput(&seq[4]) == 1) {
+                                                    // Modifier values:
+                                                    // 2 = Shift
+                                                    // 3 = Alt
+                                                    // 4 = Shift+Alt
+                                                    // 5 = Ctrl
+                                                    // 6 = Ctrl+Shift
+                                                    // 7 = Ctrl+Alt
+                                                    // 8 = Ctrl+Shift+Alt
+                                                    bool isShift = (seq[3] == '2');
+                                                    bool isCtrl = (seq[3] == '5');
+                                                    bool isCtrlShift = (seq[3] == '6');
+                                                    bool isAlt = (seq[3] == '3');
+                                                    
+                                                    // Handle Alt+Arrow (word selection)
+                                                    if (focusArea == 0 && isAlt) {
+                                                        if (seq[4] == 'C') { // Alt+Right - extend selection word right
+                                                            if (selectionStart == -1) {
+                                                                // Mulai seleksi dari posisi saat ini
+                                                                selectionStart = cursorPos;
+                                                                selectionEnd = cursorPos;
+                                                            }
+                                                            
+                                                            // Extend dari ujung seleksi (yang lebih besar)
+                                                            int extendFrom = (selectionStart < selectionEnd) ? selectionEnd : selectionStart;
+                                                            cursorPos = extendFrom;
+                                                            
+                                                            // Skip spasi jika ada di posisi saat ini
+                                                            while (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
+                                                                cursorPos++;
+                                                            }
+                                                            
+                                                            // Blok 1 kata (sampai ketemu spasi atau akhir)
+                                                            while (cursorPos < (int)message.length() && message[cursorPos] != ' ') {
+                                                                cursorPos++;
+                                                            }
+                                                            
+                                                            // Update selectionEnd
+                                                            selectionEnd = cursorPos;
+                                                        } else if (seq[4] == 'D') { // Alt+Left - extend selection word left
+                                                            if (selectionStart == -1) {
+                                                                // Mulai seleksi dari posisi saat ini
+                                                                selectionStart = cursorPos;
+                                                                selectionEnd = cursorPos;
+                                                            }
+                                                            
+                                                            // Extend dari ujung seleksi (yang lebih kecil)
+                                                            int extendFrom = (selectionStart < selectionEnd) ? selectionStart : selectionEnd;
+                                                            cursorPos = extendFrom;
+                                                            
+                                                            if (cursorPos > 0) {
+                                                                cursorPos--;
+                                                                
+                                                                // Skip spasi jika ada di posisi saat ini
+                                                                while (cursorPos > 0 && message[cursorPos] == ' ') {
+                                                                    cursorPos--;
+                                                                }
+                                                                
+                                                                // Blok 1 kata ke kiri (sampai ketemu spasi atau awal)
+                                                                while (cursorPos > 0 && message[cursorPos - 1] != ' ') {
+                                                                    cursorPos--;
+                                                                }
+                                                            }
+                                                            
+                                                            // Update selectionStart (untuk extend ke kiri)
+                                                            selectionStart = cursorPos;
+                                                        }
+                                                    }
+                                                    
+                                                    // Handle Ctrl+Arrow (jump per word without selection)
+                                                    if (focusArea == 0 && isCtrl && !isCtrlShift && !isShift) {
+                                                        if (seq[4] == 'C') { // Ctrl+Right
+                                                            // Jump per kata ke kanan (tanpa seleksi)
+                                                            selectionStart = -1;
+                                                            selectionEnd = -1;
+                                                            
+                                                            if (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
+                                                                while (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
+                                                                    cursorPos++;
+                                                                }
+                                                            } else {
+                                                                while (cursorPos < (int)message.length() && message[cursorPos] != ' ') {
+                                                                    cursorPos++;
+                                                                }
+                                                            }
+                                                        } else if (seq[4] == 'D') { // Ctrl+Left
+                                                            // Jump per kata ke kiri (tanpa seleksi)
+                                                            selectionStart = -1;
+                                                            selectionEnd = -1;
+                                                            
+                                                            if (cursorPos > 0) {
+                                                                cursorPos--;
+                                                                if (message[cursorPos] == ' ') {
+                                                                    while (cursorPos > 0 && message[cursorPos] == ' ') {
+                                                                        cursorPos--;
+                                                                    }
+                                                                    if (cursorPos > 0 || message[0] != ' ') {
+                                                                        cursorPos++;
+                                                                    }
+                                                                } else {
+                                                                    while (cursorPos > 0 && message[cursorPos - 1] != ' ') {
+                                                                        cursorPos--;
+                                                                    }
+                                                                }
+                                                            }
+                                                        }
+                                                    }
+                                                    
+                                                    if (focusArea == 0 && (isShift || isCtrlShift)) {
+                                                        if (seq[4] == 'C') { // Shift+Right atau Ctrl+Shift+Right
+                                                            if (selectionStart == -1) {
+                                                                selectionStart = cursorPos;
+                                                            }
+                                                            
+                                                            if (isCtrlShift) {
+                                                                // Blok per kata ke kanan
+                                                                // Jika di spasi, skip spasi sampai ketemu huruf
+                                                                if (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
+                                                                    while (cursorPos < (int)message.length() && message[cursorPos] == ' ') {
+                                                                        cursorPos++;
+                                                                    }
+                                                                } else {
+                                                                    // Jika di huruf, maju sampai ketemu spasi atau akhir
+                                                                    while (cursorPos < (int)message.length() && message[cursorPos] != ' ') {
+                                                                        cursorPos++;
+                                                                    }
+                                                                }
+                                                            } else {
+                                                                // Geser 1 karakter
+                                                                if (cursorPos < (int)message.length()) cursorPos++;
+                                                            }
+                                                            selectionEnd = cursorPos;
+                                                        } else if (seq[4] == 'D') { // Shift+Left atau Ctrl+Shift+Left
+                                                            if (selectionStart == -1) {
+                                                                selectionStart = cursorPos;
+                                                            }
+                                                            
+                                                            if (isCtrlShift) {
+                                                                // Blok per kata ke kiri
+                                                                // Mundur satu langkah dulu
+                                                                if (cursorPos > 0) {
+                                                                    cursorPos--;
+                                                                    
+                                                                    // Jika di spasi, skip spasi sampai ketemu huruf
+                                                                    if (message[cursorPos] == ' ') {
+                                                                        while (cursorPos > 0 && message[cursorPos] == ' ') {
+                                                                            cursorPos--;
+                                                                        }
+                                                                        // Posisikan di akhir kata sebelumnya
+                                                                        if (cursorPos > 0 || message[0] != ' ') {
+                                                                            cursorPos++;
+                                                                        }
+                                                                    } else {
+                                                                        // Jika di huruf, mundur sampai ketemu spasi atau awal
+                                                                        while (cursorPos > 0 && message[cursorPos - 1] != ' ') {
+                                                                            cursorPos--;
+                                                                        }
+                                                                    }
+                                                                }
+                                                            } else {
+                                                                // Geser 1 karakter
+                                                                if (cursorPos > 0) cursorPos--;
+                                                            }
+                                                            selectionEnd = cursorPos;
+                                                        } else if (seq[4] == 'A') { // Shift+Up
+                                                            if (selectionStart == -1) {
+                                                                selectionStart = cursorPos;
+                                                            }
+                                                            // Geser ke atas 1 baris (55 karakter)
+                                                            const int INPUT_WIDTH = 55;
+                                                            if (cursorPos >= INPUT_WIDTH) {
+                                                                cursorPos -= INPUT_WIDTH;
+                                                            } else {
+                                                                cursorPos = 0; // Ke awal text
+                                                            }
+                                                            selectionEnd = cursorPos;
+                                                        } else if (seq[4] == 'B') { // Shift+Down
+                                                            if (selectionStart == -1) {
+                                                                selectionStart = cursorPos;
+                                                            }
+                                                            // Geser ke bawah 1 baris (55 karakter)
+                                                            const int INPUT_WIDTH = 55;
+                                                            if (cursorPos + INPUT_WIDTH <= (int)message.length()) {
+                                                                cursorPos += INPUT_WIDTH;
+                                                            } else {
+                                                                cursorPos = message.length(); // Ke akhir text
+                                                            }
+                                                            selectionEnd = cursorPos;
+                                                        }
+                                                    }
+                                                }
+                                            }
+                                        }
+                                    }
+                                } else if (seq[1] == 'A') { // Up arrow
+                                    if (focusArea == 1) {
+                                        focusArea = 0; // Kembali ke text input
+                                    } else if (focusArea == 0) {
+                                        // Navigasi ke atas 1 baris dalam text
+                                        const int INPUT_WIDTH = 55;
+                                        
+                                        // Hitung posisi baris saat ini berdasarkan newline
+                                        int currentLine = 0;
+                                        int charCount = 0;
+                                        visualPosition(message, min(cursorPos, (int)message.length()), INPUT_WIDTH, currentLine, charCount);
+                                        
+                                        if (currentLine > 0) {
+                                            // Ada baris di atas, naik
+                                            int targetLine = currentLine - 1;
+                                            int newPos = 0;
+                                            int line = 0;
                                             charCount = 0;
                                             
                                             for (int i = 0; i <= (int)message.length(); i++) {
@@ -975,36 +6830,14 @@ void inputNewMessage(QueuePesan& queue) {
                                 } else if (seq[1] == 'B') { // Down arrow
                                     if (focusArea == 0) {
                                         // Hitung total baris dalam message
-                                        int totalLines = 1; // Minimal 1 baris
+                                        int lastLine = 0;
                                         int charCount = 0;
-                                        for (int i = 0; i < (int)message.length(); i++) {
-                                            if (message[i] == '\n') {
-                                                totalLines++;
-                                                charCount = 0;
-                                            } else {
-                                                charCount++;
-                                                if (charCount >= INPUT_WIDTH) {
-                                                    totalLines++;
-                                                    charCount = 0;
-                                                }
-                                            }
-                                        }
+                                        visualPosition(message, message.length(), INPUT_WIDTH, lastLine, charCount);
+                                        int totalLines = lastLine + 1; // Minimal 1 baris
                                         
                                         // Hitung baris saat ini
                                         int currentLine = 0;
-                                        charCount = 0;
-                                        for (int i = 0; i < cursorPos && i < (int)message.length(); i++) {
-                                            if (message[i] == '\n') {
-                                                currentLine++;
-                                                charCount = 0;
-                                            } else {
-                                                charCount++;
-                                                if (charCount >= INPUT_WIDTH) {
-                                                    currentLine++;
-                                                    charCount = 0;
-                                                }
-                                            }
-                                        }
+                                        visualPosition(message, min(cursorPos, (int)message.length()), INPUT_WIDTH, currentLine, charCount);
                                         
                                         // Cek apakah cursor di posisi setelah baris terakhir text
                                         bool atLastLine = (currentLine >= totalLines - 1);
@@ -1056,7 +6889,7 @@ void inputNewMessage(QueuePesan& queue) {
                                         if (cursorPos < (int)message.length()) cursorPos++;
                                     } else {
                                         // Di area button
-                                        selectedButton = (selectedButton + 1) % 2;
+                                        selectedButton = (selectedButton + 1) % 3;
                                     }
                                 } else if (seq[1] == 'D') { // Left arrow (tanpa modifier)
                                     if (focusArea == 0) {
@@ -1067,43 +6900,22 @@ void inputNewMessage(QueuePesan& queue) {
                                         if (cursorPos > 0) cursorPos--;
                                     } else {
                                         // Di area button
-                                        selectedButton = (selectedButton - 1 + 2) % 2;
+                                        selectedButton = (selectedButton - 1 + 3) % 3;
                                     }
                                 } else if (seq[1] == '<') { // Mouse input
-                                    char mouseData[20];
-                                    int idx = 0;
-                                    char eventType;
-                                    
-                                    // Read button number
-                                    int buttonNum = 0;
-                                    char ch;
-                                    while (read(STDIN_FILENO, &ch, 1) == 1 && ch != ';') {
-                                        if (ch >= '0' && ch <= '9') {
-                                            buttonNum = buttonNum * 10 + (ch - '0');
-                                        }
-                                    }
-                                    
-                                    // Read rest of mouse data
-                                    idx = 0;
-                                    while (read(STDIN_FILENO, &mouseData[idx], 1) == 1 && mouseData[idx] != 'M' && mouseData[idx] != 'm') {
-                                        idx++;
+                                    MouseEvent ev;
+                                    if (!readMouseEvent(ev)) {
+                                        continue;
                                     }
-                                    eventType = mouseData[idx];
-                                    
-                                    int mouseY = 0, mouseX = 0;
-                                    sscanf(mouseData, "%d;%d", &mouseX, &mouseY);
-                                    
-                                    struct timespec ts;
-                                    clock_gettime(CLOCK_MONOTONIC, &ts);
-                                    time_t currentTime = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+                                    int widget = regions.hitTest(ev.x, ev.y);
                                     
                                     // Check if in text area
-                                    if (mouseY >= INPUT_START_Y + 1 && mouseY < INPUT_START_Y + 1 + numLines && 
-                                        mouseX >= INPUT_START_X && mouseX < INPUT_START_X + INPUT_WIDTH && focusArea == 0) {
+                                    if (widget == WIDGET_TEXT_INPUT && focusArea == 0) {
                                         
                                         // Calculate clicked position in text
-                                        int lineClicked = mouseY - (INPUT_START_Y + 1);
-                                        int colClicked = mouseX - INPUT_START_X;
+                                        const Region& area = regions.get(WIDGET_TEXT_INPUT);
+                                        int lineClicked = ev.y - area.y;
+                                        int colClicked = ev.x - area.x;
                                         
                                         // Find actual character position considering newlines
                                         int clickedPos = 0;
@@ -1133,12 +6945,11 @@ void inputNewMessage(QueuePesan& queue) {
                                             }
                                         }
                                         
-                                        if (eventType == 'M' && buttonNum == 0) { // Mouse button press
+                                        if (ev.pressed && ev.button == 0) { // Mouse button press
                                             isMousePressed = true;
                                             
                                             // Double-click detection for word selection
-                                            if (lastMouseClickPos == clickedPos && 
-                                                (currentTime - lastMouseClickTime) < MOUSE_DOUBLE_CLICK_THRESHOLD) {
+                                            if (textClicks.click(clickedPos)) {
                                                 // Double click - select word at cursor
                                                 isWordSelectionMode = true;
                                                 
@@ -1161,8 +6972,7 @@ void inputNewMessage(QueuePesan& queue) {
                                                 wordSelectionAnchorStart = wordStart;
                                                 wordSelectionAnchorEnd = wordEnd;
                                                 cursorPos = wordEnd;
-                                                
-                                                lastMouseClickPos = -1; // Reset untuk prevent triple-click
+
                                             } else {
                                                 // Single click - move cursor
                                                 isWordSelectionMode = false;
@@ -1171,14 +6981,12 @@ void inputNewMessage(QueuePesan& queue) {
                                                 cursorPos = clickedPos;
                                                 selectionStart = -1;
                                                 selectionEnd = -1;
-                                                
-                                                lastMouseClickPos = clickedPos;
-                                                lastMouseClickTime = currentTime;
+
                                             }
-                                        } else if (eventType == 'm' && buttonNum == 0) { // Mouse release
+                                        } else if (!ev.pressed && ev.button == 0) { // Mouse release
                                             isMousePressed = false;
                                             isWordSelectionMode = false; // Exit word selection mode
-                                        } else if (eventType == 'M' && buttonNum == 32) { // Mouse drag (button held)
+                                        } else if (ev.pressed && ev.button == 32) { // Mouse drag (button held)
                                             // Handle mouse drag for word selection mode
                                             if (isMousePressed && isWordSelectionMode && wordSelectionAnchorStart != -1) {
                                                 // Extend selection word by word based on drag position
@@ -1211,41 +7019,39 @@ void inputNewMessage(QueuePesan& queue) {
                                             }
                                         }
                                     }
-                                    // Check if clicked on button area
-                                    else if (eventType == 'M' && buttonNum == 0 && mouseY >= buttonY && mouseY <= buttonY + 2) {
-                                        const int DOUBLE_CLICK_THRESHOLD = 500;
-                                        
-                                        // Check if clicked on Kirim button
-                                        if (mouseX >= 10 && mouseX <= 28) {
-                                            if (lastClickedButton == 1 && 
-                                                (currentTime - lastClickTime) < DOUBLE_CLICK_THRESHOLD) {
-                                                // Send message
-                                                if (!message.empty() && !isEmptyOrWhitespace(message)) {
-                                                    bool success = queue.enqueue(message);
-                                                    messageSent = true;
-                                                    lastClickedButton = -1;
-                                                    if (!success) {
-                                                        message = "SPAM_ERROR";
-                                                    }
-                                                } else if (!message.empty() && isEmptyOrWhitespace(message)) {
-                                                    message = "EMPTY_ERROR";
-                                                    messageSent = true;
-                                                    lastClickedButton = -1;
+                                    // Check if clicked on Kirim button
+                                    else if (ev.pressed && ev.button == 0 && widget == WIDGET_SEND) {
+                                        if (buttonClicks.click(WIDGET_SEND)) {
+                                            // Send message
+                                            if (!message.empty() && !isEmptyOrWhitespace(message)) {
+                                                bool success = queue.enqueue(message);
+                                                messageSent = true;
+                                                if (!success) {
+                                                    message = "SPAM_ERROR";
+                                                    rejectReason = queue.getLastReject();
                                                 }
-                                            } else {
-                                                lastClickedButton = 1;
-                                                lastClickTime = currentTime;
+                                            } else if (!message.empty() && isEmptyOrWhitespace(message)) {
+                                                message = "EMPTY_ERROR";
+                                                messageSent = true;
+                                            }
+                                        }
+                                    }
+                                    // Check if clicked on Jadwal button
+                                    else if (ev.pressed && ev.button == 0 && widget == WIDGET_SCHEDULE) {
+                                        if (buttonClicks.click(WIDGET_SCHEDULE)) {
+                                            if (!message.empty() && !isEmptyOrWhitespace(message)) {
+                                                messageSent = scheduleMessage(chat, message, buttonY + 6, scheduledDelayMs);
+                                                buttonClicks = ClickTracker();
+                                            } else if (!message.empty() && isEmptyOrWhitespace(message)) {
+                                                message = "EMPTY_ERROR";
+                                                messageSent = true;
                                             }
                                         }
-                                        // Check if clicked on Kembali button
-                                        else if (mouseX >= 30 && mouseX <= 52) {
-                                            if (lastClickedButton == 2 && 
-                                                (currentTime - lastClickTime) < DOUBLE_CLICK_THRESHOLD) {
-                                                shouldReturn = true;
-                                            } else {
-                                                lastClickedButton = 2;
-                                                lastClickTime = currentTime;
-                                            }
+                                    }
+                                    // Check if clicked on Kembali button
+                                    else if (ev.pressed && ev.button == 0 && widget == WIDGET_BACK) {
+                                        if (buttonClicks.click(WIDGET_BACK)) {
+                                            shouldReturn = true;
                                         }
                                     }
                                 }
@@ -1260,14 +7066,25 @@ void inputNewMessage(QueuePesan& queue) {
                             if (!message.empty() && !isEmptyOrWhitespace(message)) {
                                 bool success = queue.enqueue(message);
                                 messageSent = true;
-                                lastClickedButton = -1;
+                                buttonClicks = ClickTracker();
                                 if (!success) {
                                     message = "SPAM_ERROR";
+                                    rejectReason = queue.getLastReject();
                                 }
                             } else if (!message.empty() && isEmptyOrWhitespace(message)) {
                                 message = "EMPTY_ERROR";
                                 messageSent = true;
-                                lastClickedButton = -1;
+                                buttonClicks = ClickTracker();
+                            }
+                        } else if (selectedButton == 1) {
+                            // Jadwal
+                            if (!message.empty() && !isEmptyOrWhitespace(message)) {
+                                messageSent = scheduleMessage(chat, message, buttonY + 6, scheduledDelayMs);
+                                buttonClicks = ClickTracker();
+                            } else if (!message.empty() && isEmptyOrWhitespace(message)) {
+                                message = "EMPTY_ERROR";
+                                messageSent = true;
+                                buttonClicks = ClickTracker();
                             }
                         } else {
                             // Kembali
@@ -1349,7 +7166,12 @@ void inputNewMessage(QueuePesan& queue) {
             if (message == "SPAM_ERROR") {
                 gotoxy(10, 7);
                 setColor(31);
-                printf("✗ Jangan spam! Pesan sama dengan pesan terakhir.");
+                printf("%s", rejectMessage(rejectReason));
+                if (rejectReason == REJECT_BLOCKED) {
+                    printf(" (\"%s\")", queue.getLastBlockedPhrase().c_str());
+                } else if (rejectReason == REJECT_RATE_LIMITED) {
+                    printf(" Coba lagi dalam %lld detik.", (queue.getLastRetryAfterMs() + 999) / 1000);
+                }
                 resetColor();
             } else if (message == "EMPTY_ERROR") {
                 gotoxy(10, 7);
@@ -1361,43 +7183,61 @@ void inputNewMessage(QueuePesan& queue) {
                 int startPos = 0;
                 bool firstLine = true;
                 int displayY = 7;
+                string prefix = "√ Pesan berhasil dikirim: ";
+                if (scheduledDelayMs >= 0) {
+                    prefix = "◷ Pesan dijadwalkan (dalam " + formatDelay(scheduledDelayMs) + "): ";
+                }
+                int prefixWidth = 0; // Lebar kolom: hitung byte yang bukan lanjutan UTF-8
+                for (unsigned char b : prefix) {
+                    if ((b & 0xC0) != 0x80) prefixWidth++;
+                }
                 
-                for (int i = 0; i <= (int)message.length(); i++) {
-                    if (i == (int)message.length() || message[i] == '\n') {
-                        gotoxy(10, displayY);
-                        
-                        if (firstLine) {
-                            setColor(32);
-                            printf("√ Pesan berhasil dikirim: ");
-                        } else {
-                            printf("                          "); // Sesuai panjang string di atas
-                        }
-                        
-                        // Print substring
-                        string line = message.substr(startPos, i - startPos);
+                while (startPos <= (int)message.length()) {
+                    int i = findNewline(message, startPos);
+                    gotoxy(10, displayY);
+                    
+                    if (firstLine) {
                         setColor(32);
-                        printf("%s", line.c_str());
-                        resetColor();
-                        
-                        displayY++;
-                        startPos = i + 1;
-                        firstLine = false;
+                        printf("%s", prefix.c_str());
+                    } else {
+                        printf("%*s", prefixWidth, ""); // Sesuai lebar prefix di atas
                     }
+                    
+                    // Print substring
+                    string line = message.substr(startPos, i - startPos);
+                    setColor(32);
+                    printf("%s", line.c_str());
+                    resetColor();
+                    
+                    displayY++;
+                    startPos = i + 1;
+                    firstLine = false;
                 }
             }
             
-            shouldReturn = displayBackButton(9, lastClickedButton, lastClickTime);
+            shouldReturn = displayBackButton(9, buttonClicks);
         }
     }
 }
 
-// Fungsi untuk hapus pesan pertama
-void deleteFirstMessage(QueuePesan& queue) {
-    int lastClickedButton = -1;
-    time_t lastClickTime = 0;
+// Fungsi untuk hapus pesan dari depan (fromFront) atau batalkan dari belakang.
+// Satu pesan langsung dihapus saat layar dibuka; setelah itu jumlah pesan
+// berikutnya bisa diketik untuk dihapus sekaligus dalam satu operasi
+void removeMessagesScreen(QueuePesan& queue, bool fromFront) {
+    ClickTracker buttonClicks;
     bool shouldReturn = false;
-    bool alreadyDeleted = false;
-    bool deleteSuccess = false;
+    string countText = "";
+    const char* title = fromFront ? "═══════════════════ HAPUS PESAN BERIKUTNYA ═══════════════════"
+                                  : "═══════════════════ BATALKAN PESAN TERAKHIR ═══════════════════";
+    const char* what = fromFront ? "berhasil dihapus" : "terakhir berhasil dibatalkan";
+    
+    // Hapus satu pesan saat layar dibuka. Dari depan, yang dihapus adalah
+    // pesan berikutnya sesuai giliran lane prioritas, jadi ID-nya ditampilkan
+    Node* next = queue.peekNext();
+    long long removedId = next != nullptr ? next->data.id : 0;
+    int removedLane = next != nullptr ? next->data.priority : PRIORITY_NORMAL;
+    int removed = (fromFront ? queue.dequeue() : queue.cancelLast()) ? 1 : 0;
+    long long elapsedNs = -1; // Durasi hapus massal terakhir (-1 = belum ada)
     
     while (!shouldReturn) {
         clearScreen();
@@ -1405,70 +7245,107 @@ void deleteFirstMessage(QueuePesan& queue) {
         
         gotoxy(10, 5);
         setColor(33);
-        printf("═══════════════════ HAPUS PESAN PERTAMA ═══════════════════");
+        printf("%s", title);
         resetColor();
         
-        // Hapus pesan hanya sekali
-        if (!alreadyDeleted) {
-            deleteSuccess = queue.dequeue();
-            alreadyDeleted = true;
-        }
-        
         gotoxy(10, 7);
-        if (deleteSuccess) {
+        if (removed > 0 && elapsedNs < 0 && fromFront) {
+            setColor(32);
+            printf("✓ Pesan #%lld (%s) %s!", removedId, PRIORITY_NAMES[removedLane], what);
+        } else if (removed > 0 && elapsedNs < 0) {
             setColor(32);
-            printf("✓ Pesan pertama berhasil dihapus!");
+            printf("✓ Pesan %s!", what);
+        } else if (removed > 0) {
+            setColor(32);
+            printf("✓ %d pesan %s! (%s)", removed, what, formatDuration(elapsedNs).c_str());
         } else {
             setColor(31);
-            printf("✗ Tidak ada pesan untuk dihapus!");
+            printf(fromFront ? "✗ Tidak ada pesan untuk dihapus!" : "✗ Tidak ada pesan untuk dibatalkan!");
         }
         resetColor();
         
-        shouldReturn = displayBackButton(9, lastClickedButton, lastClickTime);
-    }
-}
-
-// Fungsi untuk batalkan pesan terakhir
-void cancelLastMessage(QueuePesan& queue) {
-    int lastClickedButton = -1;
-    time_t lastClickTime = 0;
-    bool shouldReturn = false;
-    bool alreadyCancelled = false;
-    bool cancelSuccess = false;
-    
-    while (!shouldReturn) {
-        clearScreen();
-        displayHeader();
-        
-        gotoxy(10, 5);
-        setColor(33);
-        printf("═══════════════════ BATALKAN PESAN TERAKHIR ═══════════════════");
-        resetColor();
-        
-        // Batalkan pesan hanya sekali
-        if (!alreadyCancelled) {
-            cancelSuccess = queue.cancelLast();
-            alreadyCancelled = true;
+        int y = 9;
+        if (!queue.isEmpty()) {
+            gotoxy(10, y);
+            setColor(36);
+            printf("Sisa pesan: %d", queue.getSize());
+            gotoxy(10, y + 1);
+            printf("Hapus lagi: ");
+            resetColor();
+            setColor(47); setColor(30);
+            printf("%s│", countText.c_str());
+            resetColor();
+            setColor(37);
+            printf("  (jumlah atau 'a' = semua)");
+            resetColor();
+            y += 3;
         }
         
-        gotoxy(10, 7);
-        if (cancelSuccess) {
-            setColor(32);
-            printf("✓ Pesan terakhir berhasil dibatalkan!");
+        drawBackButton(y);
+        gotoxy(10, y + 4);
+        setColor(36);
+        if (queue.isEmpty()) {
+            printf("Enter/Klik 2x untuk kembali");
+        } else if (countText.empty()) {
+            printf("Ketik jumlah lalu Enter | Enter/Klik 2x untuk kembali");
         } else {
-            setColor(31);
-            printf("✗ Tidak ada pesan untuk dibatalkan!");
+            printf("Enter untuk hapus | Backspace hapus angka");
         }
         resetColor();
+        fflush(stdout);
         
-        shouldReturn = displayBackButton(9, lastClickedButton, lastClickTime);
+        // Read input
+        char c;
+        if (readKey(&c) == 1) {
+            ScopedLatency decodeTimer(STAT_INPUT_DECODE);
+            if (c == '\033') { // ESC sequence
+                char seq[2];
+                if (readInput(&seq[0]) == 1 && seq[0] == '[' && readInput(&seq[1]) == 1 && seq[1] == '<') {
+                    MouseEvent ev;
+                    if (readMouseEvent(ev) && ev.pressed && ev.button == 0) {
+                        if (regions.hitTest(ev.x, ev.y) == WIDGET_BACK && buttonClicks.click(WIDGET_BACK)) {
+                            shouldReturn = true; // Double click - kembali
+                        }
+                    }
+                }
+            } else if (c == '\n' || c == '\r') { // Enter key
+                if (countText.empty()) {
+                    shouldReturn = true;
+                } else {
+                    int count = (countText == "a") ? queue.getSize() : atoi(countText.c_str());
+                    long long t0 = currentTimeNs();
+                    removed = fromFront ? queue.dequeue(count) : queue.cancelLast(count);
+                    elapsedNs = currentTimeNs() - t0;
+                    countText = "";
+                }
+            } else if (c == 127 || c == 8) { // Backspace
+                if (!countText.empty()) {
+                    countText.erase(countText.length() - 1);
+                }
+            } else if (queue.isEmpty()) {
+                // Tidak ada lagi yang bisa dihapus
+            } else if (c == 'a' || c == 'A') {
+                countText = "a";
+            } else if (c >= '0' && c <= '9' && countText != "a" && countText.length() < 9) {
+                countText += c;
+            }
+        }
     }
 }
 
+// Fungsi untuk hapus pesan berikutnya
+void deleteFirstMessage(QueuePesan& queue) {
+    removeMessagesScreen(queue, true);
+}
+
+// Fungsi untuk batalkan pesan terakhir
+void cancelLastMessage(QueuePesan& queue) {
+    removeMessagesScreen(queue, false);
+}
+
 // Fungsi untuk tandai pesan sebagai dibaca
 void markMessageAsRead(QueuePesan& queue) {
-    int lastClickedButton = -1;
-    time_t lastClickTime = 0;
+    ClickTracker buttonClicks;
     bool shouldReturn = false;
     string input = "";
     bool marked = false;
@@ -1480,13 +7357,11 @@ void markMessageAsRead(QueuePesan& queue) {
     int markedCount = 0; // Jumlah pesan yang ditandai
     
     // For mouse double-click word selection
-    time_t lastMouseClickTime = 0;
-    int lastMouseClickPos = -1;
+    ClickTracker textClicks;
     bool isMousePressed = false;
     bool isWordSelectionMode = false;
     int wordSelectionAnchorStart = -1;
     int wordSelectionAnchorEnd = -1;
-    const int MOUSE_DOUBLE_CLICK_THRESHOLD = 500;
     
     while (!shouldReturn) {
         clearScreen();
@@ -1503,7 +7378,7 @@ void markMessageAsRead(QueuePesan& queue) {
             printf("Tidak ada pesan.");
             resetColor();
             
-            shouldReturn = displayBackButton(9, lastClickedButton, lastClickTime);
+            shouldReturn = displayBackButton(9, buttonClicks);
         } else if (!marked) {
             // Tampilkan daftar pesan
             int y = 7;
@@ -1525,42 +7400,41 @@ void markMessageAsRead(QueuePesan& queue) {
                 int startPos = 0;
                 bool firstLine = true;
                 
-                for (int i = 0; i <= (int)pesan.length(); i++) {
-                    if (i == (int)pesan.length() || pesan[i] == '\n') {
-                        gotoxy(10, y);
-                        
-                        if (firstLine) {
-                            // Baris pertama dengan indikator
-                            if (isRead) {
-                                setColor(37); // Abu-abu (sudah dibaca)
-                                printf("[√] %d. ", index + 1);
-                            } else {
-                                setColor(32); // Hijau (belum dibaca)
-                                printf("[-] %d. ", index + 1);
-                            }
-                        } else {
-                            // Baris selanjutnya dengan indentasi  
-                            char indent[50];
-                            snprintf(indent, sizeof(indent), "[%c] %d. ", ' ', index + 1);
-                            for (int j = 0; j < (int)strlen(indent); j++) {
-                                printf(" ");
-                            }
-                        }
-                        
-                        // Print substring
-                        string line = pesan.substr(startPos, i - startPos);
+                while (startPos <= (int)pesan.length()) {
+                    int i = findNewline(pesan, startPos);
+                    gotoxy(10, y);
+                    
+                    if (firstLine) {
+                        // Baris pertama dengan indikator
                         if (isRead) {
-                            setColor(37);
+                            setColor(37); // Abu-abu (sudah dibaca)
+                            printf("[√] #%lld ", current->data.id);
                         } else {
-                            setColor(32);
+                            setColor(32); // Hijau (belum dibaca)
+                            printf("[-] #%lld ", current->data.id);
                         }
-                        printf("%s", line.c_str());
-                        resetColor();
-                        
-                        y++;
-                        startPos = i + 1;
-                        firstLine = false;
+                    } else {
+                        // Baris selanjutnya dengan indentasi  
+                        char indent[50];
+                        snprintf(indent, sizeof(indent), "[%c] #%lld ", ' ', current->data.id);
+                        for (int j = 0; j < (int)strlen(indent); j++) {
+                            printf(" ");
+                        }
+                    }
+                    
+                    // Print substring
+                    string line = pesan.substr(startPos, i - startPos);
+                    if (isRead) {
+                        setColor(37);
+                    } else {
+                        setColor(32);
                     }
+                    printf("%s", line.c_str());
+                    resetColor();
+                    
+                    y++;
+                    startPos = i + 1;
+                    firstLine = false;
                 }
                 
                 current = current->next;
@@ -1583,7 +7457,7 @@ void markMessageAsRead(QueuePesan& queue) {
             const int INPUT_START_Y = y;
             
             gotoxy(INPUT_START_X, INPUT_START_Y);
-            printf("Masukkan (1-%d / 1,3 / 1-3 / all): ", queue.getSize());
+            printf("Masukkan ID (%lld-%lld / 12,15 / all): ", queue.getFirstId(), queue.getLastId());
             
             // Render input area dengan cursor
             gotoxy(INPUT_START_X, INPUT_START_Y + 1);
@@ -1639,6 +7513,7 @@ void markMessageAsRead(QueuePesan& queue) {
                 }
             }
             resetColor();
+            regions.add(WIDGET_TEXT_INPUT, INPUT_START_X, INPUT_START_Y + 1, INPUT_WIDTH, 1);
             
             y += 3;
             
@@ -1682,6 +7557,8 @@ void markMessageAsRead(QueuePesan& queue) {
             }
             printf("╚════════════════════╝");
             resetColor();
+            regions.add(WIDGET_MARK, 10, buttonY, 19, 3);
+            regions.add(WIDGET_BACK, 30, buttonY, 23, 3);
             
             gotoxy(10, buttonY + 4);
             setColor(36);
@@ -1695,19 +7572,20 @@ void markMessageAsRead(QueuePesan& queue) {
             
             // Read input
             char c;
-            if (read(STDIN_FILENO, &c, 1) == 1) {
+            if (readKey(&c) == 1) {
+                ScopedLatency decodeTimer(STAT_INPUT_DECODE);
                 if (c == '\033') { // ESC sequence
                     char seq[10];
                     memset(seq, 0, sizeof(seq));
-                    if (read(STDIN_FILENO, &seq[0], 1) == 1) {
+                    if (readInput(&seq[0]) == 1) {
                         if (seq[0] == '[') {
-                            if (read(STDIN_FILENO, &seq[1], 1) == 1) {
+                            if (readInput(&seq[1]) == 1) {
                                 // Check for extended sequences (Shift, Ctrl+Shift, Alt)
                                 if (seq[1] == '1') {
-                                    if (read(STDIN_FILENO, &seq[2], 1) == 1) {
+                                    if (readInput(&seq[2]) == 1) {
                                         if (seq[2] == ';') {
-                                            if (read(STDIN_FILENO, &seq[3], 1) == 1) {
-                                                if (read(STDIN_FILENO, &seq[4], 1) == 1) {
+                                            if (readInput(&seq[3]) == 1) {
+                                                if (readInput(&seq[4]) == 1) {
                                                     bool isShift = (seq[3] == '2');
                                                     bool isCtrl = (seq[3] == '5');
                                                     bool isCtrlShift = (seq[3] == '6');
@@ -1828,50 +7706,23 @@ void markMessageAsRead(QueuePesan& queue) {
                                         selectedButton = (selectedButton - 1 + 2) % 2;
                                     }
                                 } else if (seq[1] == '<') { // Mouse input
-                                    char mouseData[20];
-                                    int idx = 0;
-                                    char eventType;
-                                    
-                                    // Read button number
-                                    int buttonNum = 0;
-                                    char ch;
-                                    while (read(STDIN_FILENO, &ch, 1) == 1 && ch != ';') {
-                                        if (ch >= '0' && ch <= '9') {
-                                            buttonNum = buttonNum * 10 + (ch - '0');
-                                        }
-                                    }
-                                    
-                                    // Read rest of mouse data
-                                    idx = 0;
-                                    while (read(STDIN_FILENO, &mouseData[idx], 1) == 1 && mouseData[idx] != 'M' && mouseData[idx] != 'm') {
-                                        idx++;
+                                    MouseEvent ev;
+                                    if (!readMouseEvent(ev)) {
+                                        continue;
                                     }
-                                    eventType = mouseData[idx];
-                                    
-                                    int mouseY = 0, mouseX = 0;
-                                    sscanf(mouseData, "%d;%d", &mouseX, &mouseY);
-                                    
-                                    struct timespec ts;
-                                    clock_gettime(CLOCK_MONOTONIC, &ts);
-                                    time_t currentTime = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-                                    
-                                    const int INPUT_START_X = 10;
-                                    const int INPUT_START_Y = y - 3;
-                                    const int INPUT_WIDTH = 30;
+                                    int widget = regions.hitTest(ev.x, ev.y);
                                     
                                     // Check if in text area
-                                    if (mouseY == INPUT_START_Y + 1 && 
-                                        mouseX >= INPUT_START_X && mouseX < INPUT_START_X + INPUT_WIDTH && focusArea == 0) {
+                                    if (widget == WIDGET_TEXT_INPUT && focusArea == 0) {
                                         
-                                        int clickedPos = mouseX - INPUT_START_X;
+                                        int clickedPos = ev.x - regions.get(WIDGET_TEXT_INPUT).x;
                                         if (clickedPos > (int)input.length()) clickedPos = input.length();
                                         
-                                        if (eventType == 'M' && buttonNum == 0) { // Mouse button press
+                                        if (ev.pressed && ev.button == 0) { // Mouse button press
                                             isMousePressed = true;
                                             
                                             // Double-click detection for word selection
-                                            if (lastMouseClickPos == clickedPos && 
-                                                (currentTime - lastMouseClickTime) < MOUSE_DOUBLE_CLICK_THRESHOLD) {
+                                            if (textClicks.click(clickedPos)) {
                                                 // Double click - select word at cursor
                                                 isWordSelectionMode = true;
                                                 
@@ -1894,8 +7745,7 @@ void markMessageAsRead(QueuePesan& queue) {
                                                 wordSelectionAnchorStart = wordStart;
                                                 wordSelectionAnchorEnd = wordEnd;
                                                 cursorPos = wordEnd;
-                                                
-                                                lastMouseClickPos = -1; // Reset untuk prevent triple-click
+
                                             } else {
                                                 // Single click - move cursor
                                                 isWordSelectionMode = false;
@@ -1904,14 +7754,12 @@ void markMessageAsRead(QueuePesan& queue) {
                                                 cursorPos = clickedPos;
                                                 selectionStart = -1;
                                                 selectionEnd = -1;
-                                                
-                                                lastMouseClickPos = clickedPos;
-                                                lastMouseClickTime = currentTime;
+
                                             }
-                                        } else if (eventType == 'm' && buttonNum == 0) { // Mouse release
+                                        } else if (!ev.pressed && ev.button == 0) { // Mouse release
                                             isMousePressed = false;
                                             isWordSelectionMode = false;
-                                        } else if (eventType == 'M' && buttonNum == 32) { // Mouse drag
+                                        } else if (ev.pressed && ev.button == 32) { // Mouse drag
                                             if (isMousePressed && isWordSelectionMode && wordSelectionAnchorStart != -1) {
                                                 // Extend selection word by word based on drag position
                                                 if (clickedPos >= wordSelectionAnchorEnd) {
@@ -1941,139 +7789,2352 @@ void markMessageAsRead(QueuePesan& queue) {
                                             }
                                         }
                                     }
-                                    // Check if clicked on button area
-                                    else if (eventType == 'M' && buttonNum == 0 && mouseY >= buttonY && mouseY <= buttonY + 2) {
-                                        const int DOUBLE_CLICK_THRESHOLD = 500;
-                                        
-                                        // Check if clicked on Tandai button
-                                        if (mouseY >= buttonY && mouseY <= buttonY + 2 && mouseX >= 10 && mouseX <= 28) {
-                                            if (lastClickedButton == 1 && 
-                                                (currentTime - lastClickTime) < DOUBLE_CLICK_THRESHOLD) {
-                                                // Mark as read
-                                                vector<int> indices = parseMessageNumbers(input, queue.getSize());
-                                                if (!indices.empty()) {
-                                                    markedCount = indices.size();
-                                                    for (int i = 0; i < (int)indices.size(); i++) {
-                                                        queue.markAsRead(indices[i]);
-                                                    }
-                                                    marked = true;
-                                                    lastClickedButton = -1;
-                                                } else {
-                                                    input = "INVALID";
-                                                    marked = true;
-                                                    lastClickedButton = -1;
-                                                }
+                                    // Check if clicked on Tandai button
+                                    else if (ev.pressed && ev.button == 0 && widget == WIDGET_MARK) {
+                                        if (buttonClicks.click(WIDGET_MARK)) {
+                                            // Mark as read
+                                            markedCount = markMessagesById(queue, input);
+                                            if (markedCount > 0) {
+                                                marked = true;
                                             } else {
-                                                lastClickedButton = 1;
-                                                lastClickTime = currentTime;
+                                                input = "INVALID";
+                                                marked = true;
                                             }
                                         }
-                                        // Check if clicked on Kembali button
-                                        else if (mouseY >= buttonY && mouseY <= buttonY + 2 && mouseX >= 30 && mouseX <= 52) {
-                                            if (lastClickedButton == 2 && 
-                                                (currentTime - lastClickTime) < DOUBLE_CLICK_THRESHOLD) {
-                                                shouldReturn = true;
-                                            } else {
-                                                lastClickedButton = 2;
-                                                lastClickTime = currentTime;
-                                            }
+                                    }
+                                    // Check if clicked on Kembali button
+                                    else if (ev.pressed && ev.button == 0 && widget == WIDGET_BACK) {
+                                        if (buttonClicks.click(WIDGET_BACK)) {
+                                            shouldReturn = true;
                                         }
                                     }
                                 }
                             }
                         }
-                    }
-                } else if (c == '\n' || c == '\r') { // Enter key
-                    if (focusArea == 1) {
-                        // Di area button
-                        if (selectedButton == 0) {
-                            // Tandai
-                            vector<int> indices = parseMessageNumbers(input, queue.getSize());
-                            if (!indices.empty()) {
-                                markedCount = indices.size();
-                                for (int i = 0; i < (int)indices.size(); i++) {
-                                    queue.markAsRead(indices[i]);
+                    }
+                } else if (c == '\n' || c == '\r') { // Enter key
+                    if (focusArea == 1) {
+                        // Di area button
+                        if (selectedButton == 0) {
+                            // Tandai
+                            markedCount = markMessagesById(queue, input);
+                            if (markedCount > 0) {
+                                marked = true;
+                            } else {
+                                input = "INVALID";
+                                marked = true;
+                            }
+                        } else {
+                            // Kembali
+                            shouldReturn = true;
+                        }
+                    }
+                } else if (c == 127 || c == 8) { // Backspace
+                    if (focusArea == 0) {
+                        if (selectionStart != -1 && selectionEnd != -1 && selectionStart != selectionEnd) {
+                            // Ada seleksi, hapus text yang diselect
+                            int selStart = selectionStart < selectionEnd ? selectionStart : selectionEnd;
+                            int selEnd = selectionStart < selectionEnd ? selectionEnd : selectionStart;
+                            input.erase(selStart, selEnd - selStart);
+                            cursorPos = selStart;
+                            selectionStart = -1;
+                            selectionEnd = -1;
+                        } else {
+                            // Tidak ada seleksi, hapus 1 karakter sebelum cursor
+                            if (cursorPos > 0) {
+                                input.erase(cursorPos - 1, 1);
+                                cursorPos--;
+                            }
+                        }
+                    }
+                } else if (c >= 32 && c <= 126) { // Printable characters
+                    if (focusArea == 0) {
+                        if (selectionStart != -1 && selectionEnd != -1 && selectionStart != selectionEnd) {
+                            // Ada seleksi, replace dengan karakter baru
+                            int selStart = selectionStart < selectionEnd ? selectionStart : selectionEnd;
+                            int selEnd = selectionStart < selectionEnd ? selectionEnd : selectionStart;
+                            input.erase(selStart, selEnd - selStart);
+                            input.insert(selStart, 1, c);
+                            cursorPos = selStart + 1;
+                            selectionStart = -1;
+                            selectionEnd = -1;
+                        } else {
+                            // Insert karakter di posisi cursor
+                            input.insert(cursorPos, 1, c);
+                            cursorPos++;
+                        }
+                    }
+                }
+            }
+        } else {
+            // Confirmation
+            gotoxy(10, 7);
+            if (input == "INVALID") {
+                setColor(31);
+                printf("✗ Input tidak valid! Format: 1 atau 1,3 atau 1-3 atau all");
+            } else {
+                setColor(32);
+                if (markedCount == queue.getSize()) {
+                    printf("✓ Semua %d pesan berhasil ditandai sebagai dibaca!", markedCount);
+                } else if (markedCount > 1) {
+                    printf("✓ %d pesan berhasil ditandai sebagai dibaca!", markedCount);
+                } else {
+                    printf("✓ 1 pesan berhasil ditandai sebagai dibaca!");
+                }
+            }
+            resetColor();
+            
+            shouldReturn = displayBackButton(9, buttonClicks);
+        }
+    }
+}
+
+// Statistik waktu untuk satu jenis perintah di mode batch
+struct OpStats {
+    string name;
+    long long count;
+    long long okCount;
+    long long totalNs;
+    long long minNs;
+    long long maxNs;
+    
+    OpStats(string n) : name(n), count(0), okCount(0), totalNs(0), minNs(0), maxNs(0) {}
+    
+    void record(long long ns, bool ok) {
+        if (count == 0 || ns < minNs) minNs = ns;
+        if (ns > maxNs) maxNs = ns;
+        count++;
+        if (ok) okCount++;
+        totalNs += ns;
+    }
+};
+
+// Fungsi untuk mengubah escape "\n" dan "\t" di script menjadi karakter asli
+string unescapeText(const string& str) {
+    string result;
+    for (int i = 0; i < (int)str.length(); i++) {
+        if (str[i] == '\\' && i + 1 < (int)str.length()) {
+            char next = str[i + 1];
+            if (next == 'n') { result += '\n'; i++; continue; }
+            if (next == 't') { result += '\t'; i++; continue; }
+            if (next == '\\') { result += '\\'; i++; continue; }
+        }
+        result += str[i];
+    }
+    return result;
+}
+
+// Mode batch: menjalankan perintah dari script langsung ke QueuePesan tanpa TUI
+// Perintah per baris:
+//   send <text>              enqueue 1 pesan (\n untuk baris baru)
+//   send-many <n> [prefix]   enqueue n pesan unik "prefix <hex>"
+//   dequeue [n]              hapus n pesan berikutnya sekaligus (giliran lane prioritas)
+//   cancel [n]               batalkan n pesan terakhir sekaligus
+//   read <1,3-5|all>         tandai pesan sebagai dibaca (posisi di queue)
+//   read-id <12,15-18|all>   tandai pesan sebagai dibaca (ID pesan)
+//   delete <12,15-18>        hapus pesan berdasarkan ID
+//   undo [n] / redo [n]      batalkan / ulangi n perubahan terakhir
+//   list [max]               tampilkan pesan (default semua)
+//   size                     tampilkan jumlah pesan
+//   similarity <0..1>        ambang pesan mirip (1 = hanya duplikat persis)
+//   blocklist <path>         muat file frasa terlarang
+//   history [n]              atur window riwayat (0 = nonaktif) dan tampilkan statusnya
+//   search <kata...>         cari pesan yang mengandung semua kata (maks 20 terbaru)
+//   rate <n>[/detik]         rate limit n pesan per window (0 = nonaktif, default nonaktif)
+//   chat <nama>              pindah ke chat lain (dibuat jika belum ada)
+//   chats [max]              tampilkan daftar chat, aktivitas terbaru dulu
+//   group <nama> <n>         pindah ke chat grup dengan n anggota (dibuat jika belum ada)
+//   read-by <anggota> <ID>   anggota grup membaca pesan tertentu (12,15-18)
+//   read-upto <anggota> <ID> anggota grup membaca semua pesan sampai ID
+//   receipts [max]           tampilkan jumlah anggota yang sudah membaca tiap pesan
+//   schedule <ms> <text>     jadwalkan pesan ke chat aktif, ms setelah jam virtual
+//   advance <ms>             majukan jam virtual dan kirim pesan yang jatuh tempo
+//   scheduled [max]          tampilkan jadwal terdekat
+//   unschedule <id>          batalkan jadwal berdasarkan ID jadwal
+//   ttl <ms>                 TTL pesan baru di chat aktif (0 = permanen)
+//   send-ttl <ms> <text>     enqueue 1 pesan yang hilang setelah ms
+//   wait <ms>                tunggu ms (jam asli) lalu hapus pesan yang kedaluwarsa
+//   send-prio <lane> <text>  enqueue 1 pesan ke lane darurat / mention / normal
+//   lanes                    tampilkan jumlah pesan per lane prioritas
+// Baris kosong dan baris diawali '#' diabaikan
+int runBatch(const char* path) {
+    FILE* in = stdin;
+    if (path != nullptr && strcmp(path, "-") != 0) {
+        in = fopen(path, "r");
+        if (in == nullptr) {
+            fprintf(stderr, "Tidak bisa membuka script: %s\n", path);
+            return 1;
+        }
+    }
+    
+    ChatList chats;
+    Conversation* activeChat = chats.open("default");
+    QueuePesan* queue = &activeChat->queue; // Queue chat aktif
+    Blocklist batchBlocklist;
+    vector<OpStats> stats;
+    stats.push_back(OpStats("send"));
+    stats.push_back(OpStats("dequeue"));
+    stats.push_back(OpStats("cancel"));
+    stats.push_back(OpStats("read"));
+    stats.push_back(OpStats("list"));
+    stats.push_back(OpStats("search"));
+    stats.push_back(OpStats("delete"));
+    stats.push_back(OpStats("undo/redo"));
+    stats.push_back(OpStats("schedule"));
+    stats.push_back(OpStats("expire"));
+    OpStats& sendStats = stats[0];
+    OpStats& dequeueStats = stats[1];
+    OpStats& cancelStats = stats[2];
+    OpStats& readStats = stats[3];
+    OpStats& listStats = stats[4];
+    OpStats& searchStats = stats[5];
+    OpStats& deleteStats = stats[6];
+    OpStats& undoStats = stats[7];
+    OpStats& scheduleStats = stats[8];
+    OpStats& expireStats = stats[9];
+    
+    // Jadwal batch memakai jam virtual mulai 0 yang hanya maju lewat `advance`
+    long long virtualNowMs = 0;
+    MessageScheduler batchScheduler(virtualNowMs);
+    
+    long long batchStart = currentTimeNs();
+    long long sendManyCounter = 1;
+    int lineNumber = 0;
+    char* lineBuf = nullptr;
+    size_t lineCap = 0;
+    ssize_t lineLen;
+    
+    while ((lineLen = getline(&lineBuf, &lineCap, in)) != -1) {
+        lineNumber++;
+        string line(lineBuf, lineLen);
+        while (!line.empty() && (line[line.length() - 1] == '\n' || line[line.length() - 1] == '\r')) {
+            line.erase(line.length() - 1);
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        
+        // Pisahkan perintah dan argumen
+        size_t space = line.find(' ');
+        string cmd = line.substr(0, space);
+        string arg = (space == string::npos) ? "" : line.substr(space + 1);
+        int count = arg.empty() ? 1 : atoi(arg.c_str());
+        
+        if (cmd == "send" || cmd == "enqueue") {
+            string text = unescapeText(arg);
+            long long t0 = currentTimeNs();
+            bool ok = !isEmptyOrWhitespace(text) && queue->enqueue(text);
+            sendStats.record(currentTimeNs() - t0, ok);
+        } else if (cmd == "send-ttl") {
+            size_t split = arg.find(' ');
+            if (split == string::npos || atoll(arg.c_str()) <= 0) {
+                fprintf(stderr, "Baris %d: pemakaian: send-ttl <ms> <text>\n", lineNumber);
+                continue;
+            }
+            string text = unescapeText(arg.substr(split + 1));
+            long long t0 = currentTimeNs();
+            bool ok = !isEmptyOrWhitespace(text) && queue->enqueue(text, atoll(arg.c_str()));
+            sendStats.record(currentTimeNs() - t0, ok);
+        } else if (cmd == "send-prio") {
+            size_t split = arg.find(' ');
+            int lane = PRIORITY_LANES;
+            for (int i = 0; i < PRIORITY_LANES && split != string::npos; i++) {
+                if (arg.compare(0, split, PRIORITY_NAMES[i]) == 0) lane = i;
+            }
+            if (lane == PRIORITY_LANES) {
+                fprintf(stderr, "Baris %d: pemakaian: send-prio <darurat|mention|normal> <text>\n", lineNumber);
+                continue;
+            }
+            string text = unescapeText(arg.substr(split + 1));
+            long long t0 = currentTimeNs();
+            bool ok = !isEmptyOrWhitespace(text) && queue->enqueue(text, -1, lane);
+            sendStats.record(currentTimeNs() - t0, ok);
+        } else if (cmd == "send-many") {
+            size_t prefixPos = arg.find(' ');
+            string prefix = (prefixPos == string::npos) ? "pesan" : arg.substr(prefixPos + 1);
+            for (int i = 1; i <= count; i++) {
+                string text = benchText(prefix.c_str(), sendManyCounter++);
+                long long t0 = currentTimeNs();
+                bool ok = queue->enqueue(text);
+                sendStats.record(currentTimeNs() - t0, ok);
+            }
+        } else if (cmd == "dequeue") {
+            long long t0 = currentTimeNs();
+            bool ok = (count == 1) ? queue->dequeue() : queue->dequeue(count) > 0;
+            dequeueStats.record(currentTimeNs() - t0, ok);
+        } else if (cmd == "cancel") {
+            long long t0 = currentTimeNs();
+            bool ok = (count == 1) ? queue->cancelLast() : queue->cancelLast(count) > 0;
+            cancelStats.record(currentTimeNs() - t0, ok);
+        } else if (cmd == "read") {
+            long long t0 = currentTimeNs();
+            vector<int> indices = parseMessageNumbers(arg, queue->getSize());
+            sort(indices.begin(), indices.end()); // Jalan list sekali dari depan
+            indices.erase(unique(indices.begin(), indices.end()), indices.end());
+            vector<long long> ids;
+            Node* current = queue->getFront();
+            for (int i = 0, pos = 0; i < (int)indices.size(); i++) {
+                while (pos < indices[i]) {
+                    current = current->next;
+                    pos++;
+                }
+                ids.push_back(current->data.id);
+            }
+            queue->markAsReadByIds(ids);
+            readStats.record(currentTimeNs() - t0, !indices.empty());
+        } else if (cmd == "read-id") {
+            long long t0 = currentTimeNs();
+            int marked = markMessagesById(*queue, arg);
+            readStats.record(currentTimeNs() - t0, marked > 0);
+        } else if (cmd == "delete") {
+            vector<long long> ids = parseMessageIds(arg, queue->getFirstId(), queue->getLastId());
+            for (int i = 0; i < (int)ids.size(); i++) {
+                long long t0 = currentTimeNs();
+                bool ok = queue->removeById(ids[i]);
+                deleteStats.record(currentTimeNs() - t0, ok);
+            }
+        } else if (cmd == "undo" || cmd == "redo") {
+            for (int i = 0; i < count; i++) {
+                long long t0 = currentTimeNs();
+                bool ok = (cmd == "undo") ? queue->undo() : queue->redo();
+                undoStats.record(currentTimeNs() - t0, ok);
+                if (!ok) break;
+            }
+        } else if (cmd == "list") {
+            int maxShown = arg.empty() ? queue->getSize() : count;
+            long long t0 = currentTimeNs();
+            Node* current = queue->getFront();
+            int index = 0;
+            while (current != nullptr && index < maxShown) {
+                printf("%s %d: %s\n", current->data.isRead ? "[√]" : "[-]", index + 1, current->data.text.c_str());
+                current = current->next;
+                index++;
+            }
+            listStats.record(currentTimeNs() - t0, true);
+        } else if (cmd == "similarity") {
+            queue->setSimilarityThreshold(atof(arg.c_str()));
+        } else if (cmd == "search") {
+            vector<Node*> found;
+            long long t0 = currentTimeNs();
+            queue->search(arg, 20, found);
+            searchStats.record(currentTimeNs() - t0, !found.empty());
+            for (size_t i = 0; i < found.size(); i++) {
+                printf("#%lld: %s\n", found[i]->data.id, found[i]->data.text.c_str());
+            }
+            printf("Hasil: %d\n", (int)found.size());
+        } else if (cmd == "rate") {
+            int maxMessages = 0;
+            int seconds = 1;
+            sscanf(arg.c_str(), "%d/%d", &maxMessages, &seconds);
+            queue->setRateLimit(maxMessages, seconds);
+        } else if (cmd == "history") {
+            if (!arg.empty()) {
+                queue->setHistoryWindow(atoll(arg.c_str()));
+            }
+            const SpamHistory& history = queue->getHistory();
+            printf("Riwayat: %lld pesan diingat, window %lld, %d hash, %zu byte, FPR ~%.4f%%\n",
+                   history.getRemembered(), history.getWindow(), history.getHashCount(),
+                   history.getMemoryBytes(), history.estimatedFpr() * 100.0);
+        } else if (cmd == "blocklist") {
+            if (batchBlocklist.load(arg)) {
+                queue->setBlocklist(&batchBlocklist);
+                printf("Blocklist: %d frasa\n", batchBlocklist.current()->getPatternCount());
+            } else {
+                fprintf(stderr, "Baris %d: tidak bisa membuka blocklist: %s\n", lineNumber, arg.c_str());
+            }
+        } else if (cmd == "chat") {
+            activeChat = chats.open(arg.empty() ? "default" : arg);
+            queue = &activeChat->queue;
+        } else if (cmd == "group") {
+            size_t split = arg.rfind(' ');
+            int members = (split == string::npos) ? 0 : atoi(arg.c_str() + split + 1);
+            if (members <= 0) {
+                fprintf(stderr, "Baris %d: pemakaian: group <nama> <jumlah anggota>\n", lineNumber);
+                continue;
+            }
+            activeChat = chats.openGroup(arg.substr(0, split), members);
+            queue = &activeChat->queue;
+        } else if (cmd == "read-by" || cmd == "read-upto") {
+            // read-by <anggota> <ID...> / read-upto <anggota> <ID> (anggota mulai dari 1)
+            GroupReceipts* group = activeChat->group.get();
+            size_t split = arg.find(' ');
+            int member = atoi(arg.c_str()) - 1;
+            if (group == nullptr || member < 0 || member >= group->getMemberCount() || split == string::npos) {
+                fprintf(stderr, "Baris %d: %s butuh chat grup dan nomor anggota yang valid\n", lineNumber, cmd.c_str());
+                continue;
+            }
+            string ids = arg.substr(split + 1);
+            long long t0 = currentTimeNs();
+            bool ok = true;
+            if (cmd == "read-upto") {
+                group->markReadUpTo(member, min(atoll(ids.c_str()), queue->getLastId()));
+            } else {
+                vector<long long> list = parseMessageIds(ids, queue->getFirstId(), queue->getLastId());
+                for (size_t i = 0; i < list.size(); i++) {
+                    Node* node = queue->findById(list[i]);
+                    if (node != nullptr) group->markRead(member, node);
+                }
+                ok = !list.empty();
+            }
+            readStats.record(currentTimeNs() - t0, ok);
+        } else if (cmd == "receipts") {
+            GroupReceipts* group = activeChat->group.get();
+            int maxShown = arg.empty() ? queue->getSize() : count;
+            Node* current = queue->getFront();
+            for (int i = 0; i < maxShown && current != nullptr; i++, current = current->next) {
+                if (group != nullptr) {
+                    printf("#%lld: dibaca %d/%d\n", current->data.id, group->countReaders(current), group->getMemberCount());
+                } else {
+                    printf("#%lld: %s\n", current->data.id, current->data.isRead ? "dibaca" : "belum dibaca");
+                }
+            }
+        } else if (cmd == "chats") {
+            int maxShown = arg.empty() ? chats.getCount() : count;
+            Conversation* chat = chats.getNewest();
+            for (int i = 0; i < maxShown && chat != nullptr; i++, chat = chat->older) {
+                Node* last = chat->queue.getRear();
+                printf("%s (%d belum dibaca): %s\n", chat->name.c_str(), chat->queue.getUnreadCount(),
+                       last != nullptr ? last->data.text.c_str() : "");
+            }
+        } else if (cmd == "schedule") {
+            size_t split = arg.find(' ');
+            if (split == string::npos || atoll(arg.c_str()) < 0) {
+                fprintf(stderr, "Baris %d: pemakaian: schedule <ms> <text>\n", lineNumber);
+                continue;
+            }
+            string text = unescapeText(arg.substr(split + 1));
+            long long t0 = currentTimeNs();
+            long long id = batchScheduler.schedule(activeChat, text, virtualNowMs + atoll(arg.c_str()));
+            scheduleStats.record(currentTimeNs() - t0, true);
+            printf("Jadwal #%lld: %s pada %lld ms\n", id, activeChat->name.c_str(), virtualNowMs + atoll(arg.c_str()));
+        } else if (cmd == "advance") {
+            virtualNowMs += atoll(arg.c_str());
+            long long sentBefore = batchScheduler.getSent();
+            long long t0 = currentTimeNs();
+            int processed = batchScheduler.advance(virtualNowMs);
+            scheduleStats.record(currentTimeNs() - t0, true);
+            printf("Waktu %lld ms: %d jadwal jatuh tempo, %lld terkirim, %d menunggu\n", virtualNowMs, processed,
+                   batchScheduler.getSent() - sentBefore, batchScheduler.getPending());
+        } else if (cmd == "scheduled") {
+            vector<const ScheduledMessage*> upcoming;
+            vector<long long> dueMs;
+            batchScheduler.upcoming(arg.empty() ? batchScheduler.getPending() : count, upcoming, dueMs);
+            for (size_t i = 0; i < upcoming.size(); i++) {
+                printf("#%lld: %lld ms -> %s: %s\n", upcoming[i]->id, dueMs[i],
+                       upcoming[i]->chat->name.c_str(), upcoming[i]->text.c_str());
+            }
+        } else if (cmd == "unschedule") {
+            long long t0 = currentTimeNs();
+            bool ok = batchScheduler.cancel(atoll(arg.c_str()));
+            scheduleStats.record(currentTimeNs() - t0, ok);
+            if (!ok) {
+                fprintf(stderr, "Baris %d: jadwal #%s tidak ada atau sudah terkirim\n", lineNumber, arg.c_str());
+            }
+        } else if (cmd == "lanes") {
+            printf("Lane %s: %d darurat, %d mention, %d normal\n", activeChat->name.c_str(),
+                   queue->getLaneSize(PRIORITY_ALERT), queue->getLaneSize(PRIORITY_MENTION),
+                   queue->getLaneSize(PRIORITY_NORMAL));
+        } else if (cmd == "ttl") {
+            queue->setTtl(atoll(arg.c_str()));
+            printf("TTL %s: %lld ms\n", activeChat->name.c_str(), queue->getTtl());
+        } else if (cmd == "wait") {
+            // TTL memakai jam monotonic asli (sama seperti timestamp pesan)
+            usleep(max(0LL, atoll(arg.c_str())) * 1000);
+            long long t0 = currentTimeNs();
+            int removed = chats.expireDue(currentTimeMs());
+            expireStats.record(currentTimeNs() - t0, removed > 0);
+            printf("Kedaluwarsa: %d pesan dihapus, total %lld\n", removed, chats.getExpiredTotal());
+        } else if (cmd == "size") {
+            printf("Total pesan: %d\n", queue->getSize());
+        } else {
+            fprintf(stderr, "Baris %d: perintah tidak dikenal '%s'\n", lineNumber, cmd.c_str());
+        }
+    }
+    free(lineBuf);
+    if (in != stdin) {
+        fclose(in);
+    }
+    
+    double elapsedSec = (currentTimeNs() - batchStart) / 1e9;
+    long long totalOps = 0;
+    for (int i = 0; i < (int)stats.size(); i++) {
+        totalOps += stats[i].count;
+    }
+    
+    // Ringkasan throughput dan latency
+    printf("\n=== Ringkasan Batch ===\n");
+    printf("%-8s %10s %10s %12s %14s %10s %10s %12s\n",
+           "perintah", "jumlah", "berhasil", "total(ms)", "ops/detik", "avg(ns)", "min(ns)", "max(ns)");
+    for (int i = 0; i < (int)stats.size(); i++) {
+        OpStats& st = stats[i];
+        if (st.count == 0) continue;
+        double totalMs = st.totalNs / 1e6;
+        double opsPerSec = st.totalNs > 0 ? st.count * 1e9 / st.totalNs : 0;
+        printf("%-8s %10lld %10lld %12.3f %14.0f %10lld %10lld %12lld\n",
+               st.name.c_str(), st.count, st.okCount, totalMs, opsPerSec,
+               st.totalNs / st.count, st.minNs, st.maxNs);
+    }
+    printf("Total: %lld operasi dalam %.3f detik (%.0f ops/detik), sisa pesan: %d\n",
+           totalOps, elapsedSec, elapsedSec > 0 ? totalOps / elapsedSec : 0, queue->getSize());
+    return 0;
+}
+
+// Hasil satu pengukuran benchmark
+struct BenchResult {
+    string name;
+    long long size;
+    long long iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double scaling; // Kemiringan log(ns)/log(size) terhadap ukuran sebelumnya
+};
+
+// Nilai sink agar compiler tidak membuang hasil fungsi yang diukur
+volatile long long benchSink = 0;
+
+// Fungsi untuk mengukur body(i) sebanyak iterations kali
+template <typename Body>
+BenchResult measureBench(const string& name, long long size, long long iterations, Body body) {
+    long long allocStart = allocationCount;
+    long long t0 = currentTimeNs();
+    for (long long i = 0; i < iterations; i++) {
+        body(i);
+    }
+    long long elapsed = currentTimeNs() - t0;
+    
+    BenchResult r;
+    r.name = name;
+    r.size = size;
+    r.iterations = iterations;
+    r.nsPerOp = (double)elapsed / iterations;
+    r.allocsPerOp = (double)(allocationCount - allocStart) / iterations;
+    r.scaling = 0;
+    return r;
+}
+
+// Seperti measureBench, tapi body diukur per potongan (chunk) dan restore()
+// dipanggil di antara potongan tanpa diukur, agar ukuran queue tetap stabil
+template <typename Body, typename Restore>
+BenchResult measureBenchChunked(const string& name, long long size, long long iterations,
+                                long long chunk, Body body, Restore restore) {
+    long long allocTotal = 0;
+    long long elapsed = 0;
+    long long done = 0;
+    if (chunk < 1) chunk = 1;
+    
+    while (done < iterations) {
+        long long n = (iterations - done < chunk) ? iterations - done : chunk;
+        long long allocStart = allocationCount;
+        long long t0 = currentTimeNs();
+        for (long long i = 0; i < n; i++) {
+            body(done + i);
+        }
+        elapsed += currentTimeNs() - t0;
+        allocTotal += allocationCount - allocStart;
+        done += n;
+        restore(n);
+    }
+    
+    BenchResult r;
+    r.name = name;
+    r.size = size;
+    r.iterations = iterations;
+    r.nsPerOp = (double)elapsed / iterations;
+    r.allocsPerOp = (double)allocTotal / iterations;
+    r.scaling = 0;
+    return r;
+}
+
+// Fungsi untuk mengisi queue sampai ukuran target dengan pesan unik
+void fillBenchQueue(QueuePesan& queue, long long targetSize, long long& counter) {
+    while (queue.getSize() < targetSize) {
+        queue.enqueue(benchText("bench", counter++));
+    }
+}
+
+// Mode benchmark: mengukur fungsi-fungsi utama di berbagai ukuran queue
+// Output CSV (default) atau JSON lines, satu baris per (benchmark, ukuran)
+int runBench(int argc, char* argv[]) {
+    long long maxSize = 100000;
+    bool json = false;
+    
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            maxSize = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            json = (strcmp(argv[++i], "json") == 0);
+        } else {
+            fprintf(stderr, "Argumen tidak dikenal: %s\n", argv[i]);
+            fprintf(stderr, "Pemakaian: wa --bench [--max-size N] [--format csv|json]\n");
+            return 1;
+        }
+    }
+    if (maxSize < 10) maxSize = 10;
+    if (maxSize > 10000000) maxSize = 10000000;
+    countAllocations = true;
+    
+    vector<BenchResult> results;
+    QueuePesan queue;
+    queue.setUndoLimit(0, 0); // Journal undo hanya diaktifkan untuk baris undo_*
+    long long counter = 0;
+    
+    vector<string> benchPhrases;
+    for (int i = 0; i < 1000; i++) {
+        benchPhrases.push_back(benchText("blok", i));
+    }
+    KeywordAutomaton benchBlocklist(benchPhrases);
+    
+    for (long long size = 10; size <= maxSize; size *= 10) {
+        fprintf(stderr, "ukuran %lld...\n", size);
+        fillBenchQueue(queue, size, counter);
+        
+        // Jumlah ulangan: operasi O(n) diulang lebih sedikit di ukuran besar
+        long long linearReps = 10000000 / size;
+        if (linearReps < 10) linearReps = 10;
+        if (linearReps > 10000) linearReps = 10000;
+        long long chunk = size / 10 > 0 ? size / 10 : 1; // Maksimal 10% perubahan ukuran per potongan
+        long long constantReps = 1000;
+        
+        // enqueue pesan baru (dibatalkan lagi di antara potongan)
+        results.push_back(measureBenchChunked("enqueue", size, linearReps < constantReps ? linearReps : constantReps, chunk,
+            [&](long long) {
+                queue.enqueue(benchText("baru", counter++));
+            },
+            [&](long long n) {
+                for (long long i = 0; i < n; i++) queue.cancelLast();
+            }));
+        
+        // enqueue duplikat dari pesan terakhir (kasus terburuk spam filter)
+        Node* last = queue.getFront();
+        while (last->next != nullptr) last = last->next;
+        string duplicate = last->data.text;
+        results.push_back(measureBench("enqueue_duplicate", size, linearReps, [&](long long) {
+            benchSink += queue.enqueue(duplicate);
+        }));
+        
+        // enqueue pesan yang mirip dengan pesan terakhir (ditolak lewat LSH)
+        string nearDuplicate = duplicate + "!";
+        results.push_back(measureBench("enqueue_near_duplicate", size, linearReps, [&](long long) {
+            benchSink += queue.enqueue(nearDuplicate);
+        }));
+        
+        // dequeue dan cancelLast, queue diisi ulang di antara potongan
+        results.push_back(measureBenchChunked("dequeue", size, constantReps, chunk,
+            [&](long long) {
+                benchSink += queue.dequeue();
+            },
+            [&](long long) {
+                fillBenchQueue(queue, size, counter);
+            }));
+        results.push_back(measureBenchChunked("cancelLast", size, constantReps, chunk,
+            [&](long long) {
+                benchSink += queue.cancelLast();
+            },
+            [&](long long) {
+                fillBenchQueue(queue, size, counter);
+            }));
+        
+        // Hapus banyak pesan dalam satu panggilan (ns per panggilan, bukan per pesan)
+        long long bulkReps = 1000000 / size;
+        if (bulkReps < 1) bulkReps = 1;
+        if (bulkReps > 100) bulkReps = 100;
+        results.push_back(measureBenchChunked("dequeue_bulk_10pct", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += queue.dequeue((int)chunk);
+            },
+            [&](long long) {
+                queue.drainReclaimer();
+                fillBenchQueue(queue, size, counter);
+            }));
+        results.push_back(measureBenchChunked("dequeue_bulk_all", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += queue.dequeue((int)size);
+            },
+            [&](long long) {
+                queue.drainReclaimer();
+                fillBenchQueue(queue, size, counter);
+            }));
+        results.push_back(measureBenchChunked("cancelLast_bulk_10pct", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += queue.cancelLast((int)chunk);
+            },
+            [&](long long) {
+                queue.drainReclaimer();
+                fillBenchQueue(queue, size, counter);
+            }));
+        results.push_back(measureBenchChunked("cancelLast_bulk_90pct", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += queue.cancelLast((int)(size - chunk));
+            },
+            [&](long long) {
+                queue.drainReclaimer();
+                fillBenchQueue(queue, size, counter);
+            }));
+        
+        // Pesan kedaluwarsa dihapus sekaligus (ns per panggilan expire): 10%
+        // terdepan (satu run; TTL naik 1 ms per pesan agar deadline urut), atau
+        // setiap pesan ke-10 (run tersebar) dengan sisa pesan ber-TTL 2 jam
+        QueuePesan ttlQueue;
+        ttlQueue.setSimilarityThreshold(1.0);
+        ttlQueue.setRateLimit(0, 1);
+        long long ttlCounter = 0;
+        long long expireAt = 0;
+        auto fillTtlQueue = [&](bool scattered) {
+            while (ttlQueue.getSize() < size) {
+                long long ttl = !scattered ? 3600 * 1000 + ttlCounter :
+                                (ttlCounter % 10 != 0 ? 2 * 3600 * 1000 : 60 * 1000);
+                ttlQueue.enqueue(benchText("ttl", ttlCounter++), ttl);
+            }
+            Node* node = ttlQueue.getFront();
+            for (long long i = 1; i < chunk && !scattered; i++) node = node->next;
+            expireAt = scattered ? currentTimeMs() + 60 * 1000 : node->data.expiresAt;
+        };
+        fillTtlQueue(false);
+        results.push_back(measureBenchChunked("expire_10pct_front", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += ttlQueue.expire(expireAt);
+            },
+            [&](long long) {
+                ttlQueue.drainReclaimer();
+                fillTtlQueue(false);
+            }));
+        ttlQueue.dequeue(ttlQueue.getSize());
+        fillTtlQueue(true);
+        results.push_back(measureBenchChunked("expire_10pct_scattered", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += ttlQueue.expire(expireAt);
+            },
+            [&](long long) {
+                ttlQueue.drainReclaimer();
+                ttlQueue.dequeue(ttlQueue.getSize());
+                fillTtlQueue(true);
+            }));
+        
+        // dequeue dengan lane prioritas campur (1/8 darurat, 1/8 mention, sisanya
+        // normal): pesan diambil dari tengah list sesuai giliran lane
+        QueuePesan laneQueue;
+        laneQueue.setSimilarityThreshold(1.0);
+        laneQueue.setRateLimit(0, 1);
+        long long laneCounter = 0;
+        auto fillLaneQueue = [&]() {
+            while (laneQueue.getSize() < size) {
+                int lane = laneCounter % 8 == 0 ? PRIORITY_ALERT :
+                           (laneCounter % 8 == 4 ? PRIORITY_MENTION : PRIORITY_NORMAL);
+                laneQueue.enqueue(benchText("lane", laneCounter++), 0, lane);
+            }
+        };
+        fillLaneQueue();
+        results.push_back(measureBenchChunked("dequeue_mixed_lanes", size, constantReps, chunk,
+            [&](long long) {
+                benchSink += laneQueue.dequeue();
+            },
+            [&](long long) {
+                fillLaneQueue();
+            }));
+        results.push_back(measureBenchChunked("dequeue_bulk_10pct_mixed_lanes", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += laneQueue.dequeue((int)chunk);
+            },
+            [&](long long) {
+                laneQueue.drainReclaimer();
+                fillLaneQueue();
+            }));
+        
+        // markAsRead di depan, tengah, dan belakang
+        results.push_back(measureBench("markAsRead_front", size, linearReps, [&](long long) {
+            benchSink += queue.markAsRead(0);
+        }));
+        results.push_back(measureBench("markAsRead_middle", size, linearReps, [&](long long) {
+            benchSink += queue.markAsRead(size / 2);
+        }));
+        results.push_back(measureBench("markAsRead_back", size, linearReps, [&](long long) {
+            benchSink += queue.markAsRead(size - 1);
+        }));
+        
+        // Operasi berdasarkan ID lewat tabel handle (tidak perlu jalan di list)
+        long long middleId = queue.getFirstId() + (queue.getLastId() - queue.getFirstId()) / 2;
+        results.push_back(measureBench("markAsReadById_front", size, constantReps, [&](long long) {
+            benchSink += queue.markAsReadById(queue.getFirstId());
+        }));
+        results.push_back(measureBench("markAsReadById_middle", size, constantReps, [&](long long) {
+            benchSink += queue.markAsReadById(middleId);
+        }));
+        results.push_back(measureBench("markAsReadById_back", size, constantReps, [&](long long) {
+            benchSink += queue.markAsReadById(queue.getLastId());
+        }));
+        
+        // Read receipt grup 4096 anggota: watermark per anggota dan hitung pembaca
+        GroupReceipts group(4096);
+        group.markReadUpTo(4095, queue.getLastId()); // Alokasi tree di luar pengukuran
+        long long firstId = queue.getFirstId();
+        long long span = queue.getLastId() - firstId + 1;
+        results.push_back(measureBench("group_markReadUpTo", size, constantReps, [&](long long i) {
+            group.markReadUpTo(i % 4096, firstId + i % span);
+        }));
+        Node* groupNode = queue.findById(queue.getLastId());
+        for (int m = 0; m < 4095; m += 3) {
+            group.markRead(m, groupNode); // Sepertiga anggota membaca di luar urutan
+        }
+        results.push_back(measureBench("group_countReaders", size, constantReps, [&](long long) {
+            benchSink += group.countReaders(groupNode);
+        }));
+        Node* middleNode = nullptr;
+        auto findMiddle = [&]() {
+            long long id = queue.getFirstId() + (queue.getLastId() - queue.getFirstId()) / 2;
+            while ((middleNode = queue.findById(id)) == nullptr) id++;
+        };
+        findMiddle();
+        results.push_back(measureBenchChunked("removeById_middle", size, constantReps, chunk,
+            [&](long long) {
+                Node* next = middleNode->next;
+                benchSink += queue.removeById(middleNode->data.id);
+                middleNode = next;
+            },
+            [&](long long) {
+                fillBenchQueue(queue, size, counter);
+                findMiddle();
+            }));
+        
+        // Undo/redo lewat journal (hanya aktif untuk baris ini)
+        queue.setUndoLimit(100, size);
+        queue.enqueue(benchText("undo", counter++));
+        results.push_back(measureBench("undo_redo_send", size, constantReps, [&](long long) {
+            benchSink += queue.undo();
+            benchSink += queue.redo();
+        }));
+        queue.dequeue((int)chunk);
+        results.push_back(measureBenchChunked("undo_dequeue_bulk_10pct", size, bulkReps, 1,
+            [&](long long) {
+                benchSink += queue.undo();
+            },
+            [&](long long) {
+                queue.dequeue((int)chunk);
+            }));
+        queue.undo();
+        queue.setUndoLimit(0, 0);
+        
+        // parseMessageNumbers: satu range besar dan banyak range kecil
+        string bigRange = "1-" + to_string(size);
+        results.push_back(measureBench("parseMessageNumbers_range", size, linearReps, [&](long long) {
+            benchSink += parseMessageNumbers(bigRange, size).size();
+        }));
+        string manyRanges;
+        for (long long i = 1; i + 1 <= size && (long long)manyRanges.length() < size; i += 3) {
+            if (!manyRanges.empty()) manyRanges += ",";
+            manyRanges += to_string(i) + "-" + to_string(i + 1);
+        }
+        results.push_back(measureBench("parseMessageNumbers_list", size, linearReps, [&](long long) {
+            benchSink += parseMessageNumbers(manyRanges, size).size();
+        }));
+        
+        // Helper text: panjang string = ukuran
+        string mixedText;
+        for (long long i = 0; i < size; i++) {
+            mixedText += (char)((i % 7 == 0) ? ' ' : ((i % 2 == 0) ? 'A' + i % 26 : 'a' + i % 26));
+        }
+        string blankText(size, ' ');
+        results.push_back(measureBench("toLowerCase", size, linearReps, [&](long long) {
+            benchSink += toLowerCase(mixedText).length();
+        }));
+        results.push_back(measureBench("isEmptyOrWhitespace", size, linearReps, [&](long long) {
+            benchSink += isEmptyOrWhitespace(blankText);
+        }));
+        
+        // Kernel text SIMD vs scalar (tanpa alokasi, text = ukuran)
+        string foldText = mixedText;
+        results.push_back(measureBench("fold_ascii", size, linearReps, [&](long long) {
+            textKernels.foldAscii(&foldText[0], foldText.length());
+            benchSink += foldText[0];
+        }));
+        results.push_back(measureBench("fold_ascii_scalar", size, linearReps, [&](long long) {
+            textKernelsScalar.foldAscii(&foldText[0], foldText.length());
+            benchSink += foldText[0];
+        }));
+        results.push_back(measureBench("all_whitespace", size, linearReps, [&](long long) {
+            benchSink += textKernels.allWhitespace(blankText.data(), blankText.length());
+        }));
+        results.push_back(measureBench("all_whitespace_scalar", size, linearReps, [&](long long) {
+            benchSink += textKernelsScalar.allWhitespace(blankText.data(), blankText.length());
+        }));
+        string linesText = mixedText;
+        for (long long i = 63; i < size; i += 64) {
+            linesText[i] = '\n'; // Satu baris per 64 karakter
+        }
+        results.push_back(measureBench("newline_count", size, linearReps, [&](long long) {
+            benchSink += textKernels.countNewlines(linesText.data(), linesText.length());
+        }));
+        results.push_back(measureBench("newline_count_scalar", size, linearReps, [&](long long) {
+            benchSink += textKernelsScalar.countNewlines(linesText.data(), linesText.length());
+        }));
+        results.push_back(measureBench("newline_split", size, linearReps, [&](long long) {
+            for (size_t pos = 0; pos <= linesText.length(); pos++) {
+                pos = textKernels.findNewline(linesText.data(), pos, linesText.length());
+                benchSink += pos;
+            }
+        }));
+        results.push_back(measureBench("newline_split_scalar", size, linearReps, [&](long long) {
+            for (size_t pos = 0; pos <= linesText.length(); pos++) {
+                pos = textKernelsScalar.findNewline(linesText.data(), pos, linesText.length());
+                benchSink += pos;
+            }
+        }));
+        
+        // Biaya signature MinHash per pesan (panjang text = ukuran)
+        vector<unsigned int> shingles;
+        buildShingles(mixedText, shingles);
+        unsigned int signature[MINHASH_SIZE];
+        results.push_back(measureBench("minhash_signature", size, linearReps, [&](long long) {
+            minHash(shingles.data(), shingles.size(), signature);
+            benchSink += signature[0];
+        }));
+        results.push_back(measureBench("minhash_signature_scalar", size, linearReps, [&](long long) {
+            minHashScalar(shingles.data(), shingles.size(), signature);
+            benchSink += signature[0];
+        }));
+        
+        // Filter daftar pesan: huruf pertama (scan penuh) vs huruf berikutnya (saring ulang)
+        MessageFilter benchFilter;
+        results.push_back(measureBench("filter_first_key", size, linearReps, [&](long long) {
+            benchFilter.clear();
+            benchSink += benchFilter.apply("a", queue).size();
+        }));
+        benchFilter.clear();
+        benchFilter.apply("bench a", queue);
+        results.push_back(measureBench("filter_refine_key", size, linearReps, [&](long long) {
+            benchFilter.apply("bench a", queue); // Backspace: ambil dari stack
+            benchSink += benchFilter.apply("bench ab", queue).size();
+        }));
+        
+        // Inverted index: dokumen "w<i%7> x<i%13> y<i%101> <unik>", query AND terbaru 20
+        SearchIndex benchIndex;
+        for (long long i = 0; i < size; i++) {
+            char doc[96];
+            snprintf(doc, sizeof(doc), "w%lld x%lld y%lld %s", i % 7, i % 13, i % 101, benchText("u", i).c_str());
+            benchIndex.add(i + 1, doc);
+        }
+        vector<long long> found;
+        auto alwaysLive = [](long long) { return true; };
+        results.push_back(measureBench("search_one_term", size, constantReps, [&](long long) {
+            benchIndex.search("w3", 20, found, alwaysLive);
+            benchSink += found.size();
+        }));
+        results.push_back(measureBench("search_and_3_terms", size, constantReps, [&](long long) {
+            benchIndex.search("w3 x5 y7", 20, found, alwaysLive);
+            benchSink += found.size();
+        }));
+        results.push_back(measureBench("search_and_no_match", size, linearReps, [&](long long) {
+            benchIndex.search("w3 w4", 20, found, alwaysLive);
+            benchSink += found.size();
+        }));
+        
+        // Keputusan rate limiter (limit tidak pernah tercapai)
+        RateLimiter benchLimiter;
+        benchLimiter.configure(INT_MAX, 60);
+        results.push_back(measureBench("rate_limit_decision", size, constantReps * 10, [&](long long) {
+            long long now = currentTimeMs();
+            if (benchLimiter.allow(now)) {
+                benchLimiter.record(now);
+                benchSink++;
+            }
+        }));
+        
+        // Cek riwayat Bloom filter (window = ukuran)
+        SpamHistory benchHistory;
+        benchHistory.configure(size, 0.01);
+        for (long long i = 0; i < size; i++) {
+            benchHistory.add(hashText(benchText("riwayat", i)));
+        }
+        results.push_back(measureBench("history_check", size, constantReps * 10, [&](long long i) {
+            benchSink += benchHistory.mightContain((unsigned long long)i * 0x9E3779B97F4A7C15ULL);
+        }));
+        
+        // Scan blocklist 1000 frasa (panjang text = ukuran, tidak ada yang cocok)
+        results.push_back(measureBench("blocklist_scan", size, linearReps, [&](long long) {
+            benchSink += benchBlocklist.findFirst(mixedText);
+        }));
+        
+        // Timer wheel berisi `size` jadwal tersebar dalam 1 jam: schedule + cancel
+        // satu jadwal, lalu maju 1 tick (jadwal yang jatuh tempo dijadwalkan ulang)
+        TimerWheel<long long> benchWheel(0);
+        for (long long i = 0; i < size; i++) {
+            benchWheel.schedule(1 + (i * 7919) % 3600000, i);
+        }
+        results.push_back(measureBench("timer_schedule_cancel", size, constantReps * 10, [&](long long i) {
+            benchSink += benchWheel.cancel(benchWheel.schedule(1 + (i * 104729) % 3600000, i));
+        }));
+        long long benchWheelNow = 0;
+        vector<long long> benchFired;
+        results.push_back(measureBench("timer_advance_tick", size, constantReps, [&](long long) {
+            benchWheelNow += TimerWheel<long long>::TICK_MS;
+            benchWheel.advance(benchWheelNow, benchFired);
+            for (size_t j = 0; j < benchFired.size(); j++) {
+                benchWheel.schedule(benchWheelNow + 1 + (benchFired[j] * 7919) % 3600000, benchFired[j]);
+            }
+            benchSink += benchFired.size();
+            benchFired.clear();
+        }));
+    }
+    
+    // Kurva scaling: kemiringan log-log terhadap ukuran sebelumnya
+    map<string, BenchResult> previous;
+    for (int i = 0; i < (int)results.size(); i++) {
+        BenchResult& r = results[i];
+        if (previous.count(r.name) && previous[r.name].nsPerOp > 0 && r.nsPerOp > 0) {
+            BenchResult& p = previous[r.name];
+            r.scaling = log(r.nsPerOp / p.nsPerOp) / log((double)r.size / p.size);
+        }
+        previous[r.name] = r;
+    }
+    
+    if (!json) {
+        printf("benchmark,size,iterations,ns_per_op,allocs_per_op,scaling\n");
+    }
+    for (int i = 0; i < (int)results.size(); i++) {
+        BenchResult& r = results[i];
+        if (json) {
+            printf("{\"benchmark\":\"%s\",\"size\":%lld,\"iterations\":%lld,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"scaling\":%.3f}\n",
+                   r.name.c_str(), r.size, r.iterations, r.nsPerOp, r.allocsPerOp, r.scaling);
+        } else {
+            printf("%s,%lld,%lld,%.2f,%.3f,%.3f\n",
+                   r.name.c_str(), r.size, r.iterations, r.nsPerOp, r.allocsPerOp, r.scaling);
+        }
+    }
+    return 0;
+}
+
+// Mode benchmark multi-chat: mengirim pesan ke banyak chat lewat ChatEngine
+// dengan 1, 2, 4, ... shard untuk melihat scaling throughput terhadap jumlah core
+int runChatBench(int argc, char* argv[]) {
+    long long chatCount = 10000;
+    long long messageCount = 1000000;
+    int maxShards = max(1, (int)thread::hardware_concurrency());
+    int producerCount = 0; // 0 = sama dengan jumlah shard
+    
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--chats") == 0 && i + 1 < argc) {
+            chatCount = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+            messageCount = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            maxShards = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--producers") == 0 && i + 1 < argc) {
+            producerCount = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Argumen tidak dikenal: %s\n", argv[i]);
+            fprintf(stderr, "Pemakaian: wa --chat-bench [--chats N] [--messages N] [--shards N] [--producers N]\n");
+            return 1;
+        }
+    }
+    if (chatCount < 1) chatCount = 1;
+    if (messageCount < 1) messageCount = 1;
+    if (maxShards < 1) maxShards = 1;
+    countAllocations = true;
+    
+    printf("shards,producers,chats,messages,seconds,msgs_per_sec,speedup,allocs_per_msg\n");
+    double baseRate = 0;
+    for (int shardCount = 1; ; shardCount = min(shardCount * 2, maxShards)) {
+        int producers = producerCount > 0 ? producerCount : shardCount;
+        fprintf(stderr, "shard %d...\n", shardCount);
+        
+        double seconds = 0;
+        vector<ChatShardStats> stats;
+        {
+            ChatEngine engine(shardCount);
+            long long start = currentTimeNs();
+            vector<thread> threads;
+            for (int p = 0; p < producers; p++) {
+                threads.push_back(thread([&engine, p, producers, chatCount, messageCount]() {
+                    // Setiap producer mengirim bagian pesannya ke chat acak;
+                    // sekitar 5% perintah adalah forward ke chat lain
+                    unsigned long long rng = 0x9E3779B97F4A7C15ULL * (p + 1);
+                    for (long long i = p; i < messageCount; i += producers) {
+                        rng ^= rng << 13;
+                        rng ^= rng >> 7;
+                        rng ^= rng << 17;
+                        long long chatId = (long long)(rng % chatCount) + 1;
+                        if (rng % 100 < 5) {
+                            long long target = (long long)((rng >> 20) % chatCount) + 1;
+                            engine.forward(chatId, 0, target);
+                        } else {
+                            engine.send(chatId, benchText("chat", i));
+                        }
+                    }
+                }));
+            }
+            for (size_t t = 0; t < threads.size(); t++) {
+                threads[t].join();
+            }
+            engine.flush();
+            seconds = (currentTimeNs() - start) / 1e9;
+            stats = engine.collectStats();
+        }
+        
+        long long accepted = 0;
+        long long allocations = 0;
+        for (size_t i = 0; i < stats.size(); i++) {
+            accepted += stats[i].accepted;
+            allocations += stats[i].allocations;
+        }
+        double rate = seconds > 0 ? messageCount / seconds : 0;
+        if (baseRate == 0) baseRate = rate;
+        printf("%d,%d,%lld,%lld,%.3f,%.0f,%.2f,%.2f\n", shardCount, producers, chatCount, messageCount,
+               seconds, rate, baseRate > 0 ? rate / baseRate : 0, accepted > 0 ? (double)allocations / accepted : 0);
+        fflush(stdout);
+        if (shardCount == maxShards) break;
+    }
+    return 0;
+}
+
+// Stress test reclamation: beberapa thread pembaca terus melakukan scan()
+// sementara thread utama menghapus, membatalkan, undo/redo dan mengirim
+// pesan. Setiap pesan berisi benchText dari ID-nya, jadi node yang dipakai
+// ulang terlalu cepat terlihat sebagai ID/text yang tidak cocok. Paling
+// berguna jika di-compile dengan -fsanitize=thread atau -fsanitize=address
+int runStress(int argc, char* argv[]) {
+    double seconds = 3;
+    int readerCount = 4;
+    int maxSize = 2000;
+    
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--readers") == 0 && i + 1 < argc) {
+            readerCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+            maxSize = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Argumen tidak dikenal: %s\n", argv[i]);
+            fprintf(stderr, "Pemakaian: wa --stress [--seconds N] [--readers N] [--max-size N]\n");
+            return 1;
+        }
+    }
+    if (readerCount < 1) readerCount = 1;
+    if (maxSize < 10) maxSize = 10;
+    
+    QueuePesan queue;
+    queue.setRateLimit(0, 1);
+    queue.setHistoryWindow(0);
+    queue.setSimilarityThreshold(1.0);
+    
+    atomic<bool> stop(false);
+    atomic<long long> scans(0);
+    atomic<long long> visited(0);
+    atomic<long long> errors(0);
+    vector<thread> readers;
+    for (int r = 0; r < readerCount; r++) {
+        readers.push_back(thread([&]() {
+            int slot = queue.attachReader();
+            if (slot < 0) {
+                errors.fetch_add(1);
+                return;
+            }
+            long long localScans = 0, localVisited = 0, localErrors = 0;
+            while (!stop.load(memory_order_relaxed)) {
+                long long previous = 0;
+                queue.scan(slot, [&](long long id, const string& text) {
+                    // ID selalu naik di sepanjang list, text harus milik ID itu
+                    if (id <= previous || text != benchText("Stress", id)) {
+                        localErrors++;
+                    }
+                    previous = id;
+                    localVisited++;
+                });
+                localScans++;
+            }
+            queue.detachReader(slot);
+            scans.fetch_add(localScans);
+            visited.fetch_add(localVisited);
+            errors.fetch_add(localErrors);
+        }));
+    }
+    
+    // Writer: campuran operasi acak, ukuran queue dijaga di sekitar maxSize
+    long long nextId = 1;
+    long long operations = 0;
+    int maxRetired = 0;
+    unsigned long long rng = 0x9E3779B97F4A7C15ULL;
+    long long deadline = currentTimeNs() + (long long)(seconds * 1e9);
+    while (currentTimeNs() < deadline) {
+        for (int batch = 0; batch < 256; batch++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            int choice = rng % 100;
+            if (queue.getSize() > maxSize) {
+                choice = 60 + (choice % 40); // Hanya operasi hapus/undo/redo
+            }
+            if (choice < 60) {
+                if (queue.enqueue(benchText("Stress", nextId))) {
+                    nextId++;
+                }
+            } else if (choice < 70) {
+                queue.dequeue();
+            } else if (choice < 76) {
+                queue.cancelLast();
+            } else if (choice < 79) {
+                queue.dequeue(1 + (int)((rng >> 8) % 8));
+            } else if (choice < 82) {
+                queue.cancelLast(1 + (int)((rng >> 8) % 8));
+            } else if (choice < 90) {
+                long long first = queue.getFirstId();
+                long long last = queue.getLastId();
+                if (last >= first && first > 0) {
+                    queue.removeById(first + (long long)((rng >> 8) % (last - first + 1)));
+                }
+            } else if (choice < 95) {
+                queue.undo();
+            } else {
+                queue.redo();
+            }
+            operations++;
+        }
+        maxRetired = max(maxRetired, queue.getRetiredCount());
+    }
+    stop.store(true);
+    for (size_t r = 0; r < readers.size(); r++) {
+        readers[r].join();
+    }
+    queue.collectRetired();
+    
+    printf("Stress %.1f detik, %d pembaca: %lld operasi writer, %lld scan, %lld node dibaca\n",
+           seconds, readerCount, operations, scans.load(), visited.load());
+    printf("Rantai tertahan maksimal: %d, tersisa setelah selesai: %d, error: %lld\n",
+           maxRetired, queue.getRetiredCount(), errors.load());
+    return errors.load() == 0 && queue.getRetiredCount() == 0 ? 0 : 1;
+}
+
+// Load generator untuk --server: banyak koneksi non-blocking dalam satu loop
+// epoll, masing-masing menjaga sampai --pipeline request tetap terkirim.
+// 1 dari 10 request adalah DEQUEUE 1 pesan, sisanya SEND pesan unik
+int runLoad(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Pemakaian: wa --load <socket> [--connections N] [--requests N] [--pipeline N] [--chat nama]\n");
+        return 1;
+    }
+    const char* path = argv[2];
+    int connectionCount = 64;
+    long long requestCount = 200000;
+    int pipeline = 4;
+    string chatName = "";
+    
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+            connectionCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            requestCount = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) {
+            pipeline = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--chat") == 0 && i + 1 < argc) {
+            chatName = argv[++i];
+        } else {
+            fprintf(stderr, "Argumen tidak dikenal: %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (connectionCount < 1) connectionCount = 1;
+    if (pipeline < 1) pipeline = 1;
+    if (chatName.length() > 255) chatName.resize(255);
+    
+    struct Connection {
+        int fd;
+        string out;
+        size_t outPos;
+        string in;
+        deque<long long> sentNs; // Waktu kirim request yang belum dijawab
+        bool wantWrite;
+    };
+    vector<Connection> connections(connectionCount);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    for (int i = 0; i < connectionCount; i++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            fprintf(stderr, "Tidak bisa terhubung ke %s: %s\n", path, strerror(errno));
+            return 1;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        connections[i].fd = fd;
+        connections[i].outPos = 0;
+        connections[i].wantWrite = false;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    
+    LatencyHistogram latency;
+    long long issued = 0;
+    long long completed = 0;
+    long long statusCounts[SERVER_STATUS_COUNT] = {0, 0, 0, 0};
+    long long counter = currentTimeNs(); // Prefix unik per run agar tidak dianggap duplikat
+    long long start = currentTimeNs();
+    
+    // Isi pipeline koneksi sampai penuh atau semua request sudah dibuat
+    auto refill = [&](Connection& conn) {
+        while ((int)conn.sentNs.size() < pipeline && issued < requestCount) {
+            if (issued % 10 == 9) {
+                unsigned int one = 1;
+                appendServerRequest(conn.out, SERVER_DEQUEUE, chatName, (const char*)&one, 4);
+            } else {
+                string text = benchText("beban", counter++);
+                appendServerRequest(conn.out, SERVER_SEND, chatName, text.data(), text.length());
+            }
+            conn.sentNs.push_back(currentTimeNs());
+            issued++;
+        }
+        while (conn.outPos < conn.out.length()) {
+            ssize_t n = send(conn.fd, conn.out.data() + conn.outPos, conn.out.length() - conn.outPos, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            conn.outPos += n;
+        }
+        if (conn.outPos == conn.out.length()) {
+            conn.out.clear();
+            conn.outPos = 0;
+        }
+        bool wantWrite = !conn.out.empty();
+        if (wantWrite != conn.wantWrite) {
+            struct epoll_event ev;
+            ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+            ev.data.u32 = &conn - &connections[0];
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+            conn.wantWrite = wantWrite;
+        }
+    };
+    
+    for (int i = 0; i < connectionCount; i++) {
+        refill(connections[i]);
+    }
+    struct epoll_event events[256];
+    while (completed < requestCount) {
+        int ready = epoll_wait(epollFd, events, 256, 5000);
+        if (ready <= 0) {
+            fprintf(stderr, "Server tidak merespons\n");
+            return 1;
+        }
+        for (int e = 0; e < ready; e++) {
+            Connection& conn = connections[events[e].data.u32];
+            if (events[e].events & EPOLLIN) {
+                char buf[16384];
+                ssize_t n = read(conn.fd, buf, sizeof(buf));
+                if (n == 0 || (n < 0 && errno != EAGAIN)) {
+                    fprintf(stderr, "Koneksi ditutup server\n");
+                    return 1;
+                }
+                if (n > 0) {
+                    conn.in.append(buf, n);
+                }
+                long long now = currentTimeNs();
+                size_t pos = 0;
+                while (conn.in.length() - pos >= SERVER_RESPONSE_SIZE) {
+                    unsigned char status = conn.in[pos + 4];
+                    statusCounts[status < SERVER_STATUS_COUNT ? status : (unsigned char)SERVER_BAD_REQUEST]++;
+                    latency.record(now - conn.sentNs.front());
+                    conn.sentNs.pop_front();
+                    completed++;
+                    pos += SERVER_RESPONSE_SIZE;
+                }
+                conn.in.erase(0, pos);
+            }
+            refill(conn);
+        }
+    }
+    double seconds = (currentTimeNs() - start) / 1e9;
+    
+    for (int i = 0; i < connectionCount; i++) {
+        close(connections[i].fd);
+    }
+    close(epollFd);
+    
+    printf("koneksi: %d, pipeline: %d, request: %lld dalam %.3f detik (%.0f req/detik)\n",
+           connectionCount, pipeline, completed, seconds, seconds > 0 ? completed / seconds : 0);
+    printf("status: ok %lld, ditolak %lld, tidak ditemukan %lld, salah format %lld\n",
+           statusCounts[SERVER_OK], statusCounts[SERVER_REJECTED], statusCounts[SERVER_NOT_FOUND], statusCounts[SERVER_BAD_REQUEST]);
+    printf("latency: p50 %s, p99 %s, p99.9 %s, max %s\n",
+           formatDuration(latency.percentile(50)).c_str(), formatDuration(latency.percentile(99)).c_str(),
+           formatDuration(latency.percentile(99.9)).c_str(), formatDuration(latency.getMax()).c_str());
+    return 0;
+}
+
+// Satu event replay: byte pertama sebuah key beserta lanjutan escape sequence-nya
+struct ReplayEvent {
+    long long timeUs;
+    string bytes;
+};
+
+// Fungsi untuk membaca file rekaman --record menjadi daftar event
+bool loadRecording(const char* path, vector<ReplayEvent>& events) {
+    FILE* in = fopen(path, "r");
+    if (in == nullptr) {
+        return false;
+    }
+    long long timeUs;
+    char kind;
+    unsigned int byte;
+    while (fscanf(in, "%lld %c %x", &timeUs, &kind, &byte) == 3) {
+        if (kind == 'K' || events.empty()) {
+            ReplayEvent ev;
+            ev.timeUs = timeUs;
+            events.push_back(ev);
+        }
+        events.back().bytes += (char)byte;
+    }
+    fclose(in);
+    return true;
+}
+
+// Fungsi untuk membaca output child sampai penanda frame berikutnya
+// Return jumlah byte output (tanpa penanda), atau -1 jika timeout/child selesai
+long long waitForFrame(int fd, string& pending, int timeoutMs, long long& bytesSeen) {
+    const size_t markerLen = strlen(FRAME_MARKER);
+    long long deadline = currentTimeMs() + timeoutMs;
+    char buf[65536];
+    
+    while (true) {
+        size_t found = pending.find(FRAME_MARKER);
+        if (found != string::npos) {
+            long long bytes = bytesSeen - (long long)(pending.length() - found);
+            pending.erase(0, found + markerLen);
+            bytesSeen = pending.length(); // Sisa setelah penanda milik frame berikutnya
+            return bytes;
+        }
+        // Simpan ekor saja agar penanda yang terpotong tetap ketemu
+        if (pending.length() > markerLen) {
+            pending.erase(0, pending.length() - markerLen);
+        }
+        
+        long long remaining = deadline - currentTimeMs();
+        if (remaining <= 0) {
+            return -1;
+        }
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, (int)remaining) <= 0) {
+            return -1;
+        }
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            return -1; // EIO: child sudah keluar
+        }
+        bytesSeen += n;
+        pending.append(buf, n);
+    }
+}
+
+// Mode replay: menjalankan program ini di pseudo-terminal dan mengirim ulang
+// rekaman --record, lalu mengukur latency keystroke→frame dan byte output per event
+int runReplay(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Pemakaian: wa --replay <rekaman> [--fast]\n");
+        return 1;
+    }
+    bool fast = (argc >= 4 && strcmp(argv[3], "--fast") == 0);
+    
+    vector<ReplayEvent> events;
+    if (!loadRecording(argv[2], events)) {
+        fprintf(stderr, "Tidak bisa membuka rekaman: %s\n", argv[2]);
+        return 1;
+    }
+    
+    char self[4096];
+    ssize_t selfLen = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (selfLen <= 0) {
+        fprintf(stderr, "Tidak bisa menemukan path program\n");
+        return 1;
+    }
+    self[selfLen] = '\0';
+    
+    struct winsize ws;
+    memset(&ws, 0, sizeof(ws));
+    ws.ws_row = 50;
+    ws.ws_col = 120;
+    int master, slave;
+    if (openpty(&master, &slave, nullptr, nullptr, &ws) != 0) {
+        perror("openpty");
+        return 1;
+    }
+    
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        // Child: TUI biasa dengan pty sebagai terminal
+        close(master);
+        setsid();
+        ioctl(slave, TIOCSCTTY, 0);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        close(slave);
+        execl(self, self, "--frame-marker", (char*)nullptr);
+        _exit(127);
+    }
+    close(slave);
+    
+    LatencyHistogram latency;
+    LatencyHistogram outputBytes;
+    long long totalBytes = 0;
+    int framesSeen = 0;
+    int noFrame = 0;
+    string pending;
+    long long bytesSeen = 0;
+    
+    // Tunggu frame pertama (raw mode child sudah aktif)
+    if (waitForFrame(master, pending, 5000, bytesSeen) < 0) {
+        fprintf(stderr, "Program tidak menampilkan frame pertama\n");
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        return 1;
+    }
+    
+    long long replayStart = currentTimeNs();
+    long long lastWriteNs = replayStart;
+    for (int i = 0; i < (int)events.size(); i++) {
+        // Jeda asli dipertahankan (maksimal 600 ms) agar double-click tetap sama
+        if (!fast && i > 0) {
+            long long gapNs = (events[i].timeUs - events[i - 1].timeUs) * 1000;
+            if (gapNs > 600000000LL) gapNs = 600000000LL;
+            long long waitNs = gapNs - (currentTimeNs() - lastWriteNs);
+            if (waitNs > 0) {
+                usleep(waitNs / 1000);
+            }
+        }
+        
+        lastWriteNs = currentTimeNs();
+        if (write(master, events[i].bytes.data(), events[i].bytes.length()) < 0) {
+            break;
+        }
+        long long bytes = waitForFrame(master, pending, 2000, bytesSeen);
+        if (bytes < 0) {
+            noFrame++;
+            continue;
+        }
+        latency.record(currentTimeNs() - lastWriteNs);
+        outputBytes.record(bytes);
+        totalBytes += bytes;
+        framesSeen++;
+    }
+    double elapsedSec = (currentTimeNs() - replayStart) / 1e9;
+    
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+    close(master);
+    
+    printf("=== Ringkasan Replay ===\n");
+    printf("Event: %d (frame: %d, tanpa frame: %d) dalam %.3f detik\n",
+           (int)events.size(), framesSeen, noFrame, elapsedSec);
+    printf("Latency keystroke→frame: p50 %s, p99 %s, max %s\n",
+           formatDuration(latency.percentile(50)).c_str(),
+           formatDuration(latency.percentile(99)).c_str(),
+           formatDuration(latency.getMax()).c_str());
+    printf("Output per event: rata-rata %.0f byte, p50 %lld, p99 %lld, max %lld (total %lld byte)\n",
+           framesSeen > 0 ? (double)totalBytes / framesSeen : 0.0,
+           outputBytes.percentile(50), outputBytes.percentile(99), outputBytes.getMax(), totalBytes);
+    return 0;
+}
+
+// Fungsi untuk memotong text ke maksimal maxBytes tanpa memotong karakter UTF-8
+string truncateText(const string& text, int maxBytes) {
+    if ((int)text.length() <= maxBytes) {
+        return text;
+    }
+    int cut = maxBytes;
+    while (cut > 0 && ((unsigned char)text[cut] & 0xC0) == 0x80) {
+        cut--; // Mundur ke awal karakter UTF-8
+    }
+    return text.substr(0, cut) + "…";
+}
+
+// Fungsi untuk mencari pesan lewat inverted index (Cari Pesan)
+void searchMessages(QueuePesan& queue) {
+    const int SEARCH_LIMIT = 15; // Hasil yang ditampilkan
+    const int INPUT_WIDTH = 40;
+    ClickTracker buttonClicks;
+    bool shouldReturn = false;
+    string query = "";
+    vector<Node*> results;
+    string searchedQuery = "";
+    bool searched = false;
+    long long searchNs = 0;
+    int focusArea = 0; // 0 = input, 1 = tombol kembali
+    long long seenChanges = externalChangeCount();
+    
+    while (!shouldReturn) {
+        if (externalChangeCount() != seenChanges) {
+            if (searched) {
+                queue.search(searchedQuery, SEARCH_LIMIT, results); // Node lama mungkin sudah dihapus
+            }
+            seenChanges = externalChangeCount();
+        }
+        clearScreen();
+        displayHeader();
+        
+        gotoxy(10, 5);
+        setColor(33);
+        printf("═══════════════════ CARI PESAN ═══════════════════");
+        resetColor();
+        
+        gotoxy(10, 7);
+        printf("Kata kunci (semua kata harus ada):");
+        gotoxy(10, 8);
+        if (focusArea == 0) {
+            setColor(47); setColor(30); // Highlight area input
+        } else {
+            setColor(37);
+        }
+        string visible = query.length() >= INPUT_WIDTH ? query.substr(query.length() - INPUT_WIDTH + 1) : query;
+        printf("%s%s", visible.c_str(), focusArea == 0 ? "│" : " ");
+        for (int i = visible.length() + 1; i < INPUT_WIDTH; i++) {
+            printf(" ");
+        }
+        resetColor();
+        regions.add(WIDGET_TEXT_INPUT, 10, 8, INPUT_WIDTH, 1);
+        
+        int y = 10;
+        if (searched) {
+            gotoxy(10, y);
+            setColor(36);
+            if (results.empty()) {
+                printf("Tidak ada pesan yang cocok (%s)", formatDuration(searchNs).c_str());
+            } else {
+                printf("%d hasil%s (%s)", (int)results.size(),
+                       (int)results.size() >= SEARCH_LIMIT ? " terbaru" : "", formatDuration(searchNs).c_str());
+            }
+            resetColor();
+            y += 2;
+            
+            for (int i = 0; i < (int)results.size(); i++) {
+                const Pesan& pesan = results[i]->data;
+                string firstLine = pesan.text.substr(0, findNewline(pesan.text, 0));
+                if (firstLine.length() < pesan.text.length()) {
+                    firstLine += " ↵";
+                }
+                gotoxy(10, y++);
+                setColor(pesan.isRead ? 37 : 32);
+                printf("[%c] #%lld: %s", pesan.isRead ? 'v' : '-', pesan.id, truncateText(firstLine, 60).c_str());
+                resetColor();
+            }
+            y++;
+        }
+        
+        // Tombol kembali
+        int buttonY = y + 1;
+        if (focusArea == 1) {
+            setColor(47); setColor(30);
+        } else {
+            setColor(37);
+        }
+        gotoxy(10, buttonY);
+        printf("╔════════════════════╗");
+        gotoxy(10, buttonY + 1);
+        printf("║  [← KEMBALI]       ║");
+        gotoxy(10, buttonY + 2);
+        printf("╚════════════════════╝");
+        resetColor();
+        regions.add(WIDGET_BACK, 10, buttonY, 22, 3);
+        
+        gotoxy(10, buttonY + 4);
+        setColor(36);
+        if (focusArea == 0) {
+            printf("Ketik kata kunci lalu Enter | ↓ tombol");
+        } else {
+            printf("Enter/Klik 2x untuk kembali | ↑ input");
+        }
+        resetColor();
+        fflush(stdout);
+        
+        // Read input
+        char c;
+        bool runSearch = false;
+        if (readKey(&c) == 1) {
+            ScopedLatency decodeTimer(STAT_INPUT_DECODE);
+            if (c == '\033') { // ESC sequence
+                char seq[2];
+                if (readInput(&seq[0]) == 1 && seq[0] == '[' && readInput(&seq[1]) == 1) {
+                    if (seq[1] == 'A') { // Up arrow
+                        focusArea = 0;
+                    } else if (seq[1] == 'B') { // Down arrow
+                        focusArea = 1;
+                    } else if (seq[1] == '<') { // Mouse input
+                        MouseEvent ev;
+                        if (readMouseEvent(ev) && ev.pressed && ev.button == 0) {
+                            int widget = regions.hitTest(ev.x, ev.y);
+                            if (widget == WIDGET_TEXT_INPUT) {
+                                focusArea = 0;
+                            } else if (widget == WIDGET_BACK) {
+                                focusArea = 1;
+                                if (buttonClicks.click(WIDGET_BACK)) {
+                                    shouldReturn = true;
+                                }
+                            }
+                        }
+                    }
+                }
+            } else if (c == '\n' || c == '\r') { // Enter key
+                if (focusArea == 1) {
+                    shouldReturn = true;
+                } else {
+                    runSearch = true;
+                }
+            } else if (focusArea == 0 && (c == 127 || c == 8)) { // Backspace
+                if (!query.empty()) {
+                    // Hapus satu karakter UTF-8 utuh
+                    size_t cut = query.length() - 1;
+                    while (cut > 0 && ((unsigned char)query[cut] & 0xC0) == 0x80) cut--;
+                    query.erase(cut);
+                }
+            } else if (focusArea == 0 && ((unsigned char)c >= 32 || c == '\t')) {
+                query += c;
+            }
+        }
+        
+        if (runSearch) {
+            long long t0 = currentTimeNs();
+            queue.search(query, SEARCH_LIMIT, results);
+            searchNs = currentTimeNs() - t0;
+            searchedQuery = query;
+            searched = true;
+        }
+    }
+}
+
+// Fungsi untuk menampilkan statistik latency dan riwayat spam filter
+void displayStats(QueuePesan& queue) {
+    ClickTracker buttonClicks;
+    bool shouldReturn = false;
+    
+    while (!shouldReturn) {
+        clearScreen();
+        displayHeader();
+        
+        gotoxy(10, 5);
+        setColor(33);
+        printf("═══════════════════ STATISTIK ═══════════════════");
+        resetColor();
+        
+        int y = 7;
+        if (!statsEnabled) {
+            gotoxy(10, y);
+            setColor(31);
+            printf("Statistik nonaktif. Jalankan dengan: ./wa --stats");
+            resetColor();
+            y += 2;
+        } else {
+            gotoxy(10, y);
+            setColor(36);
+            printf("%-14s %10s %12s %12s %12s", "Operasi", "Jumlah", "p50", "p99", "Max");
+            resetColor();
+            y++;
+            
+            LatencyHistogram h;
+            for (int i = 0; i < STAT_COUNT; i++) {
+                statSnapshot((StatId)i, h);
+                gotoxy(10, y);
+                printf("%-14s %10lld %12s %12s %12s", STAT_NAMES[i], h.getCount(),
+                       formatDuration(h.percentile(50)).c_str(),
+                       formatDuration(h.percentile(99)).c_str(),
+                       formatDuration(h.getMax()).c_str());
+                y++;
+            }
+            y++;
+        }
+        
+        // Riwayat Bloom filter selalu aktif, tidak tergantung --stats
+        const SpamHistory& history = queue.getHistory();
+        gotoxy(10, y);
+        if (history.isEnabled()) {
+            printf("Riwayat spam: %lld pesan diingat (window %lld), %d hash, %zu KB, FPR ~%.3f%%",
+                   history.getRemembered(), history.getWindow(), history.getHashCount(),
+                   history.getMemoryBytes() / 1024, history.estimatedFpr() * 100.0);
+        } else {
+            printf("Riwayat spam: nonaktif");
+        }
+        y++;
+        
+        if (tuiDelivery != nullptr) {
+            gotoxy(10, y);
+            printf("Delivery: %lld dikirim, %lld diterima (✓✓), %d di jaringan, %d antre (backpressure)",
+                   tuiDelivery->getSubmitted(), tuiDelivery->getDelivered(),
+                   tuiDelivery->getInFlight(), tuiDelivery->getBacklog());
+            y++;
+        }
+        
+        if (tuiIngest != nullptr) {
+            gotoxy(10, y);
+            printf("Ingest: %lld dibaca, %lld masuk, %lld ditolak filter, ring penuh %lld kali",
+                   tuiIngest->getProduced(), tuiIngest->getAccepted(),
+                   tuiIngest->getRejected(), tuiIngest->getStalls());
+            y++;
+        }
+        
+        if (tuiScheduler != nullptr) {
+            gotoxy(10, y);
+            printf("Terjadwal: %d menunggu, %lld terkirim, %lld ditolak filter",
+                   tuiScheduler->getPending(), tuiScheduler->getSent(), tuiScheduler->getRejected());
+            y++;
+        }
+        
+        gotoxy(10, y);
+        printf("Lane prioritas: %d darurat, %d mention, %d normal (bobot dequeue %d:%d:%d)",
+               queue.getLaneSize(PRIORITY_ALERT), queue.getLaneSize(PRIORITY_MENTION),
+               queue.getLaneSize(PRIORITY_NORMAL), LANE_WEIGHTS[PRIORITY_ALERT],
+               LANE_WEIGHTS[PRIORITY_MENTION], LANE_WEIGHTS[PRIORITY_NORMAL]);
+        y++;
+        
+        if (tuiChats != nullptr) {
+            gotoxy(10, y);
+            printf("Kedaluwarsa (TTL): %lld pesan di chat ini, %lld di semua chat",
+                   queue.getExpiredCount(), tuiChats->getExpiredTotal());
+            y++;
+        }
+        
+        shouldReturn = displayBackButton(y + 1, buttonClicks);
+    }
+}
+
+// Fungsi untuk menampilkan daftar chat (terbaru di atas). Hanya baris yang
+// terlihat yang digambar: posisi scroll disimpan sebagai pointer ke chat
+// paling atas, jadi biaya per frame O(baris) berapa pun jumlah chat
+void chatListScreen(ChatList& chats, Conversation*& active) {
+    const int VISIBLE_ROWS = 12;
+    ClickTracker rowClicks;
+    bool shouldReturn = false;
+    string newName = "";
+    Conversation* top = chats.getNewest();      // Chat di baris pertama layar
+    Conversation* selected = top;
+    int selectedRow = 0;                        // Baris selected di layar
+    int position = 0;                           // Urutan selected di seluruh daftar
+    
+    // Geser pilihan satu baris; viewport ikut bergeser di tepi layar
+    auto moveDown = [&]() {
+        if (selected == nullptr || selected->older == nullptr) return;
+        selected = selected->older;
+        position++;
+        if (++selectedRow >= VISIBLE_ROWS) {
+            top = top->older;
+            selectedRow--;
+        }
+    };
+    auto moveUp = [&]() {
+        if (selected == nullptr || selected->newer == nullptr) return;
+        selected = selected->newer;
+        position--;
+        if (--selectedRow < 0) {
+            top = top->newer;
+            selectedRow = 0;
+        }
+    };
+    
+    long long seenChanges = externalChangeCount();
+    
+    while (!shouldReturn) {
+        if (externalChangeCount() != seenChanges) {
+            // Urutan berubah lewat server: hitung ulang posisi dan baris pilihan
+            seenChanges = externalChangeCount();
+            position = 0;
+            for (Conversation* chat = selected; chat->newer != nullptr; chat = chat->newer) position++;
+            selectedRow = -1;
+            Conversation* chat = top;
+            for (int row = 0; row < VISIBLE_ROWS && chat != nullptr; row++, chat = chat->older) {
+                if (chat == selected) selectedRow = row;
+            }
+            if (selectedRow < 0) {
+                top = selected;
+                selectedRow = 0;
+            }
+        }
+        clearScreen();
+        displayHeader();
+        
+        gotoxy(10, 5);
+        setColor(33); // Kuning
+        printf("═══════════════════ DAFTAR CHAT ═══════════════════");
+        resetColor();
+        
+        int y = 7;
+        Conversation* chat = top;
+        for (int row = 0; row < VISIBLE_ROWS && chat != nullptr; row++, chat = chat->older) {
+            gotoxy(10, y);
+            if (chat == selected) {
+                setColor(47); setColor(30);
+                printf("> ");
+            } else {
+                printf("  ");
+            }
+            printf("%-20s", truncateText(chat->name, 20).c_str());
+            if (chat->group != nullptr) {
+                printf(" [grup %d]", chat->group->getMemberCount());
+            }
+            int unread = chat->queue.getUnreadCount();
+            if (unread > 0) {
+                if (chat != selected) setColor(32);
+                printf(" (%d)", unread);
+                if (chat != selected) resetColor();
+            }
+            Node* last = chat->queue.getRear();
+            if (last != nullptr) {
+                const string& text = last->data.text;
+                printf("  %s", truncateText(text.substr(0, findNewline(text, 0)), 30).c_str());
+            }
+            if (chat != selected) setColor(90);
+            printf("  %s", formatAge(chat->lastActivityMs).c_str());
+            resetColor();
+            regions.add(WIDGET_CHAT_ROW + row, 10, y, 70, 1);
+            y++;
+        }
+        
+        y++;
+        gotoxy(10, y);
+        setColor(36);
+        printf("Chat %d dari %d | Aktif: %s", position + 1, chats.getCount(), active->name.c_str());
+        resetColor();
+        
+        gotoxy(10, y + 2);
+        printf("Chat baru: ");
+        setColor(47); setColor(30);
+        printf("%s│", newName.c_str());
+        resetColor();
+        
+        gotoxy(10, y + 4);
+        setColor(36);
+        printf("↑↓ PgUp PgDn pilih | Enter/Klik 2x buka | Ketik nama lalu Enter untuk chat baru");
+        resetColor();
+        fflush(stdout);
+        
+        // Read input
+        char c;
+        if (readKey(&c) == 1) {
+            ScopedLatency decodeTimer(STAT_INPUT_DECODE);
+            if (c == '\033') { // ESC sequence
+                char seq[3];
+                if (readInput(&seq[0]) == 1 && seq[0] == '[' && readInput(&seq[1]) == 1) {
+                    if (seq[1] == 'A') { // Up arrow
+                        moveUp();
+                    } else if (seq[1] == 'B') { // Down arrow
+                        moveDown();
+                    } else if ((seq[1] == '5' || seq[1] == '6') && readInput(&seq[2]) == 1 && seq[2] == '~') {
+                        for (int i = 0; i < VISIBLE_ROWS; i++) { // Page Up / Page Down
+                            if (seq[1] == '5') moveUp(); else moveDown();
+                        }
+                    } else if (seq[1] == '<') { // Mouse input
+                        MouseEvent ev;
+                        if (readMouseEvent(ev) && ev.pressed) {
+                            int widget = regions.hitTest(ev.x, ev.y);
+                            if (ev.button == 64) { // Scroll ke atas
+                                moveUp();
+                            } else if (ev.button == 65) { // Scroll ke bawah
+                                moveDown();
+                            } else if (ev.button == 0 && widget >= WIDGET_CHAT_ROW && widget < WIDGET_CHAT_ROW + VISIBLE_ROWS) {
+                                int row = widget - WIDGET_CHAT_ROW;
+                                while (selectedRow < row) moveDown();
+                                while (selectedRow > row) moveUp();
+                                if (rowClicks.click(widget)) {
+                                    active = selected;
+                                    shouldReturn = true;
                                 }
-                                marked = true;
-                            } else {
-                                input = "INVALID";
-                                marked = true;
                             }
-                        } else {
-                            // Kembali
-                            shouldReturn = true;
                         }
                     }
-                } else if (c == 127 || c == 8) { // Backspace
-                    if (focusArea == 0) {
-                        if (selectionStart != -1 && selectionEnd != -1 && selectionStart != selectionEnd) {
-                            // Ada seleksi, hapus text yang diselect
-                            int selStart = selectionStart < selectionEnd ? selectionStart : selectionEnd;
-                            int selEnd = selectionStart < selectionEnd ? selectionEnd : selectionStart;
-                            input.erase(selStart, selEnd - selStart);
-                            cursorPos = selStart;
-                            selectionStart = -1;
-                            selectionEnd = -1;
-                        } else {
-                            // Tidak ada seleksi, hapus 1 karakter sebelum cursor
-                            if (cursorPos > 0) {
-                                input.erase(cursorPos - 1, 1);
-                                cursorPos--;
+                }
+            } else if (c == '\n' || c == '\r') { // Enter key
+                if (!isEmptyOrWhitespace(newName)) {
+                    active = chats.open(newName);
+                } else if (selected != nullptr) {
+                    active = selected;
+                }
+                shouldReturn = true;
+            } else if (c == 127 || c == 8) { // Backspace
+                if (!newName.empty()) {
+                    size_t cut = newName.length() - 1;
+                    while (cut > 0 && ((unsigned char)newName[cut] & 0xC0) == 0x80) cut--;
+                    newName.erase(cut);
+                }
+            } else if ((unsigned char)c >= 32) {
+                newName += c;
+            }
+        }
+    }
+}
+
+// Fungsi untuk menampilkan pesan terjadwal terdekat dan membatalkannya
+void scheduledScreen() {
+    const int VISIBLE_ROWS = 12;
+    ClickTracker buttonClicks;
+    bool shouldReturn = false;
+    int selectedRow = 0;
+    string lastAction = "";
+    vector<const ScheduledMessage*> messages;
+    vector<long long> dueMs;
+
+    secondTicker = true; // Sisa waktu ikut berjalan walau tidak ada key
+    while (!shouldReturn) {
+        tuiScheduler->upcoming(VISIBLE_ROWS, messages, dueMs);
+        if (selectedRow >= (int)messages.size()) {
+            selectedRow = max(0, (int)messages.size() - 1);
+        }
+
+        clearScreen();
+        displayHeader();
+
+        gotoxy(10, 5);
+        setColor(33); // Kuning
+        printf("═════════════════ PESAN TERJADWAL ═════════════════");
+        resetColor();
+
+        int y = 7;
+        if (messages.empty()) {
+            gotoxy(10, y++);
+            setColor(37);
+            printf("Tidak ada pesan terjadwal.");
+            resetColor();
+        }
+        long long now = currentTimeMs();
+        for (int row = 0; row < (int)messages.size(); row++) {
+            const ScheduledMessage* message = messages[row];
+            gotoxy(10, y++);
+            if (row == selectedRow) {
+                setColor(47); setColor(30);
+                printf("> ");
+            } else {
+                printf("  ");
+            }
+            string in = "dalam " + formatDelay(max(0LL, dueMs[row] - now));
+            printf("#%-4lld %-18s %-16s", message->id, in.c_str(), truncateText(message->chat->name, 16).c_str());
+            printf("  %s", truncateText(message->text.substr(0, findNewline(message->text, 0)), 30).c_str());
+            resetColor();
+        }
+        if (tuiScheduler->getPending() > (int)messages.size()) {
+            gotoxy(10, y++);
+            setColor(37);
+            printf("... dan %d jadwal lainnya", tuiScheduler->getPending() - (int)messages.size());
+            resetColor();
+        }
+
+        y++;
+        gotoxy(10, y);
+        setColor(36);
+        printf("Menunggu: %d | Terkirim: %lld | Ditolak filter: %lld",
+               tuiScheduler->getPending(), tuiScheduler->getSent(), tuiScheduler->getRejected());
+        resetColor();
+        if (!lastAction.empty()) {
+            gotoxy(10, y + 1);
+            setColor(32);
+            printf("%s", lastAction.c_str());
+            resetColor();
+        }
+
+        drawBackButton(y + 3);
+        gotoxy(10, y + 7);
+        setColor(36);
+        printf("↑↓ pilih | x batalkan jadwal | Enter/Klik 2x untuk kembali");
+        resetColor();
+        fflush(stdout);
+
+        // Read input
+        char c;
+        if (readKey(&c) == 1) {
+            ScopedLatency decodeTimer(STAT_INPUT_DECODE);
+            if (c == '\033') { // ESC sequence
+                char seq[2];
+                if (readInput(&seq[0]) == 1 && seq[0] == '[' && readInput(&seq[1]) == 1) {
+                    if (seq[1] == 'A') { // Up arrow
+                        if (selectedRow > 0) selectedRow--;
+                    } else if (seq[1] == 'B') { // Down arrow
+                        if (selectedRow + 1 < (int)messages.size()) selectedRow++;
+                    } else if (seq[1] == '<') { // Mouse input
+                        MouseEvent ev;
+                        if (readMouseEvent(ev) && ev.pressed && ev.button == 0) {
+                            if (regions.hitTest(ev.x, ev.y) == WIDGET_BACK && buttonClicks.click(WIDGET_BACK)) {
+                                shouldReturn = true;
                             }
                         }
                     }
-                } else if (c >= 32 && c <= 126) { // Printable characters
-                    if (focusArea == 0) {
-                        if (selectionStart != -1 && selectionEnd != -1 && selectionStart != selectionEnd) {
-                            // Ada seleksi, replace dengan karakter baru
-                            int selStart = selectionStart < selectionEnd ? selectionStart : selectionEnd;
-                            int selEnd = selectionStart < selectionEnd ? selectionEnd : selectionStart;
-                            input.erase(selStart, selEnd - selStart);
-                            input.insert(selStart, 1, c);
-                            cursorPos = selStart + 1;
-                            selectionStart = -1;
-                            selectionEnd = -1;
-                        } else {
-                            // Insert karakter di posisi cursor
-                            input.insert(cursorPos, 1, c);
-                            cursorPos++;
-                        }
-                    }
                 }
-            }
-        } else {
-            // Confirmation
-            gotoxy(10, 7);
-            if (input == "INVALID") {
-                setColor(31);
-                printf("✗ Input tidak valid! Format: 1 atau 1,3 atau 1-3 atau all");
-            } else {
-                setColor(32);
-                if (markedCount == queue.getSize()) {
-                    printf("✓ Semua %d pesan berhasil ditandai sebagai dibaca!", markedCount);
-                } else if (markedCount > 1) {
-                    printf("✓ %d pesan berhasil ditandai sebagai dibaca!", markedCount);
-                } else {
-                    printf("✓ 1 pesan berhasil ditandai sebagai dibaca!");
+            } else if (c == '\n' || c == '\r') { // Enter key
+                shouldReturn = true;
+            } else if ((c == 'x' || c == 'X') && selectedRow < (int)messages.size()) {
+                long long id = messages[selectedRow]->id;
+                if (tuiScheduler->cancel(id)) {
+                    lastAction = "✓ Jadwal #" + to_string(id) + " dibatalkan";
                 }
             }
-            resetColor();
-            
-            shouldReturn = displayBackButton(9, lastClickedButton, lastClickTime);
         }
     }
+    secondTicker = false;
+}
+
+// Fungsi untuk menjalankan menu yang dipilih
+// Return false jika user memilih Keluar
+bool executeMenu(int selected, ChatList& chats, Conversation*& active) {
+    QueuePesan& queue = active->queue;
+    switch (selected) {
+        case 0: // Tambah Pesan
+            inputNewMessage(*active);
+            break;
+        case 1: // Hapus Pesan Berikutnya
+            deleteFirstMessage(queue);
+            break;
+        case 2: // Batalkan Pesan Terakhir
+            cancelLastMessage(queue);
+            break;
+        case 3: // Lihat Semua Pesan
+            displayMessages(queue, active->group.get());
+            break;
+        case 4: // Tandai Sebagai Dibaca
+            markMessageAsRead(queue);
+            break;
+        case 5: // Statistik
+            displayStats(queue);
+            break;
+        case 6: // Cari Pesan
+            searchMessages(queue);
+            break;
+        case 7: // Daftar Chat
+            chatListScreen(chats, active);
+            break;
+        case 8: // Pesan Terjadwal
+            scheduledScreen();
+            break;
+        case 9: // Keluar
+            return false;
+    }
+    return true;
+}
+
+// Mode server tanpa TUI (--server <path> --no-tui): layani request sampai
+// SIGINT/SIGTERM, lalu cetak ringkasan
+volatile sig_atomic_t serverStopRequested = 0;
+
+void requestServerStop(int) {
+    serverStopRequested = 1;
+}
+
+int runHeadlessServer(ChatServer& server, const char* statsFile) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = requestServerStop; // Tanpa SA_RESTART: epoll_wait kembali dengan EINTR
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    
+    fprintf(stderr, "Server berjalan, Ctrl+C untuk berhenti\n");
+    tuiServer = &server;
+    while (!serverStopRequested) {
+        serviceBackground(false, -1);
+    }
+    tuiServer = nullptr;
+    tuiDelivery = nullptr;
+    tuiIngest = nullptr;
+    tuiScheduler = nullptr;
+    tuiChats = nullptr;
+    fprintf(stderr, "Server berhenti: %lld request, %lld perubahan\n",
+            server.getRequestCount(), server.getChangeCount());
+    if (statsFile != nullptr && !dumpStats(statsFile)) {
+        fprintf(stderr, "Gagal menyimpan statistik ke %s\n", statsFile);
+    }
+    return 0;
 }
 
 // Main function
-int main() {
-    QueuePesan queue;
+int main(int argc, char* argv[]) {
+    // Mode non-interaktif: wa --batch [script.txt]  (tanpa file = baca dari stdin)
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        return runBatch(argc >= 3 ? argv[2] : nullptr);
+    }
+    
+    // Micro-benchmark: wa --bench [--max-size N] [--format csv|json]
+    if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+        return runBench(argc, argv);
+    }
+    
+    // Benchmark banyak chat: wa --chat-bench [--chats N] [--messages N] [--shards N] [--producers N]
+    if (argc >= 2 && strcmp(argv[1], "--chat-bench") == 0) {
+        return runChatBench(argc, argv);
+    }
+    
+    // Stress test scan bersamaan dengan hapus: wa --stress [--seconds N] [--readers N] [--max-size N]
+    if (argc >= 2 && strcmp(argv[1], "--stress") == 0) {
+        return runStress(argc, argv);
+    }
+    
+    // Load generator untuk --server: wa --load <socket> [--connections N] [--requests N] [--pipeline N]
+    if (argc >= 2 && strcmp(argv[1], "--load") == 0) {
+        return runLoad(argc, argv);
+    }
+    
+    // Replay rekaman sesi lewat pseudo-terminal: wa --replay <rekaman> [--fast]
+    if (argc >= 2 && strcmp(argv[1], "--replay") == 0) {
+        return runReplay(argc, argv);
+    }
+    
+    // Opsi TUI: --stats (catat latency), --stats-file <path> (simpan saat keluar),
+    // --similarity <0..1> (ambang pesan mirip, 1 = hanya duplikat persis),
+    // --blocklist <path> (frasa terlarang, di-reload otomatis saat file berubah),
+    // --history <n> (window riwayat pesan terkirim, 0 = nonaktif),
+    // --rate-limit <n>[/detik] (maksimal n pesan per window, 0 = nonaktif),
+    // --demo-chats <n> (isi daftar chat dengan n kontak contoh),
+    // --server <path> (terima request lewat Unix socket), --no-tui (server saja),
+    // --delivery-delay <ms> (rata-rata delay simulasi jaringan sampai ✓✓),
+    // --demo-group <n> (chat grup contoh dengan n anggota),
+    // --ingest <file|gen:n> (pesan masuk di background dari file yang di-tail
+    // atau generator n pesan/detik), --ingest-chat <nama> (chat tujuan, default
+    // "Feed"), --fps <n> (batas frame rate redraw karena update background),
+    // --ttl <durasi> (pesan di setiap chat hilang setelah durasi, mis. 30s / 5m)
+    const char* statsFile = nullptr;
+    const char* ingestSource = nullptr;
+    const char* ingestChat = "Feed";
+    int demoGroupMembers = 0;
+    int deliveryDelayMs = 500;
+    const char* serverPath = nullptr;
+    bool noTui = false;
+    int rateLimit = 10;
+    int rateWindow = 10;
+    long long historyWindow = 10000;
+    Blocklist blocklist;
+    bool useBlocklist = false;
+    double similarityThreshold = 0.8;
+    int demoChats = 0;
+    long long ttlMs = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            statsFile = argv[++i];
+            statsEnabled = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = fopen(argv[++i], "w");
+            if (recordFile == nullptr) {
+                fprintf(stderr, "Tidak bisa membuat file rekaman: %s\n", argv[i]);
+                return 1;
+            }
+            setvbuf(recordFile, nullptr, _IOLBF, 0); // Tetap tersimpan jika program dihentikan paksa
+            recordStartNs = currentTimeNs();
+        } else if (strcmp(argv[i], "--similarity") == 0 && i + 1 < argc) {
+            similarityThreshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rate-limit") == 0 && i + 1 < argc) {
+            rateWindow = 1;
+            sscanf(argv[++i], "%d/%d", &rateLimit, &rateWindow);
+        } else if (strcmp(argv[i], "--history") == 0 && i + 1 < argc) {
+            historyWindow = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--blocklist") == 0 && i + 1 < argc) {
+            if (!blocklist.load(argv[++i])) {
+                fprintf(stderr, "Tidak bisa membuka blocklist: %s\n", argv[i]);
+                return 1;
+            }
+            useBlocklist = true;
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            serverPath = argv[++i];
+        } else if (strcmp(argv[i], "--delivery-delay") == 0 && i + 1 < argc) {
+            deliveryDelayMs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-tui") == 0) {
+            noTui = true;
+        } else if (strcmp(argv[i], "--demo-group") == 0 && i + 1 < argc) {
+            demoGroupMembers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--demo-chats") == 0 && i + 1 < argc) {
+            demoChats = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ingest") == 0 && i + 1 < argc) {
+            ingestSource = argv[++i];
+        } else if (strcmp(argv[i], "--ingest-chat") == 0 && i + 1 < argc) {
+            ingestChat = argv[++i];
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            frameIntervalMs = 1000 / max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--ttl") == 0 && i + 1 < argc) {
+            ttlMs = parseDelayMs(argv[++i]);
+            if (ttlMs < 0) {
+                fprintf(stderr, "Format --ttl tidak valid: %s (contoh: 30s, 5m, 1j30m)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--frame-marker") == 0) {
+            emitFrameMarker = true; // Dipakai oleh --replay
+        }
+    }
+    
+    // Setiap chat memakai pengaturan filter yang sama
+    ChatList chats([&](QueuePesan& queue) {
+        queue.setTtl(ttlMs);
+        queue.setSimilarityThreshold(similarityThreshold);
+        queue.setHistoryWindow(historyWindow);
+        queue.setRateLimit(rateLimit, rateWindow);
+        if (useBlocklist) {
+            queue.setBlocklist(&blocklist);
+        }
+    });
+    if (useBlocklist) {
+        blocklist.startWatch(1000);
+    }
+    // Setiap pesan baru (dari keyboard maupun server) masuk pipeline delivery
+    DeliveryPipeline delivery(deliveryDelayMs);
+    chats.setMessageListener([&](Conversation* chat) {
+        delivery.submit(&chat->queue, chat->queue.getLastId());
+    });
+    tuiDelivery = &delivery;
+    // Pesan terjadwal (tombol Jadwal) dikirim dari loop event yang sama
+    MessageScheduler scheduler(currentTimeMs());
+    tuiScheduler = &scheduler;
+    tuiChats = &chats;
+    for (int i = 1; i <= demoChats; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "Kontak %d", i);
+        chats.open(name)->queue.enqueue(string("Halo dari ") + name);
+    }
+    if (demoGroupMembers > 0) {
+        // Grup contoh: setiap anggota sudah membaca sampai pesan acak,
+        // sebagian juga membaca satu pesan setelahnya
+        Conversation* group = chats.openGroup("Grup Demo", demoGroupMembers);
+        for (int i = 1; i <= 10; i++) {
+            group->queue.enqueue(benchText("Pengumuman", i));
+        }
+        unsigned long long rng = 0x9E3779B97F4A7C15ULL;
+        for (int m = 0; m < demoGroupMembers; m++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            long long upTo = rng % 11;
+            group->group->markReadUpTo(m, upTo);
+            if (upTo < 10 && (rng >> 8) % 4 == 0) {
+                group->group->markRead(m, group->queue.findById(upTo + 2 <= 10 ? upTo + 2 : 10));
+            }
+        }
+    }
+    Conversation* active = chats.open("Chat Saya");
+    
+    // Pesan dari sumber ingest masuk ke chat sendiri (tanpa rate limit: bukan
+    // pesan yang diketik pengguna) dan chat itu langsung dibuka
+    Ingestor ingest;
+    if (ingestSource != nullptr) {
+        active = chats.open(ingestChat);
+        active->queue.setRateLimit(0, 1);
+        string error;
+        if (!ingest.start(ingestSource, &active->queue, error)) {
+            fprintf(stderr, "Tidak bisa membuka sumber ingest %s: %s\n", ingestSource, error.c_str());
+            return 1;
+        }
+        tuiIngest = &ingest;
+    }
+    
+    ChatServer server(chats, active);
+    if (serverPath != nullptr) {
+        string error;
+        if (!server.start(serverPath, error)) {
+            fprintf(stderr, "Tidak bisa membuka server di %s: %s\n", serverPath, error.c_str());
+            return 1;
+        }
+        if (noTui) {
+            return runHeadlessServer(server, statsFile);
+        }
+        tuiServer = &server;
+    }
     int selectedMenu = 0;
     bool running = true;
+    string lastAction = ""; // Hasil undo/redo terakhir (ditampilkan sekali)
     
     // Variables for double-click detection
-    int lastClickedMenu = -1;
-    time_t lastClickTime = 0;
-    const int DOUBLE_CLICK_THRESHOLD = 500; // milliseconds
+    ClickTracker menuClicks;
     
     enableRawMode();
     enableMouseTracking();
@@ -2081,74 +10142,38 @@ int main() {
     while (running) {
         clearScreen();
         displayHeader();
+        displayActiveChat(*active);
         displayMenu(selectedMenu);
+        QueuePesan& queue = active->queue;
+        displayUndoStatus(queue, lastAction);
+        lastAction = "";
         
         // Read input
         char c;
-        if (read(STDIN_FILENO, &c, 1) == 1) {
+        bool execute = false;
+        if (readKey(&c) == 1) {
+            ScopedLatency decodeTimer(STAT_INPUT_DECODE);
             if (c == '\033') { // ESC sequence
                 char seq[5];
-                if (read(STDIN_FILENO, &seq[0], 1) == 1) {
+                if (readInput(&seq[0]) == 1) {
                     if (seq[0] == '[') {
-                        if (read(STDIN_FILENO, &seq[1], 1) == 1) {
+                        if (readInput(&seq[1]) == 1) {
                             // Arrow keys
                             if (seq[1] == 'A') { // Up arrow
-                                selectedMenu = (selectedMenu - 1 + 6) % 6;
+                                selectedMenu = (selectedMenu - 1 + MENU_COUNT) % MENU_COUNT;
                             } else if (seq[1] == 'B') { // Down arrow
-                                selectedMenu = (selectedMenu + 1) % 6;
+                                selectedMenu = (selectedMenu + 1) % MENU_COUNT;
                             } else if (seq[1] == '<') { // Mouse input
-                                char mouseData[20];
-                                int idx = 0;
-                                while (read(STDIN_FILENO, &mouseData[idx], 1) == 1 && mouseData[idx] != 'M' && mouseData[idx] != 'm') {
-                                    idx++;
-                                }
-                                
-                                // Parse mouse coordinates (simplified)
-                                // Format: <0;x;yM or <0;x;ym
-                                if (mouseData[idx] == 'M') { // Mouse click
-                                    // Extract y coordinate roughly
-                                    int mouseY = 0;
-                                    sscanf(mouseData, "%*d;%*d;%d", &mouseY);
-                                    
-                                    // Map mouse Y to menu item (menu starts at Y=6, each item is 1 line)
-                                    if (mouseY >= 6 && mouseY <= 11) {
-                                        int clickedMenu = mouseY - 6;
-                                        selectedMenu = clickedMenu;
-                                        
-                                        // Double-click detection
-                                        struct timespec ts;
-                                        clock_gettime(CLOCK_MONOTONIC, &ts);
-                                        time_t currentTime = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+                                MouseEvent ev;
+                                if (readMouseEvent(ev) && ev.pressed && ev.button == 0) {
+                                    // Map posisi mouse ke item menu lewat peta region
+                                    int widget = regions.hitTest(ev.x, ev.y);
+                                    if (widget >= WIDGET_MENU_ITEM && widget < WIDGET_MENU_ITEM + MENU_COUNT) {
+                                        selectedMenu = widget - WIDGET_MENU_ITEM;
                                         
-                                        if (clickedMenu == lastClickedMenu && 
-                                            (currentTime - lastClickTime) < DOUBLE_CLICK_THRESHOLD) {
+                                        if (menuClicks.click(widget)) {
                                             // Double click detected - execute menu action
-                                            switch (selectedMenu) {
-                                                case 0: // Tambah Pesan
-                                                    inputNewMessage(queue);
-                                                    break;
-                                                case 1: // Hapus Pesan Pertama
-                                                    deleteFirstMessage(queue);
-                                                    break;
-                                                case 2: // Batalkan Pesan Terakhir
-                                                    cancelLastMessage(queue);
-                                                    break;
-                                                case 3: // Lihat Semua Pesan
-                                                    displayMessages(queue);
-                                                    break;
-                                                case 4: // Tandai Sebagai Dibaca
-                                                    markMessageAsRead(queue);
-                                                    break;
-                                                case 5: // Keluar
-                                                    running = false;
-                                                    break;
-                                            }
-                                            
-                                            lastClickedMenu = -1; // Reset after executing
-                                        } else {
-                                            // Single click - just update selection
-                                            lastClickedMenu = clickedMenu;
-                                            lastClickTime = currentTime;
+                                            execute = true;
                                         }
                                     }
                                 }
@@ -2158,32 +10183,46 @@ int main() {
                 }
             } else if (c == '\n' || c == '\r') { // Enter key
                 // Execute selected menu
-                switch (selectedMenu) {
-                    case 0: // Tambah Pesan
-                        inputNewMessage(queue);
-                        break;
-                    case 1: // Hapus Pesan Pertama
-                        deleteFirstMessage(queue);
-                        break;
-                    case 2: // Batalkan Pesan Terakhir
-                        cancelLastMessage(queue);
-                        break;
-                    case 3: // Lihat Semua Pesan
-                        displayMessages(queue);
-                        break;
-                    case 4: // Tandai Sebagai Dibaca
-                        markMessageAsRead(queue);
-                        break;
-                    case 5: // Keluar
-                        running = false;
-                        break;
+                execute = true;
+            } else if (c == 'u' || c == 'U') {
+                string what = queue.describeUndo();
+                if (queue.undo()) {
+                    lastAction = "↶ Dibatalkan: " + what;
+                }
+            } else if (c == 'r' || c == 'R') {
+                string what = queue.describeRedo();
+                if (queue.redo()) {
+                    lastAction = "↷ Diulang: " + what;
+                }
+            } else if (c == 't' || c == 'T') {
+                // Pesan sementara: nonaktif -> 30 dtk -> 5 mnt -> 1 jam -> 24 jam -> nonaktif
+                const long long TTL_CHOICES[] = {0, 30 * 1000, 5 * 60 * 1000, 3600 * 1000, 24 * 3600 * 1000LL};
+                const int TTL_CHOICE_COUNT = sizeof(TTL_CHOICES) / sizeof(TTL_CHOICES[0]);
+                int next = 0;
+                for (int i = 0; i < TTL_CHOICE_COUNT; i++) {
+                    if (TTL_CHOICES[i] == queue.getTtl()) next = (i + 1) % TTL_CHOICE_COUNT;
+                }
+                queue.setTtl(TTL_CHOICES[next]);
+                if (TTL_CHOICES[next] > 0) {
+                    lastAction = "◷ Pesan baru hilang setelah " + formatDelay(TTL_CHOICES[next]);
+                } else {
+                    lastAction = "◷ Pesan sementara dinonaktifkan";
                 }
             }
         }
+        
+        // Menu dijalankan setelah decode input selesai diukur
+        if (execute) {
+            running = executeMenu(selectedMenu, chats, active);
+        }
     }
     
     disableMouseTracking();
     disableRawMode();
+    tuiServer = nullptr;
+    tuiDelivery = nullptr;
+    tuiIngest = nullptr;
+    tuiScheduler = nullptr;
     
     clearScreen();
     gotoxy(1, 1);
@@ -2191,5 +10230,12 @@ int main() {
     printf("Terima kasih telah menggunakan WhatsApp Simulator!\n");
     resetColor();
     
+    if (statsFile != nullptr && !dumpStats(statsFile)) {
+        fprintf(stderr, "Gagal menyimpan statistik ke %s\n", statsFile);
+    }
+    if (recordFile != nullptr) {
+        fclose(recordFile);
+    }
+    
     return 0;
 }